@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_BENCHMARK_H
+#define LIBVTP_BENCHMARK_H
+
+#include <stddef.h>
+#include <time.h>
+#include <vtp/instruction_types.h>
+
+/** The number of instruction words in each generated benchmark pattern */
+#define BENCHMARK_N_WORDS (1ul << 20u)
+
+/** The number of times each benchmark is repeated */
+#define BENCHMARK_N_REPETITIONS (20)
+
+/**
+ * Fills an array with a pseudo-random, valid mix of VTPv1 instructions
+ *
+ * About 10% of the words increment time, the others set amplitude or frequency,
+ * with every 8th of those being a broadcast.
+ */
+void generate_mixed_words(VTPInstructionWord out[], size_t n, unsigned char n_channels, unsigned long seed);
+
+/** Prints the time per operation of a benchmark */
+void report_benchmark(const char* name, clock_t start, clock_t end, size_t n_operations);
+
+void benchmark_encode(void);
+void benchmark_fold(void);
+void benchmark_fold_fixed(void);
+void benchmark_render(void);
+void benchmark_schedule(void);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vtp/codec.h>
+#include "benchmark.h"
+
+#define N_CHANNELS (16)
+
+
+void benchmark_encode(void) {
+    VTPInstructionWord* words;
+    VTPInstructionV1* instructions;
+    unsigned char* bytes;
+    size_t i;
+    clock_t start;
+
+    words = malloc(BENCHMARK_N_WORDS * sizeof(VTPInstructionWord));
+    instructions = malloc(BENCHMARK_N_WORDS * sizeof(VTPInstructionV1));
+    bytes = malloc(BENCHMARK_N_WORDS * 4);
+
+    if (!words || !instructions || !bytes) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+
+    generate_mixed_words(words, BENCHMARK_N_WORDS, N_CHANNELS, 4177);
+    vtp_decode_instructions_v1(words, instructions, BENCHMARK_N_WORDS);
+
+    start = clock();
+    for (i=0; i < BENCHMARK_N_REPETITIONS; i++) {
+        vtp_encode_instructions_v1(instructions, words, BENCHMARK_N_WORDS);
+        vtp_write_instruction_words(BENCHMARK_N_WORDS, words, bytes);
+    }
+    report_benchmark("encode + write", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS);
+
+    start = clock();
+    for (i=0; i < BENCHMARK_N_REPETITIONS; i++) {
+        vtp_encode_bytes_v1(instructions, bytes, BENCHMARK_N_WORDS);
+    }
+    report_benchmark("vtp_encode_bytes_v1", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS);
+
+    free(words);
+    free(instructions);
+    free(bytes);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vtp/fold.h>
+#include <vtp/fold_fixed.h>
+#include "benchmark.h"
+
+/*
+ * Runs the generic and the fixed channel fold for displays with channel_count channels on the
+ * same instructions, both pre-decoded and as raw instruction words.
+ */
+#define DEFINE_FIXED_FOLD_BENCHMARK(type, prefix, channel_count) \
+    VTP_DECLARE_FIXED_FOLD_V1(type, prefix, channel_count) \
+    VTP_DEFINE_FIXED_FOLD_V1(type, prefix, channel_count) \
+    \
+    void benchmark_##prefix(VTPInstructionWord words[], VTPInstructionV1 instructions[]) { \
+        static type fixed; \
+        VTPAccumulatorV1 accumulator; \
+        unsigned int amplitudes[channel_count], frequencies[channel_count]; \
+        size_t i; \
+        clock_t start; \
+        \
+        generate_mixed_words(words, BENCHMARK_N_WORDS, channel_count, 4242); \
+        vtp_decode_instructions_v1(words, instructions, BENCHMARK_N_WORDS); \
+        \
+        accumulator.n_channels = channel_count; \
+        accumulator.amplitudes = amplitudes; \
+        accumulator.frequencies = frequencies; \
+        \
+        start = clock(); \
+        for (i=0; i < BENCHMARK_N_REPETITIONS; i++) { \
+            accumulator.milliseconds_elapsed = 0; \
+            vtp_fold_v1(&accumulator, instructions, BENCHMARK_N_WORDS); \
+        } \
+        report_benchmark("vtp_fold_v1, " #channel_count " channels", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS); \
+        \
+        start = clock(); \
+        for (i=0; i < BENCHMARK_N_REPETITIONS; i++) { \
+            fixed.milliseconds_elapsed = 0; \
+            prefix##_fold_v1(&fixed, instructions, BENCHMARK_N_WORDS); \
+        } \
+        report_benchmark(#prefix "_fold_v1", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS); \
+        \
+        start = clock(); \
+        for (i=0; i < BENCHMARK_N_REPETITIONS; i++) { \
+            accumulator.milliseconds_elapsed = 0; \
+            vtp_fold_words_v1(&accumulator, words, BENCHMARK_N_WORDS); \
+        } \
+        report_benchmark("vtp_fold_words_v1, " #channel_count " channels", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS); \
+        \
+        start = clock(); \
+        for (i=0; i < BENCHMARK_N_REPETITIONS; i++) { \
+            fixed.milliseconds_elapsed = 0; \
+            prefix##_fold_words_v1(&fixed, words, BENCHMARK_N_WORDS); \
+        } \
+        report_benchmark(#prefix "_fold_words_v1", start, clock(), BENCHMARK_N_REPETITIONS * BENCHMARK_N_WORDS); \
+    }
+
+DEFINE_FIXED_FOLD_BENCHMARK(BenchmarkDisplay4, fixed4, 4)
+DEFINE_FIXED_FOLD_BENCHMARK(BenchmarkDisplay16, fixed16, 16)
+DEFINE_FIXED_FOLD_BENCHMARK(BenchmarkDisplay64, fixed64, 64)
+
+
+void benchmark_fold_fixed(void) {
+    VTPInstructionWord* words;
+    VTPInstructionV1* instructions;
+
+    words = malloc(BENCHMARK_N_WORDS * sizeof(VTPInstructionWord));
+    instructions = malloc(BENCHMARK_N_WORDS * sizeof(VTPInstructionV1));
+
+    if (!words || !instructions) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+
+    benchmark_fixed4(words, instructions);
+    benchmark_fixed16(words, instructions);
+    benchmark_fixed64(words, instructions);
+
+    free(words);
+    free(instructions);
+}
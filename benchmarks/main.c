@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include "benchmark.h"
+
+
+void generate_mixed_words(VTPInstructionWord out[], size_t n, unsigned char n_channels, unsigned long seed) {
+    size_t i;
+    unsigned long random, code, channel_select;
+
+    for (i=0; i < n; i++) {
+        seed = (seed * 1103515245ul + 12345ul) & 0xFFFFFFFFu;
+        random = seed >> 8u;
+
+        if (random % 10 == 0) {
+            out[i] = random % 20;
+        }
+        else {
+            code = 1 + (random & 1u);
+            channel_select = ((random >> 1u) % 8 == 0) ? 0 : 1 + (random >> 4u) % n_channels;
+            out[i] = (code << 28u) | (channel_select << 20u) | (((random >> 12u) % 4) << 10u) | ((random >> 14u) & 0x3FFu);
+        }
+    }
+}
+
+void report_benchmark(const char* name, clock_t start, clock_t end, size_t n_operations) {
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+
+    printf("%-40s %10.2f ns/op\n", name, seconds * 1e9 / (double)n_operations);
+}
+
+int main(int argc, char** args) {
+    benchmark_encode();
+    benchmark_fold();
+    benchmark_fold_fixed();
+    benchmark_render();
+    benchmark_schedule();
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vtp/render.h>
+#include "benchmark.h"
+
+#define N_CHANNELS (255)
+#define N_FRAMES (1000)
+#define N_WORDS (1ul << 16u)
+
+void run_render_benchmark(const char* name, VTPRampModeV1 mode, const VTPInstructionWord* words);
+
+
+/* Renders one second of a dense pattern on a display with the maximum number of channels, at 1 kHz */
+void benchmark_render(void) {
+    VTPInstructionWord* words;
+
+    words = malloc(N_WORDS * sizeof(VTPInstructionWord));
+
+    if (!words) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+
+    generate_mixed_words(words, N_WORDS, N_CHANNELS, 1701);
+
+    run_render_benchmark("render frame, no ramps", VTP_RAMP_NONE, words);
+    run_render_benchmark("render frame, linear ramps", VTP_RAMP_LINEAR, words);
+    run_render_benchmark("render frame, exponential ramps", VTP_RAMP_EXPONENTIAL, words);
+
+    free(words);
+}
+
+void run_render_benchmark(const char* name, VTPRampModeV1 mode, const VTPInstructionWord* words) {
+    static unsigned int amplitudes[N_FRAMES * N_CHANNELS], frequencies[N_FRAMES * N_CHANNELS];
+    VTPRampStateV1 amplitude_states[N_CHANNELS], frequency_states[N_CHANNELS];
+    unsigned int channels[2 * N_CHANNELS];
+    VTPAccumulatorV1 accumulator;
+    VTPWordCursorV1 cursor;
+    VTPRendererV1 renderer;
+    size_t i;
+    clock_t start;
+
+    accumulator.n_channels = N_CHANNELS;
+    accumulator.amplitudes = channels;
+    accumulator.frequencies = channels + N_CHANNELS;
+
+    start = clock();
+    for (i=0; i < BENCHMARK_N_REPETITIONS; i++) {
+        memset(channels, 0, sizeof(channels));
+        accumulator.milliseconds_elapsed = 0;
+        cursor.words = words;
+        cursor.n_words = N_WORDS;
+        cursor.position = 0;
+
+        vtp_render_init_v1(&renderer, &accumulator, mode, 20, 1, amplitude_states, frequency_states);
+        vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, N_FRAMES, amplitudes, frequencies);
+    }
+    report_benchmark(name, start, clock(), BENCHMARK_N_REPETITIONS * N_FRAMES);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vtp/batch.h>
+#include <vtp/timing_wheel.h>
+#include "benchmark.h"
+
+#define N_STREAMS (1024)
+#define N_STREAM_WORDS (64)
+#define N_CHANNELS (4)
+#define N_TICKS (20000ul)
+
+void prepare_streams(VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], const VTPInstructionWord* words, unsigned int* channels);
+
+
+/* Every display plays its own sparse pattern, with pauses of up to a second between instructions, and is advanced one tick at a time */
+void benchmark_schedule(void) {
+    VTPInstructionWord* words;
+    unsigned int* channels;
+    VTPAccumulatorV1 accumulators[N_STREAMS];
+    VTPWordCursorV1 cursors[N_STREAMS];
+    VTPError errors[N_STREAMS];
+    size_t i, n_processed, storage[N_STREAMS];
+    unsigned long tick, seed;
+    clock_t start;
+    VTPFoldBatchV1 batch;
+    VTPTimingWheelV1 wheel;
+
+    words = malloc(N_STREAMS * N_STREAM_WORDS * sizeof(VTPInstructionWord));
+    channels = malloc(N_STREAMS * 2 * N_CHANNELS * sizeof(unsigned int));
+
+    if (!words || !channels) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+
+    for (i=0, seed = 4711; i < N_STREAMS * N_STREAM_WORDS; i++) {
+        seed = (seed * 1103515245ul + 12345ul) & 0xFFFFFFFFu;
+        words[i] = (i % 2 == 0) ? (seed >> 8u) % 1000 : 0x20100000u | ((seed >> 8u) & 0x3FFu);
+    }
+
+    prepare_streams(accumulators, cursors, words, channels);
+    start = clock();
+    for (tick = 0; tick < N_TICKS; tick++) {
+        for (i=0; i < N_STREAMS; i++) {
+            vtp_fold_words_until_v1(accumulators + i, cursors[i].words + cursors[i].position, cursors[i].n_words - cursors[i].position, tick, &n_processed);
+            cursors[i].position += n_processed;
+        }
+    }
+    report_benchmark("scan all streams per tick", start, clock(), N_TICKS);
+
+    prepare_streams(accumulators, cursors, words, channels);
+    start = clock();
+    vtp_fold_batch_init_v1(&batch, accumulators, cursors, errors, storage, N_STREAMS);
+    for (tick = 0; tick < N_TICKS; tick++)
+        vtp_fold_batch_until_v1(&batch, tick, NULL);
+    report_benchmark("vtp_fold_batch_until_v1 per tick", start, clock(), N_TICKS);
+
+    prepare_streams(accumulators, cursors, words, channels);
+    start = clock();
+    vtp_timing_wheel_init_v1(&wheel, accumulators, cursors, errors, storage, N_STREAMS, 0);
+    for (tick = 0; tick < N_TICKS; tick++)
+        vtp_timing_wheel_advance_v1(&wheel, tick, NULL);
+    report_benchmark("vtp_timing_wheel_advance_v1 per tick", start, clock(), N_TICKS);
+
+    free(words);
+    free(channels);
+}
+
+void prepare_streams(VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], const VTPInstructionWord* words, unsigned int* channels) {
+    size_t i;
+
+    for (i=0; i < N_STREAMS; i++) {
+        accumulators[i].n_channels = N_CHANNELS;
+        accumulators[i].amplitudes = channels + i * 2 * N_CHANNELS;
+        accumulators[i].frequencies = channels + i * 2 * N_CHANNELS + N_CHANNELS;
+        accumulators[i].milliseconds_elapsed = 0;
+        cursors[i].words = words + i * N_STREAM_WORDS;
+        cursors[i].n_words = N_STREAM_WORDS;
+        cursors[i].position = 0;
+    }
+}
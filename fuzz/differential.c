@@ -0,0 +1,607 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <vtp/batch.h>
+#include <vtp/codec.h>
+#include <vtp/fold.h>
+#include <vtp/fold_fixed.h>
+#include <vtp/journal.h>
+#include <vtp/reader.h>
+#include <vtp/timing_wheel.h>
+#include "differential.h"
+
+#define N_MAX_CHANNELS (255)
+
+/* The result of folding an input with one implementation */
+struct sFoldResult {
+    VTPError err;
+    size_t n_processed;
+    unsigned long milliseconds_elapsed;
+    unsigned int amplitudes[N_MAX_CHANNELS];
+    unsigned int frequencies[N_MAX_CHANNELS];
+};
+typedef struct sFoldResult FoldResult;
+
+/* A source for readers that hands out 1 to 3 bytes per fetch, so that instruction words are split across fetches */
+struct sSplitSource {
+    const unsigned char* bytes;
+    size_t n_bytes;
+    size_t position;
+    size_t n_fetches;
+};
+typedef struct sSplitSource SplitSource;
+
+int check_decode(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words);
+int check_lenient_decode(const VTPInstructionWord words[], size_t n_words);
+int check_fold(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words, unsigned char n_channels);
+int check_fold_until(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words, unsigned char n_channels, unsigned long until_ms);
+void fold_reference(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, int has_target, unsigned long until_ms, FoldResult* result);
+void begin_fold_result(VTPAccumulatorV1* accumulator, unsigned char n_channels, FoldResult* result);
+void begin_narrow_fold_result(VTPNarrowAccumulatorV1* accumulator, VTPChannelStateV1 channels[], unsigned char n_channels, FoldResult* result);
+void end_narrow_fold_result(const VTPNarrowAccumulatorV1* accumulator, FoldResult* result);
+size_t decode_prefix(const VTPInstructionWord words[], size_t n_words, VTPInstructionV1 out[]);
+int instructions_equal(const VTPInstructionV1* a, const VTPInstructionV1* b);
+int compare_fold_results(const char* name, const FoldResult* expected, const FoldResult* actual, unsigned char n_channels);
+int check_fixed_folds(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, unsigned long until_ms);
+int check_read_instructions(const char* name, VTPReaderV1* reader, size_t n_valid, VTPError expected_err);
+void begin_split_reader(VTPReaderV1* reader, const unsigned char bytes[], size_t n_words);
+VTPError fetch_split(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes);
+
+/*
+ * Defines a function that checks the fixed channel fold for n_channels against the reference, both with
+ * and without a target time. It assumes that decoded_instructions holds the first n_valid instructions.
+ */
+#define DEFINE_FIXED_FOLD_CHECK(type, prefix, n_channels) \
+    VTP_DECLARE_FIXED_FOLD_V1(type, prefix, n_channels) \
+    VTP_DEFINE_FIXED_FOLD_V1(type, prefix, n_channels) \
+    \
+    int check_##prefix(const VTPInstructionWord words[], size_t n_words, size_t n_valid, unsigned long until_ms) { \
+        type accumulator; \
+        \
+        fold_reference(words, n_words, n_channels, 0, 0, &reference_result); \
+        reference_result.n_processed = 0; \
+        memset(&accumulator, 0, sizeof(accumulator)); \
+        memset(&actual_result, 0, sizeof(actual_result)); \
+        actual_result.err = prefix##_fold_words_v1(&accumulator, words, n_words); \
+        memcpy(actual_result.amplitudes, accumulator.amplitudes, sizeof(accumulator.amplitudes)); \
+        memcpy(actual_result.frequencies, accumulator.frequencies, sizeof(accumulator.frequencies)); \
+        actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed; \
+        if (compare_fold_results(#prefix "_fold_words_v1", &reference_result, &actual_result, n_channels)) \
+            return 1; \
+        \
+        fold_reference(words, n_words, n_channels, 1, until_ms, &reference_result); \
+        memset(&accumulator, 0, sizeof(accumulator)); \
+        memset(&actual_result, 0, sizeof(actual_result)); \
+        actual_result.err = prefix##_fold_words_until_v1(&accumulator, words, n_words, until_ms, &actual_result.n_processed); \
+        memcpy(actual_result.amplitudes, accumulator.amplitudes, sizeof(accumulator.amplitudes)); \
+        memcpy(actual_result.frequencies, accumulator.frequencies, sizeof(accumulator.frequencies)); \
+        actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed; \
+        if (compare_fold_results(#prefix "_fold_words_until_v1", &reference_result, &actual_result, n_channels)) \
+            return 1; \
+        \
+        memset(&accumulator, 0, sizeof(accumulator)); \
+        memset(&actual_result, 0, sizeof(actual_result)); \
+        actual_result.err = prefix##_fold_until_v1(&accumulator, decoded_instructions, n_valid, until_ms, &actual_result.n_processed); \
+        if (actual_result.err == VTP_OK && actual_result.n_processed == n_valid && n_valid < n_words && accumulator.milliseconds_elapsed <= until_ms) \
+            actual_result.err = VTP_INVALID_INSTRUCTION_CODE; \
+        memcpy(actual_result.amplitudes, accumulator.amplitudes, sizeof(accumulator.amplitudes)); \
+        memcpy(actual_result.frequencies, accumulator.frequencies, sizeof(accumulator.frequencies)); \
+        actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed; \
+        return compare_fold_results(#prefix "_fold_until_v1", &reference_result, &actual_result, n_channels); \
+    }
+
+/* Scratch memory, which is too large for the stack of some platforms */
+static VTPInstructionWord input_words[DIFFERENTIAL_MAX_WORDS];
+static VTPInstructionV1 decoded_instructions[DIFFERENTIAL_MAX_WORDS];
+static unsigned char encoded_bytes[DIFFERENTIAL_MAX_WORDS * 4];
+static VTPInstructionV1 lenient_instructions[DIFFERENTIAL_MAX_WORDS];
+static VTPDecodeIssueV1 decode_issues[DIFFERENTIAL_MAX_WORDS];
+static FoldResult reference_result, actual_result;
+static VTPJournalEntryV1 journal_entries[DIFFERENTIAL_MAX_WORDS];
+static unsigned int row_amplitudes[2 * N_MAX_CHANNELS], row_frequencies[2 * N_MAX_CHANNELS];
+static VTPInstructionV1 read_instructions[DIFFERENTIAL_MAX_WORDS + 3];
+static SplitSource split_source;
+static unsigned char reader_buffer[7];
+
+/* The channel counts of the fixed channel folds that are checked */
+DEFINE_FIXED_FOLD_CHECK(FixedDisplay4, fixed4, 4)
+DEFINE_FIXED_FOLD_CHECK(FixedDisplay16, fixed16, 16)
+DEFINE_FIXED_FOLD_CHECK(FixedDisplay64, fixed64, 64)
+
+
+int check_implementations(const unsigned char data[], size_t size) {
+    unsigned char n_channels;
+    unsigned long until_ms;
+    size_t n_words;
+    const unsigned char* bytes;
+
+    if (size < DIFFERENTIAL_HEADER_SIZE)
+        return 0;
+
+    n_channels = data[0];
+    until_ms = ((unsigned long)data[1] << 8u) | data[2];
+    bytes = data + DIFFERENTIAL_HEADER_SIZE;
+
+    n_words = (size - DIFFERENTIAL_HEADER_SIZE) / 4;
+    if (n_words > DIFFERENTIAL_MAX_WORDS)
+        n_words = DIFFERENTIAL_MAX_WORDS;
+
+    vtp_read_instruction_words(n_words, bytes, input_words);
+
+    return check_decode(input_words, bytes, n_words)
+        || check_lenient_decode(input_words, n_words)
+        || check_fold(input_words, bytes, n_words, n_channels)
+        || check_fold_until(input_words, bytes, n_words, n_channels, until_ms)
+        || check_fixed_folds(input_words, n_words, n_channels, until_ms);
+}
+
+
+int check_decode(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words) {
+    size_t i, n_valid, n_encoded;
+    VTPInstructionV1 instruction;
+    VTPInstructionWord encoded;
+    VTPReaderV1 reader;
+    VTPError expected_err, err;
+
+    n_valid = decode_prefix(words, n_words, decoded_instructions);
+    expected_err = n_valid < n_words ? VTP_INVALID_INSTRUCTION_CODE : VTP_OK;
+
+    /* The bulk decoder must stop with the same error, having decoded the same instructions */
+    if ((err = vtp_decode_instructions_v1(words, decoded_instructions, n_words)) != expected_err) {
+        fprintf(stderr, "vtp_decode_instructions_v1: error %d, expected %d\n", err, expected_err);
+        return 1;
+    }
+
+    for (i=0; i < n_valid; i++) {
+        vtp_decode_instruction_v1(words[i], &instruction);
+
+        if (!instructions_equal(&instruction, decoded_instructions + i)) {
+            fprintf(stderr, "vtp_decode_instructions_v1: instruction %lu differs\n", (unsigned long)i);
+            return 1;
+        }
+
+        if (vtp_get_time_offset_v1(&instruction) != vtp_get_word_time_offset_v1(words[i])) {
+            fprintf(stderr, "vtp_get_word_time_offset_v1: instruction %lu differs\n", (unsigned long)i);
+            return 1;
+        }
+
+        if (vtp_encode_instruction_v1(&instruction, &encoded) != VTP_OK || encoded != words[i]) {
+            fprintf(stderr, "vtp_encode_instruction_v1: instruction %lu doesn't round-trip\n", (unsigned long)i);
+            return 1;
+        }
+    }
+
+    /* The decoder leaves the invalid code in the slot after the valid prefix, so the fused encoder must stop there */
+    n_encoded = n_valid < n_words ? n_valid + 1 : n_valid;
+    if ((err = vtp_encode_bytes_v1(decoded_instructions, encoded_bytes, n_encoded)) != expected_err) {
+        fprintf(stderr, "vtp_encode_bytes_v1: error %d, expected %d\n", err, expected_err);
+        return 1;
+    }
+
+    if (memcmp(encoded_bytes, bytes, n_valid * 4) != 0) {
+        fprintf(stderr, "vtp_encode_bytes_v1: bytes don't round-trip\n");
+        return 1;
+    }
+
+    vtp_reader_init_memory_v1(&reader, bytes, 4 * n_words);
+    if (check_read_instructions("vtp_read_instructions_v1 (memory)", &reader, n_valid, expected_err))
+        return 1;
+
+    begin_split_reader(&reader, bytes, n_words);
+    return check_read_instructions("vtp_read_instructions_v1 (split words)", &reader, n_valid, expected_err);
+}
+
+int check_lenient_decode(const VTPInstructionWord words[], size_t n_words) {
+    size_t i, n_out, n_issues, next_issue;
+    VTPInstructionV1 instruction;
+    VTPError expected_err, err;
+
+    expected_err = decode_prefix(words, n_words, decoded_instructions) < n_words ? VTP_INVALID_INSTRUCTION_CODE : VTP_OK;
+
+    /* Skipping must yield the valid words in order, and record each invalid one */
+    err = vtp_decode_instructions_lenient_v1(words, n_words, VTP_RECOVERY_SKIP, NULL, lenient_instructions, &n_out, decode_issues, DIFFERENTIAL_MAX_WORDS, &n_issues);
+    if (err != expected_err || n_out + n_issues != n_words) {
+        fprintf(stderr, "vtp_decode_instructions_lenient_v1: error %d, expected %d, %lu + %lu words\n", err, expected_err, (unsigned long)n_out, (unsigned long)n_issues);
+        return 1;
+    }
+
+    next_issue = 0;
+    for (i=0; i < n_words; i++) {
+        if (vtp_decode_instruction_v1(words[i], &instruction) != VTP_OK) {
+            if (next_issue == n_issues || decode_issues[next_issue].index != i || decode_issues[next_issue].error != VTP_INVALID_INSTRUCTION_CODE) {
+                fprintf(stderr, "vtp_decode_instructions_lenient_v1: word %lu not recorded\n", (unsigned long)i);
+                return 1;
+            }
+
+            next_issue++;
+        }
+        else if (!instructions_equal(&instruction, lenient_instructions + i - next_issue)) {
+            fprintf(stderr, "vtp_decode_instructions_lenient_v1: instruction %lu differs\n", (unsigned long)i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int check_fold(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words, unsigned char n_channels) {
+    VTPAccumulatorV1 accumulator;
+    VTPNarrowAccumulatorV1 narrow_accumulator;
+    VTPChannelStateV1 narrow_channels[N_MAX_CHANNELS];
+    size_t n_valid;
+
+    fold_reference(words, n_words, n_channels, 0, 0, &reference_result);
+    n_valid = decode_prefix(words, n_words, decoded_instructions);
+
+    /* The fold variants without a target time don't report the number of processed instructions */
+    reference_result.n_processed = 0;
+
+    /* Folding decoded instructions fails at the first invalid word at the latest */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_v1(&accumulator, decoded_instructions, n_valid);
+    if (actual_result.err == VTP_OK && n_valid < n_words)
+        actual_result.err = VTP_INVALID_INSTRUCTION_CODE;
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_words_v1(&accumulator, words, n_words);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_words_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_bytes_v1(&accumulator, bytes, n_words);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_bytes_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_narrow_fold_result(&narrow_accumulator, narrow_channels, n_channels, &actual_result);
+    actual_result.err = vtp_fold_narrow_v1(&narrow_accumulator, decoded_instructions, n_valid);
+    if (actual_result.err == VTP_OK && n_valid < n_words)
+        actual_result.err = VTP_INVALID_INSTRUCTION_CODE;
+    end_narrow_fold_result(&narrow_accumulator, &actual_result);
+    if (compare_fold_results("vtp_fold_narrow_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    return 0;
+}
+
+int check_fold_until(const VTPInstructionWord words[], const unsigned char bytes[], size_t n_words, unsigned char n_channels, unsigned long until_ms) {
+    VTPAccumulatorV1 accumulator;
+    VTPNarrowAccumulatorV1 narrow_accumulator;
+    VTPChannelStateV1 narrow_channels[N_MAX_CHANNELS];
+    VTPWordCursorV1 cursor;
+    VTPFoldBatchV1 batch;
+    VTPTimingWheelV1 wheel;
+    VTPJournalV1 journal;
+    VTPStreamCursorV1 stream_cursor;
+    VTPReaderV1 reader;
+    VTPError stream_err;
+    size_t n_valid, storage, n_processed, n_undone, n_rows, window_size;
+    unsigned long times_ms[2], window_offset, window_end;
+    int window_exhausted;
+
+    fold_reference(words, n_words, n_channels, 1, until_ms, &reference_result);
+    n_valid = decode_prefix(words, n_words, decoded_instructions);
+
+    /* An invalid word is due, and thus an error, if the decoded prefix has been folded completely */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_until_v1(&accumulator, decoded_instructions, n_valid, until_ms, &actual_result.n_processed);
+    if (actual_result.err == VTP_OK && actual_result.n_processed == n_valid && n_valid < n_words && accumulator.milliseconds_elapsed <= until_ms)
+        actual_result.err = VTP_INVALID_INSTRUCTION_CODE;
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_until_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_words_until_v1(&accumulator, words, n_words, until_ms, &actual_result.n_processed);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_words_until_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    /* Folding in two steps must end up in the same state as folding in one */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_words_until_v1(&accumulator, words, n_words, until_ms / 2, &actual_result.n_processed);
+    if (actual_result.err == VTP_OK) {
+        actual_result.err = vtp_fold_words_until_v1(&accumulator, words + actual_result.n_processed, n_words - actual_result.n_processed, until_ms, &n_processed);
+        actual_result.n_processed += n_processed;
+    }
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_words_until_v1 (two steps)", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    actual_result.err = vtp_fold_bytes_until_v1(&accumulator, bytes, n_words, until_ms, &actual_result.n_processed);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_bytes_until_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    /* Windows of 1 to 13 bytes, starting at the word of the cursor or the one before it, split words at every position */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    stream_cursor.accumulator = &accumulator;
+    stream_cursor.byte_offset = 0;
+    window_size = 0;
+    do {
+        window_size = window_size % 13 + 1;
+        window_offset = stream_cursor.byte_offset - stream_cursor.byte_offset % 8;
+        window_end = window_offset + window_size < 4ul * n_words ? window_offset + window_size : 4ul * n_words;
+        actual_result.err = vtp_fold_window_until_v1(&stream_cursor, bytes + window_offset, window_offset, window_end - window_offset, until_ms, &window_exhausted);
+    } while (actual_result.err == VTP_OK && window_exhausted && stream_cursor.byte_offset < 4ul * n_words);
+    actual_result.n_processed = stream_cursor.byte_offset / 4;
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_window_until_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    vtp_reader_init_memory_v1(&reader, bytes, 4 * n_words);
+    actual_result.err = vtp_fold_reader_until_v1(&accumulator, &reader, until_ms, &actual_result.n_processed);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_reader_until_v1 (memory)", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    /* Resuming a reader whose buffer ends within a word must not lose or repeat any bytes */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    begin_split_reader(&reader, bytes, n_words);
+    actual_result.err = vtp_fold_reader_until_v1(&accumulator, &reader, until_ms / 2, &actual_result.n_processed);
+    if (actual_result.err == VTP_OK) {
+        actual_result.err = vtp_fold_reader_until_v1(&accumulator, &reader, until_ms, &n_processed);
+        actual_result.n_processed += n_processed;
+    }
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_reader_until_v1 (split words)", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_narrow_fold_result(&narrow_accumulator, narrow_channels, n_channels, &actual_result);
+    actual_result.err = vtp_fold_until_narrow_v1(&narrow_accumulator, decoded_instructions, n_valid, until_ms, &actual_result.n_processed);
+    if (actual_result.err == VTP_OK && actual_result.n_processed == n_valid && n_valid < n_words && narrow_accumulator.milliseconds_elapsed <= until_ms)
+        actual_result.err = VTP_INVALID_INSTRUCTION_CODE;
+    end_narrow_fold_result(&narrow_accumulator, &actual_result);
+    if (compare_fold_results("vtp_fold_until_narrow_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    cursor.words = words;
+    cursor.n_words = n_words;
+    cursor.position = 0;
+    vtp_fold_batch_init_v1(&batch, &accumulator, &cursor, &stream_err, &storage, 1);
+    actual_result.err = vtp_fold_batch_until_v1(&batch, until_ms, &actual_result.n_processed);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_fold_batch_until_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    cursor.position = 0;
+    vtp_timing_wheel_init_v1(&wheel, &accumulator, &cursor, &stream_err, &storage, 1, 0);
+    actual_result.err = vtp_timing_wheel_advance_v1(&wheel, until_ms, &actual_result.n_processed);
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (compare_fold_results("vtp_timing_wheel_advance_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    /*
+     * Folding up to the first erroneous word and then unfolding back to the target time must end up in the
+     * same state as folding until it, unless that word is due or the journal doesn't reach back far enough
+     */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    vtp_journal_init_v1(&journal, journal_entries, DIFFERENTIAL_MAX_WORDS);
+    if (vtp_fold_words_until_journaled_v1(&accumulator, &journal, words, n_words, (unsigned long)-1, &n_processed) != VTP_OK) {
+        begin_fold_result(&accumulator, n_channels, &actual_result);
+        vtp_journal_init_v1(&journal, journal_entries, DIFFERENTIAL_MAX_WORDS);
+        vtp_fold_words_until_journaled_v1(&accumulator, &journal, words, n_processed, (unsigned long)-1, &n_processed);
+    }
+    if (reference_result.err == VTP_OK && vtp_unfold_until_v1(&accumulator, &journal, until_ms, &n_undone) == VTP_OK) {
+        actual_result.n_processed = n_processed - n_undone;
+        actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+        if (compare_fold_results("vtp_unfold_until_v1", &reference_result, &actual_result, n_channels))
+            return 1;
+    }
+
+    /* The last row of a multi-time fold must match folding until its time */
+    begin_fold_result(&accumulator, n_channels, &actual_result);
+    cursor.position = 0;
+    times_ms[0] = until_ms / 2;
+    times_ms[1] = until_ms;
+    actual_result.err = vtp_fold_words_at_v1(&accumulator, &cursor, times_ms, 2, row_amplitudes, row_frequencies, &n_rows);
+    actual_result.n_processed = cursor.position;
+    actual_result.milliseconds_elapsed = accumulator.milliseconds_elapsed;
+    if (actual_result.err == VTP_OK && (n_rows != 2
+        || memcmp(row_amplitudes + n_channels, actual_result.amplitudes, n_channels * sizeof(unsigned int)) != 0
+        || memcmp(row_frequencies + n_channels, actual_result.frequencies, n_channels * sizeof(unsigned int)) != 0)) {
+        fputs("vtp_fold_words_at_v1: last row differs from the accumulator\n", stderr);
+        return 1;
+    }
+    if (compare_fold_results("vtp_fold_words_at_v1", &reference_result, &actual_result, n_channels))
+        return 1;
+
+    return 0;
+}
+
+int check_fixed_folds(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, unsigned long until_ms) {
+    size_t n_valid = decode_prefix(words, n_words, decoded_instructions);
+
+    switch (n_channels) {
+        case 4:
+            return check_fixed4(words, n_words, n_valid, until_ms);
+        case 16:
+            return check_fixed16(words, n_words, n_valid, until_ms);
+        case 64:
+            return check_fixed64(words, n_words, n_valid, until_ms);
+        default:
+            return 0;
+    }
+}
+
+/* Reads a few instructions at a time, which must yield the valid prefix and then the same error as the bulk decoder */
+int check_read_instructions(const char* name, VTPReaderV1* reader, size_t n_valid, VTPError expected_err) {
+    size_t i, n_read, n_decoded;
+    VTPError err;
+
+    n_read = 0;
+    do {
+        err = vtp_read_instructions_v1(reader, read_instructions + n_read, 3, &n_decoded);
+        n_read += n_decoded;
+    } while (err == VTP_OK && n_decoded > 0);
+
+    if (err != expected_err || n_read != n_valid) {
+        fprintf(stderr, "%s: error %d after %lu instructions, expected %d after %lu\n", name, err, (unsigned long)n_read, expected_err, (unsigned long)n_valid);
+        return 1;
+    }
+
+    for (i=0; i < n_valid; i++) {
+        if (!instructions_equal(read_instructions + i, decoded_instructions + i)) {
+            fprintf(stderr, "%s: instruction %lu differs\n", name, (unsigned long)i);
+            return 1;
+        }
+    }
+
+    if (expected_err == VTP_OK && !vtp_reader_at_end_v1(reader)) {
+        fprintf(stderr, "%s: not at the end of the source\n", name);
+        return 1;
+    }
+
+    return 0;
+}
+
+void begin_split_reader(VTPReaderV1* reader, const unsigned char bytes[], size_t n_words) {
+    split_source.bytes = bytes;
+    split_source.n_bytes = 4 * n_words;
+    split_source.position = 0;
+    split_source.n_fetches = 0;
+    vtp_reader_init_v1(reader, fetch_split, &split_source, reader_buffer, sizeof(reader_buffer));
+}
+
+VTPError fetch_split(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes) {
+    SplitSource* split = (SplitSource*)source;
+    size_t n;
+
+    n = split->n_fetches++ % 3 + 1;
+    if (n > max_bytes)
+        n = max_bytes;
+    if (n > split->n_bytes - split->position)
+        n = split->n_bytes - split->position;
+
+    memcpy(bytes, split->bytes + split->position, n);
+    split->position += n;
+    *n_bytes = n;
+
+    return VTP_OK;
+}
+
+void fold_reference(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, int has_target, unsigned long until_ms, FoldResult* result) {
+    VTPAccumulatorV1 accumulator;
+    VTPInstructionV1 instruction;
+    size_t i;
+
+    begin_fold_result(&accumulator, n_channels, result);
+
+    for (i=0; i < n_words; i++) {
+        /* Words with an invalid code have no time offset */
+        if (vtp_decode_instruction_v1(words[i], &instruction) != VTP_OK) {
+            if (!has_target || accumulator.milliseconds_elapsed <= until_ms)
+                result->err = VTP_INVALID_INSTRUCTION_CODE;
+            break;
+        }
+
+        if (has_target && accumulator.milliseconds_elapsed + vtp_get_time_offset_v1(&instruction) > until_ms)
+            break;
+
+        if ((result->err = vtp_fold_single_v1(&accumulator, &instruction)) != VTP_OK)
+            break;
+    }
+
+    result->n_processed = i;
+    result->milliseconds_elapsed = accumulator.milliseconds_elapsed;
+}
+
+void begin_fold_result(VTPAccumulatorV1* accumulator, unsigned char n_channels, FoldResult* result) {
+    memset(result, 0, sizeof(FoldResult));
+    result->err = VTP_OK;
+
+    accumulator->n_channels = n_channels;
+    accumulator->amplitudes = result->amplitudes;
+    accumulator->frequencies = result->frequencies;
+    accumulator->milliseconds_elapsed = 0;
+}
+
+void begin_narrow_fold_result(VTPNarrowAccumulatorV1* accumulator, VTPChannelStateV1 channels[], unsigned char n_channels, FoldResult* result) {
+    memset(channels, 0, N_MAX_CHANNELS * sizeof(VTPChannelStateV1));
+    memset(result, 0, sizeof(FoldResult));
+    result->err = VTP_OK;
+
+    accumulator->n_channels = n_channels;
+    accumulator->channels = channels;
+    accumulator->milliseconds_elapsed = 0;
+}
+
+void end_narrow_fold_result(const VTPNarrowAccumulatorV1* accumulator, FoldResult* result) {
+    unsigned char i;
+
+    for (i=0; i < accumulator->n_channels; i++) {
+        result->amplitudes[i] = accumulator->channels[i].amplitude;
+        result->frequencies[i] = accumulator->channels[i].frequency;
+    }
+
+    result->milliseconds_elapsed = accumulator->milliseconds_elapsed;
+}
+
+size_t decode_prefix(const VTPInstructionWord words[], size_t n_words, VTPInstructionV1 out[]) {
+    size_t i;
+
+    for (i=0; i < n_words && vtp_decode_instruction_v1(words[i], out + i) == VTP_OK; i++);
+
+    return i;
+}
+
+int instructions_equal(const VTPInstructionV1* a, const VTPInstructionV1* b) {
+    if (a->code != b->code)
+        return 0;
+
+    if (a->code == VTP_INST_INCREMENT_TIME)
+        return a->params.format_a.parameter_a == b->params.format_a.parameter_a;
+
+    return a->params.format_b.channel_select == b->params.format_b.channel_select
+        && a->params.format_b.time_offset == b->params.format_b.time_offset
+        && a->params.format_b.parameter_a == b->params.format_b.parameter_a;
+}
+
+int compare_fold_results(const char* name, const FoldResult* expected, const FoldResult* actual, unsigned char n_channels) {
+    if (actual->err != expected->err) {
+        fprintf(stderr, "%s: error %d, expected %d\n", name, actual->err, expected->err);
+        return 1;
+    }
+
+    if (actual->n_processed != expected->n_processed) {
+        fprintf(stderr, "%s: processed %lu instructions, expected %lu\n", name, (unsigned long)actual->n_processed, (unsigned long)expected->n_processed);
+        return 1;
+    }
+
+    if (actual->milliseconds_elapsed != expected->milliseconds_elapsed) {
+        fprintf(stderr, "%s: %lu milliseconds elapsed, expected %lu\n", name, actual->milliseconds_elapsed, expected->milliseconds_elapsed);
+        return 1;
+    }
+
+    if (memcmp(actual->amplitudes, expected->amplitudes, n_channels * sizeof(unsigned int)) != 0
+        || memcmp(actual->frequencies, expected->frequencies, n_channels * sizeof(unsigned int)) != 0) {
+        fprintf(stderr, "%s: channel state differs\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_DIFFERENTIAL_H
+#define LIBVTP_DIFFERENTIAL_H
+
+#include <stddef.h>
+
+/** The maximum number of instruction words taken from a single input */
+#define DIFFERENTIAL_MAX_WORDS (4096)
+
+/** The number of bytes at the start of an input that select the number of channels and the target time */
+#define DIFFERENTIAL_HEADER_SIZE (3)
+
+/**
+ * Runs every decode and fold implementation of libvtp on the same input and compares their results
+ *
+ * The first byte of the input selects the number of channels, the next two bytes the target time
+ * for the fold-until variants (big endian). The rest is interpreted as VTP Binary instruction words.
+ * The results of all implementations, including error codes and the number of processed
+ * instructions, are compared against the scalar reference code (vtp_decode_instruction_v1 and
+ * vtp_fold_single_v1, applied one instruction at a time).
+ *
+ * @param data The input
+ * @param size The size of the input in bytes
+ * @return 0 if all implementations agree, otherwise 1. Details on any mismatch are printed to stderr.
+ */
+int check_implementations(const unsigned char data[], size_t size);
+
+#endif
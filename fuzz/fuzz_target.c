@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "differential.h"
+
+#define MAX_INPUT_SIZE (DIFFERENTIAL_HEADER_SIZE + 4 * DIFFERENTIAL_MAX_WORDS)
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size);
+int run_input_file(FILE* file);
+
+
+/*
+ * Entry point for libFuzzer. Any disagreement between the implementations aborts, so that
+ * the fuzzer records the input as a crash.
+ */
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size) {
+    if (check_implementations(data, size) != 0)
+        abort();
+
+    return 0;
+}
+
+#ifndef VTP_LIBFUZZER
+/*
+ * Without libFuzzer, the target runs each file given on the command line, or the standard input
+ * if there are none. This is how AFL and similar fuzzers drive it, and how crashes are reproduced.
+ */
+int main(int argc, char** argv) {
+    int i;
+    FILE* file;
+
+    if (argc < 2)
+        return run_input_file(stdin);
+
+    for (i=1; i < argc; i++) {
+        if (!(file = fopen(argv[i], "rb"))) {
+            fprintf(stderr, "Could not open %s\n", argv[i]);
+            return 1;
+        }
+
+        run_input_file(file);
+        fclose(file);
+    }
+
+    return 0;
+}
+
+int run_input_file(FILE* file) {
+    static unsigned char input[MAX_INPUT_SIZE];
+    size_t size;
+
+    size = fread(input, 1, MAX_INPUT_SIZE, file);
+    return LLVMFuzzerTestOneInput(input, size);
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "differential.h"
+
+#define DEFAULT_N_INPUTS (2000)
+#define MAX_RANDOM_WORDS (512)
+
+unsigned long next_random(unsigned long* seed);
+size_t generate_input(unsigned char out[], unsigned long* seed);
+
+
+/*
+ * Runs the differential check on pseudo-random inputs that are mostly, but not entirely, valid VTP.
+ * Usage: differential [number of inputs] [seed]
+ */
+int main(int argc, char** argv) {
+    static unsigned char input[DIFFERENTIAL_HEADER_SIZE + 4 * MAX_RANDOM_WORDS];
+    unsigned long i, n_inputs, seed, input_seed;
+    size_t size;
+
+    n_inputs = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_N_INPUTS;
+    seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+
+    for (i=0; i < n_inputs; i++) {
+        input_seed = seed;
+        size = generate_input(input, &seed);
+
+        if (check_implementations(input, size) != 0) {
+            fprintf(stderr, "Mismatch on input %lu (generated from seed %lu)\n", i, input_seed);
+            return 1;
+        }
+    }
+
+    printf("%lu inputs checked, all implementations agree\n", n_inputs);
+    return 0;
+}
+
+
+unsigned long next_random(unsigned long* seed) {
+    *seed = (*seed * 1103515245ul + 12345ul) & 0xFFFFFFFFu;
+    return *seed >> 8u;
+}
+
+size_t generate_input(unsigned char out[], unsigned long* seed) {
+    size_t i, n_words;
+    unsigned long random, word, n_channels, until_ms;
+
+    /* Mostly small displays, sometimes none, 64 or the maximum number of channels */
+    random = next_random(seed);
+    n_channels = random % 16 == 0 ? 255 : (random % 16 == 1 ? 0 : (random % 16 == 2 ? 64 : 1 + random % 24));
+    until_ms = next_random(seed) % 3000;
+    n_words = next_random(seed) % (MAX_RANDOM_WORDS + 1);
+
+    out[0] = (unsigned char)n_channels;
+    out[1] = (unsigned char)(until_ms >> 8u);
+    out[2] = (unsigned char)until_ms;
+
+    for (i=0; i < n_words; i++) {
+        random = next_random(seed);
+
+        if (random % 64 == 0)
+            word = (unsigned long)(3 + random % 13) << 28u;
+        else if (random % 8 == 0)
+            word = next_random(seed) % 100;
+        else
+            word = ((1ul + (random & 1u)) << 28u)
+                | ((random >> 1u) % (n_channels + 3) << 20u)
+                | ((random >> 9u) % 8 << 10u)
+                | (next_random(seed) & 0x3FFu);
+
+        out[DIFFERENTIAL_HEADER_SIZE + 4*i] = (unsigned char)(word >> 24u);
+        out[DIFFERENTIAL_HEADER_SIZE + 4*i + 1] = (unsigned char)(word >> 16u);
+        out[DIFFERENTIAL_HEADER_SIZE + 4*i + 2] = (unsigned char)(word >> 8u);
+        out[DIFFERENTIAL_HEADER_SIZE + 4*i + 3] = (unsigned char)word;
+    }
+
+    return DIFFERENTIAL_HEADER_SIZE + 4 * n_words;
+}
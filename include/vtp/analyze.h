@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_ANALYZE_H
+#define LIBVTP_ANALYZE_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/instruction_types.h>
+
+/** The number of entries required for the channel_writes field of VTPPatternSummaryV1 */
+#define VTP_MAX_CHANNELS (255)
+
+/**
+ * Metadata of a VTPv1 pattern, as gathered by vtp_analyze_v1 / vtp_analyze_words_v1
+ */
+struct sVTPPatternSummaryV1 {
+    /** The number of instructions that have been analyzed */
+    size_t n_instructions;
+
+    /** The sum of all time offsets, i.e. the time at which the last instruction takes effect */
+    unsigned long duration_ms;
+
+    /** The highest channel number selected by any instruction, or 0 if there is none. Use this to size n_channels of an accumulator. */
+    unsigned char max_channel;
+
+    /** The highest number of instructions that take effect at the same millisecond */
+    size_t max_instructions_per_ms;
+
+    /** The number of amplitude / frequency instructions that select all channels */
+    size_t n_broadcasts;
+
+    /**
+     * Optional: The number of amplitude / frequency instructions that select each single channel, indexed by channel number - 1.
+     * Set this to an array of VTP_MAX_CHANNELS entries before analyzing, or to NULL if you're not interested in it.
+     */
+    size_t* channel_writes;
+
+    /** The number of instructions that select a channel beyond the given number of channels */
+    size_t n_out_of_range;
+
+    /** The index of the first instruction that selects a channel beyond the given number of channels. Only valid if n_out_of_range > 0. */
+    size_t first_out_of_range;
+};
+typedef struct sVTPPatternSummaryV1 VTPPatternSummaryV1;
+
+/**
+ * A position within a pattern from which folding can be resumed
+ */
+struct sVTPSeekPointV1 {
+    /** The point in time that this seek point refers to */
+    unsigned long milliseconds;
+
+    /** The number of instructions that vtp_fold_until_v1 applies when folding from the start up until milliseconds */
+    size_t instruction_index;
+};
+typedef struct sVTPSeekPointV1 VTPSeekPointV1;
+
+
+/**
+ * Gathers metadata about VTPv1 instructions in a single pass, without applying them to an accumulator
+ *
+ * @param instructions The instructions to be analyzed
+ * @param n_instructions The number of instructions given in the instructions array
+ * @param n_channels The number of channels of the display that the instructions are meant for. Instructions selecting channels beyond that are counted in n_out_of_range.
+ * @param summary The structure to write the metadata to. Make sure you initialize its channel_writes field.
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h. On error, summary describes the instructions up until the erroneous one.
+ */
+VTPError vtp_analyze_v1(const VTPInstructionV1 instructions[], size_t n_instructions, unsigned char n_channels, VTPPatternSummaryV1* summary);
+
+/**
+ * Gathers metadata about VTPv1 instruction words in a single pass, without decoding them first
+ *
+ * @param words The instruction words to be analyzed
+ * @param n_words The number of instruction words given in the words array
+ * @param n_channels @see vtp_analyze_v1
+ * @param summary @see vtp_analyze_v1
+ * @return @see vtp_analyze_v1
+ */
+VTPError vtp_analyze_words_v1(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, VTPPatternSummaryV1* summary);
+
+/**
+ * Calculates seek points at every multiple of the given interval
+ *
+ * @param words The instruction words to be indexed
+ * @param n_words The number of instruction words given in the words array
+ * @param interval_ms The distance between two seek points in milliseconds. Must not be zero.
+ * @param out The seek points, at 0, interval_ms, 2*interval_ms, ...
+ * @param n_seek_points The number of seek points to calculate. To cover a whole pattern, use duration_ms / interval_ms + 1.
+ */
+void vtp_build_seek_index_v1(const VTPInstructionWord words[], size_t n_words, unsigned long interval_ms, VTPSeekPointV1 out[], size_t n_seek_points);
+
+#endif
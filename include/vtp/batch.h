@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_BATCH_H
+#define LIBVTP_BATCH_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+
+/**
+ * A set of displays that are folded in lockstep, each with its own accumulator and stream of instruction words.
+ *
+ * The displays are kept in a min-heap, keyed by the time of the next instruction of their stream, so
+ * that advancing the batch only touches displays that actually have an instruction due.
+ */
+struct sVTPFoldBatchV1 {
+    /** The number of displays in the batch. Also the length of all arrays below */
+    size_t n_displays;
+
+    /** The accumulator of each display */
+    VTPAccumulatorV1* accumulators;
+
+    /** The instruction stream of each display */
+    VTPWordCursorV1* cursors;
+
+    /** The error that stopped each display, or VTP_OK. Displays with an error are not folded any further. */
+    VTPError* errors;
+
+    /** Bookkeeping of the batch - do not touch */
+    size_t* heap;
+    size_t heap_size;
+};
+typedef struct sVTPFoldBatchV1 VTPFoldBatchV1;
+
+
+/**
+ * Initializes a batch of displays
+ *
+ * Call this function again whenever you modify any of the accumulators or cursors from outside
+ * of vtp_fold_batch_until_v1, e.g. for appending instruction words to a stream.
+ *
+ * @param batch The batch to be initialized
+ * @param accumulators @see VTPFoldBatchV1. Make sure you initialize all of their fields.
+ * @param cursors @see VTPFoldBatchV1
+ * @param errors @see VTPFoldBatchV1. Will be set to VTP_OK.
+ * @param heap_storage An array of n_displays entries that the batch uses internally
+ * @param n_displays @see VTPFoldBatchV1
+ */
+void vtp_fold_batch_init_v1(VTPFoldBatchV1* batch, VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], VTPError errors[], size_t heap_storage[], size_t n_displays);
+
+/**
+ * Folds the streams of all displays in a batch up until the given target time
+ *
+ * This has the same effect as calling vtp_fold_words_until_v1 for each display and advancing its cursor,
+ * but skips all displays whose next instruction isn't due yet.
+ *
+ * @param batch The batch to advance
+ * @param until_ms The target time in milliseconds, @see vtp_fold_until_v1
+ * @param n_processed Returns the count of instructions that have been applied to all accumulators in total. May be NULL.
+ * @return VTP_OK if no display ran into an error, otherwise the first error that occurred. See the errors field for which display failed.
+ */
+VTPError vtp_fold_batch_until_v1(VTPFoldBatchV1* batch, unsigned long until_ms, size_t* n_processed);
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_CACHE_H
+#define LIBVTP_CACHE_H
+
+#include <stddef.h>
+#include <vtp/analyze.h>
+#include <vtp/error.h>
+#include <vtp/instruction_types.h>
+
+/**
+ * A decoded VTPv1 pattern, as stored in a pattern cache.
+ *
+ * All fields are to be considered read-only.
+ */
+struct sVTPCachedPatternV1 {
+    /** The content hash of the pattern's VTP Binary representation, @see vtp_hash_bytes_v1 */
+    unsigned long hash;
+
+    /** The number of instructions of the pattern. Also the length of both the words and instructions fields */
+    size_t n_instructions;
+
+    /** The pattern's instruction words */
+    VTPInstructionWord* words;
+
+    /** The pattern's decoded instructions */
+    VTPInstructionV1* instructions;
+
+    /** Metadata of the pattern, analyzed for a display with 255 channels. Its channel_writes field is always NULL. */
+    VTPPatternSummaryV1 summary;
+
+    /** The number of entries in seek_points */
+    size_t n_seek_points;
+
+    /** Seek points at every multiple of the cache's seek interval, up to and including the duration of the pattern */
+    VTPSeekPointV1* seek_points;
+
+    /* Bookkeeping of the cache - do not touch */
+    size_t n_references;
+    size_t size_bytes;
+    struct sVTPCachedPatternV1* next_in_bucket;
+    struct sVTPCachedPatternV1* newer;
+    struct sVTPCachedPatternV1* older;
+};
+typedef struct sVTPCachedPatternV1 VTPCachedPatternV1;
+
+/**
+ * A lock, used to make a pattern cache safe for use from multiple threads.
+ *
+ * As libvtp itself does not depend on any threading library, locking is delegated to the caller.
+ */
+struct sVTPLockV1 {
+    /** Acquires the lock. Must not be NULL. */
+    void (*lock)(void* context);
+
+    /** Releases the lock. Must not be NULL. */
+    void (*unlock)(void* context);
+
+    /** Passed into both lock and unlock */
+    void* context;
+};
+typedef struct sVTPLockV1 VTPLockV1;
+
+/**
+ * A bounded cache that maps VTP Binary content to its decoded instructions and precomputed metadata.
+ *
+ * Patterns are looked up by a content hash of their binary representation. Once the patterns held by
+ * the cache exceed its size limit, the least recently used patterns that are not currently acquired
+ * will be evicted.
+ */
+struct sVTPPatternCacheV1 {
+    /** The maximum number of bytes that the cached patterns may occupy, @see vtp_cache_init_v1 */
+    size_t max_bytes;
+
+    /** The number of bytes currently occupied by cached patterns */
+    size_t n_bytes;
+
+    /** The distance between two seek points in milliseconds, or 0 for not generating seek points */
+    unsigned long seek_interval_ms;
+
+    /** Bookkeeping of the cache - do not touch */
+    int has_lock;
+    VTPLockV1 lock;
+    size_t n_buckets;
+    VTPCachedPatternV1** buckets;
+    VTPCachedPatternV1* newest;
+    VTPCachedPatternV1* oldest;
+};
+typedef struct sVTPPatternCacheV1 VTPPatternCacheV1;
+
+
+/**
+ * Calculates the content hash that is used for looking up patterns in a pattern cache
+ *
+ * @param bytes The bytes to be hashed
+ * @param n_bytes The number of bytes to be hashed
+ * @return The 32 bit FNV-1a hash of the given bytes
+ */
+unsigned long vtp_hash_bytes_v1(const unsigned char bytes[], size_t n_bytes);
+
+/**
+ * Initializes an empty pattern cache
+ *
+ * @param cache The cache to be initialized
+ * @param n_buckets The number of hash buckets to allocate. Should be in the order of the number of distinct patterns expected.
+ * @param max_bytes The size limit of the cache in bytes. Patterns that are acquired at the time are never evicted, so this can temporarily be exceeded.
+ * @param seek_interval_ms @see VTPPatternCacheV1
+ * @param lock A lock to guard all cache operations with, or NULL if the cache will only be used from a single thread. The structure will be copied.
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_cache_init_v1(VTPPatternCacheV1* cache, size_t n_buckets, size_t max_bytes, unsigned long seek_interval_ms, const VTPLockV1* lock);
+
+/**
+ * Frees all resources held by a pattern cache
+ *
+ * Make sure that none of its patterns are still acquired when calling this function.
+ *
+ * @param cache The cache to be destroyed
+ */
+void vtp_cache_destroy_v1(VTPPatternCacheV1* cache);
+
+/**
+ * Looks up a pattern in the cache, decoding and inserting it if it isn't cached yet
+ *
+ * The pattern stays valid until it is passed into vtp_cache_release_v1.
+ *
+ * @param cache The cache to look up the pattern in
+ * @param bytes The pattern in VTP Binary representation (i.e. big-endian instruction words). Note that the size of this must be at least 4*n_words.
+ * @param n_words The number of instruction words in bytes
+ * @param out Returns the cached pattern on success
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h. Patterns that fail to decode are not cached.
+ * VTP_BUFFER_TOO_SMALL if the pattern's seek index alone would exceed the cache's size limit.
+ * VTP_OUT_OF_MEMORY if the size of the pattern in bytes doesn't fit into a size_t.
+ */
+VTPError vtp_cache_acquire_v1(VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, const VTPCachedPatternV1** out);
+
+/**
+ * Hands back a pattern that was acquired by vtp_cache_acquire_v1
+ *
+ * @param cache The cache that the pattern was acquired from
+ * @param pattern The pattern to release. Must not be used anymore afterwards.
+ */
+void vtp_cache_release_v1(VTPPatternCacheV1* cache, const VTPCachedPatternV1* pattern);
+
+#endif
@@ -21,6 +21,30 @@
 #include <vtp/error.h>
 #include <vtp/instruction_types.h>
 
+/**
+ * The ways in which vtp_decode_instructions_lenient_v1 handles invalid instruction words
+ */
+enum eVTPRecoveryModeV1 {
+    /** Leave invalid words out of the output, so that it only contains the valid instructions */
+    VTP_RECOVERY_SKIP = 0,
+
+    /** Replace invalid words by a substitute instruction, so that output indices match input indices */
+    VTP_RECOVERY_SUBSTITUTE = 1
+};
+typedef enum eVTPRecoveryModeV1 VTPRecoveryModeV1;
+
+/**
+ * An invalid instruction word that has been encountered by vtp_decode_instructions_lenient_v1
+ */
+struct sVTPDecodeIssueV1 {
+    /** The index of the invalid word within the input array */
+    size_t index;
+
+    /** The error that decoding the word has yielded */
+    VTPError error;
+};
+typedef struct sVTPDecodeIssueV1 VTPDecodeIssueV1;
+
 /**
  * Decodes a VTPv1 binary instruction word
  *
@@ -50,6 +74,26 @@ VTPError vtp_encode_instruction_v1(const VTPInstructionV1* instruction, VTPInstr
  */
 VTPError vtp_decode_instructions_v1(const VTPInstructionWord instructions[], VTPInstructionV1 out[], size_t n);
 
+/**
+ * Decodes multiple VTPv1 binary instruction words, continuing past invalid ones
+ *
+ * Unlike vtp_decode_instructions_v1, this always processes all n words, so that all invalid words of
+ * a buffer can be found in a single pass. Decode large inputs in chunks and add the chunk offset to the
+ * reported indices.
+ *
+ * @param instructions @see vtp_decode_instruction_v1
+ * @param n The number of instruction words to be decoded. Also the number of slots in the output array.
+ * @param mode Whether invalid words are skipped or substituted in the output
+ * @param substitute The instruction to write in place of invalid words. Only used with VTP_RECOVERY_SUBSTITUTE.
+ * @param out An array to write the decoded instructions to
+ * @param n_out Returns the number of instructions that have been written to the output array
+ * @param issues An array to record the invalid words in, in ascending order of their index. May be NULL if max_issues is 0.
+ * @param max_issues The number of slots in the issues array. Further invalid words are counted, but not recorded.
+ * @param n_issues Returns the number of invalid words, which may be larger than max_issues
+ * @return VTP_OK if all words were valid, otherwise the error of the first invalid word
+ */
+VTPError vtp_decode_instructions_lenient_v1(const VTPInstructionWord instructions[], size_t n, VTPRecoveryModeV1 mode, const VTPInstructionV1* substitute, VTPInstructionV1 out[], size_t* n_out, VTPDecodeIssueV1 issues[], size_t max_issues, size_t* n_issues);
+
 /**
  * Encodes multiple VTPv1 instructions into binary instruction words
  *
@@ -60,6 +104,19 @@ VTPError vtp_decode_instructions_v1(const VTPInstructionWord instructions[], VTP
  */
 VTPError vtp_encode_instructions_v1(const VTPInstructionV1 instructions[], VTPInstructionWord out[], size_t n);
 
+/**
+ * Encodes multiple VTPv1 instructions directly into a VTP Binary byte array
+ *
+ * This is equivalent to vtp_encode_instructions_v1 followed by vtp_write_instruction_words,
+ * but packs and writes each instruction word in one pass, without an intermediate word array.
+ *
+ * @param instructions @see vtp_encode_instruction_v1
+ * @param out The byte array to write the big-endian instruction words to. Note that the size of this must be at least 4*n.
+ * @param n The number of instructions to be encoded
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h. On error, the instructions before the invalid one have already been written.
+ */
+VTPError vtp_encode_bytes_v1(const VTPInstructionV1 instructions[], unsigned char out[], size_t n);
+
 
 /**
  * Reads VTP Binary instruction words from a byte array
@@ -92,4 +149,12 @@ void vtp_write_instruction_words(size_t n_words, const VTPInstructionWord in[],
  */
 unsigned long vtp_get_time_offset_v1(const VTPInstructionV1* instruction);
 
+/**
+ * Calculates the time offset of a given VTPv1 instruction word, without decoding it first
+ *
+ * @param instruction The instruction word of which the time offset shall be calculated
+ * @return @see vtp_get_time_offset_v1
+ */
+unsigned long vtp_get_word_time_offset_v1(VTPInstructionWord instruction);
+
 #endif
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_EDIT_H
+#define LIBVTP_EDIT_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/instruction_types.h>
+
+/** The entry state of a segment that starts with all channels at zero, like a whole instruction stream */
+#define VTP_SEGMENT_STATE_ZERO ((size_t)-1)
+
+/** The entry state of a segment that keeps the channels as the segment before it left them. Cuts resolve it from the segments before. */
+#define VTP_SEGMENT_STATE_INHERIT ((size_t)-2)
+
+/**
+ * A section of a VTP instruction stream, referencing its instruction words without copying them
+ *
+ * The time increment of the first word is replaced by lead_ms, and the segment continues for
+ * tail_ms after its last word. This allows segments to start and end between instructions.
+ * The duration of the segment is computed once and cached, so that editing never has to look
+ * at the instruction words of segments that aren't cut.
+ *
+ * The channel state at the start of the segment is summarized by entry_state, so that the segment
+ * plays the same way wherever it is moved to, regardless of what was played before it.
+ */
+struct sVTPSegmentV1 {
+    /** The instruction words of the segment */
+    const VTPInstructionWord* words;
+
+    /** The number of instruction words in the words array */
+    size_t n_words;
+
+    /** The time from the start of the segment until its first word takes effect */
+    unsigned long lead_ms;
+
+    /** The time from the last word until the end of the segment */
+    unsigned long tail_ms;
+
+    /** The duration of the whole segment */
+    unsigned long duration_ms;
+
+    /**
+     * The index of the channel state at the start of the segment in the state storage of its edit list,
+     * or VTP_SEGMENT_STATE_ZERO or VTP_SEGMENT_STATE_INHERIT
+     */
+    size_t entry_state;
+};
+typedef struct sVTPSegmentV1 VTPSegmentV1;
+
+/**
+ * A sequence of segments that are played one after another
+ */
+struct sVTPEditListV1 {
+    /** The segments, in playing order */
+    VTPSegmentV1* segments;
+
+    /** The number of segments in the list */
+    size_t n_segments;
+
+    /** The number of slots in the segments array */
+    size_t max_segments;
+
+    /** The number of channels of the channel states. Instructions must not select channels beyond it. */
+    unsigned char n_channels;
+
+    /**
+     * The channel states that segments start with, each one made of n_channels amplitudes followed by
+     * n_channels frequencies.
+     */
+    unsigned int* states;
+
+    /** The number of channel states in use */
+    size_t n_states;
+
+    /** The number of channel states the states array has room for */
+    size_t max_states;
+};
+typedef struct sVTPEditListV1 VTPEditListV1;
+
+
+/**
+ * Initializes a segment that covers a whole instruction word array
+ *
+ * This is the only function that needs to look at every instruction word, in order to compute the duration.
+ * The segment starts with all channels at zero.
+ *
+ * @param segment The segment to be initialized
+ * @param words @see VTPSegmentV1
+ * @param n_words @see VTPSegmentV1
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_segment_init_v1(VTPSegmentV1* segment, const VTPInstructionWord words[], size_t n_words);
+
+/**
+ * Initializes an empty edit list
+ *
+ * @param list The edit list to be initialized
+ * @param segment_storage @see VTPEditListV1
+ * @param max_segments @see VTPEditListV1
+ * @param n_channels @see VTPEditListV1
+ * @param state_storage An array of 2 * n_channels * max_states values. A state is needed whenever a cut splits a segment after its first instruction word, or pads the list after instruction words.
+ * @param max_states @see VTPEditListV1
+ */
+void vtp_edit_init_v1(VTPEditListV1* list, VTPSegmentV1 segment_storage[], size_t max_segments, unsigned char n_channels, unsigned int state_storage[], size_t max_states);
+
+/**
+ * Calculates the duration of all segments of an edit list
+ *
+ * @param list The edit list
+ * @return The duration in milliseconds
+ */
+unsigned long vtp_edit_duration_v1(const VTPEditListV1* list);
+
+/**
+ * Appends a segment to the end of an edit list
+ *
+ * @param list The edit list
+ * @param segment The segment to be appended. It is copied into the list.
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the list is full
+ */
+VTPError vtp_edit_append_v1(VTPEditListV1* list, const VTPSegmentV1* segment);
+
+/**
+ * Cuts an edit list at the given time, so that a segment starts there
+ *
+ * Only the segment that contains the given time is split, which takes time proportional to its number of
+ * instruction words. Instructions at exactly the given time belong to the second part, which starts with
+ * the channel state that the first part leaves behind. If the given time is after the end of the list,
+ * silence with the channel state at the end of the list is appended up until the given time.
+ *
+ * @param list The edit list
+ * @param at_ms The time to cut at
+ * @param index Returns the index of the segment that starts at the given time, or n_segments if the list ends there. May be NULL.
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the list or its state storage is full, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_edit_cut_v1(VTPEditListV1* list, unsigned long at_ms, size_t* index);
+
+/**
+ * Inserts a segment at the given time, delaying everything after it by the duration of the segment
+ *
+ * Everything after the inserted segment plays with the channel state it had at the given time.
+ *
+ * @param list The edit list
+ * @param at_ms The time to insert at, @see vtp_edit_cut_v1
+ * @param segment The segment to be inserted. It is copied into the list.
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the list or its state storage is full, in which case the list might have been cut at the given time, which doesn't change what it plays. Otherwise an error code as defined in vtp/error.h.
+ */
+VTPError vtp_edit_insert_v1(VTPEditListV1* list, unsigned long at_ms, const VTPSegmentV1* segment);
+
+/**
+ * Loops a section of an edit list, delaying everything after it accordingly
+ *
+ * Every iteration starts with the channel state at from_ms, and everything after the section plays
+ * with the channel state at to_ms, also when the section is removed.
+ *
+ * @param list The edit list
+ * @param from_ms The start of the section
+ * @param to_ms The end of the section. Must not be before from_ms.
+ * @param n_times The number of times the section is played. Passing 0 removes the section.
+ * @return @see vtp_edit_insert_v1
+ */
+VTPError vtp_edit_repeat_v1(VTPEditListV1* list, unsigned long from_ms, unsigned long to_ms, size_t n_times);
+
+/**
+ * Writes the instruction words of all segments of an edit list into one array
+ *
+ * Folding the output yields the same results as folding the instruction words of all segments
+ * one after another, with each one cut at its lead and tail times. At the start of each segment,
+ * set instructions are added for the channels that differ from the entry state of the segment.
+ * Time increments between set instructions are re-encoded, so consecutive time instructions are
+ * merged in the output.
+ *
+ * @param list The edit list. It isn't modified, so several lists can be flattened at once.
+ * @param state An array of 2 * n_channels values, which keeps track of the channel state of the output
+ * @param out The array to write the instruction words to
+ * @param max_out The number of slots in the out array
+ * @param n_out Returns the number of instruction words that have been written
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the out array is too small, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_edit_flatten_v1(const VTPEditListV1* list, unsigned int state[], VTPInstructionWord out[], size_t max_out, size_t* n_out);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_ENCODE_H
+#define LIBVTP_ENCODE_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+#include <vtp/instruction_types.h>
+
+/**
+ * A block of uniformly sampled amplitude and frequency values of all channels of a display
+ *
+ * The samples are stored planar, i.e. the samples of channel c (counting from 1) start at index (c - 1) * channel_stride.
+ * Use channel_stride = n_samples for densely packed samples, or point into a larger block to encode only part of it.
+ */
+struct sVTPSamplesV1 {
+    /** The number of samples per channel */
+    size_t n_samples;
+
+    /** The distance between the first samples of two consecutive channels */
+    size_t channel_stride;
+
+    /** The amplitude samples of all channels */
+    const unsigned int* amplitudes;
+
+    /** The frequency samples of all channels */
+    const unsigned int* frequencies;
+
+    /** The time of the first sample, in milliseconds */
+    unsigned long start_ms;
+
+    /** The time between two consecutive samples, in milliseconds */
+    unsigned int sample_ms;
+};
+typedef struct sVTPSamplesV1 VTPSamplesV1;
+
+
+/**
+ * Encodes sampled amplitudes and frequencies into a minimal sequence of VTPv1 instruction words
+ *
+ * Only values that differ from what a display has already been set to are encoded. If all channels
+ * change to the same value, a single broadcast (ch*) is used. Pauses of up to 1023 ms are encoded in
+ * the time offset of the next instruction, longer ones as separate time instructions.
+ *
+ * The state accumulator tracks what a display that folds the output is set to. Pass in an accumulator
+ * with all values and milliseconds_elapsed set to 0 for a new pattern, or pass the same accumulator
+ * again to continue encoding with the next block of samples.
+ *
+ * Folding the output up until the time of any sample yields values that deviate from the samples by
+ * at most the given tolerance. Sample values above 1023 are clamped to 1023.
+ *
+ * @param state The state of a display after folding the instruction words that have been encoded so far. Its n_channels field determines the number of channels to be encoded.
+ * @param samples The samples to be encoded. Their times must not be before state->milliseconds_elapsed.
+ * @param tolerance The deviation from the current state up to which a sample is considered unchanged. Use 0 for lossless encoding.
+ * @param out The array to write the instruction words to
+ * @param max_words The number of slots in the out array
+ * @param n_words Returns the number of instruction words that have been written
+ * @param n_samples_encoded Returns the number of samples that have been encoded completely. May be NULL.
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the out array was full before all samples were encoded, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_encode_samples_v1(VTPAccumulatorV1* state, const VTPSamplesV1* samples, unsigned int tolerance, VTPInstructionWord out[], size_t max_words, size_t* n_words, size_t* n_samples_encoded);
+
+#endif
@@ -20,7 +20,11 @@
 enum eVTPError {
     VTP_OK,
     VTP_CHANNEL_OUT_OF_RANGE,
-    VTP_INVALID_INSTRUCTION_CODE
+    VTP_INVALID_INSTRUCTION_CODE,
+    VTP_OUT_OF_MEMORY,
+    VTP_BUFFER_TOO_SMALL,
+    VTP_READ_ERROR,
+    VTP_TIME_OUT_OF_RANGE
 };
 
 typedef enum eVTPError VTPError;
@@ -40,6 +40,68 @@ struct sVTPAccumulatorV1 {
 };
 typedef struct sVTPAccumulatorV1 VTPAccumulatorV1;
 
+/**
+ * The state of a single channel of a VTPNarrowAccumulatorV1
+ */
+struct sVTPChannelStateV1 {
+    /** The amplitude of the channel */
+    unsigned short amplitude;
+
+    /** The frequency of the channel */
+    unsigned short frequency;
+};
+typedef struct sVTPChannelStateV1 VTPChannelStateV1;
+
+/**
+ * A more compact variant of VTPAccumulatorV1.
+ *
+ * Instead of two separate arrays of unsigned int, the amplitude and frequency of each channel
+ * are stored next to each other as unsigned short, which is sufficient for the 10 bit parameters of VTPv1.
+ * This halves the memory footprint of the accumulator and makes any update of a single channel
+ * touch only one cache line.
+ */
+struct sVTPNarrowAccumulatorV1 {
+    /** The number of channels the display supports. Also the length of the channels field */
+    unsigned char n_channels;
+
+    /** The state of each channel, indexed by channel number - 1 */
+    VTPChannelStateV1* channels;
+
+    /** Keeps track of time when applying VTP instructions during fold */
+    unsigned long milliseconds_elapsed;
+};
+typedef struct sVTPNarrowAccumulatorV1 VTPNarrowAccumulatorV1;
+
+/**
+ * A read position within an array of instruction words, for folding it step by step
+ */
+struct sVTPWordCursorV1 {
+    /** The instruction words to be folded */
+    const VTPInstructionWord* words;
+
+    /** The number of instruction words in the words array */
+    size_t n_words;
+
+    /** The index of the next instruction word to be folded */
+    size_t position;
+};
+typedef struct sVTPWordCursorV1 VTPWordCursorV1;
+
+/**
+ * A resumable position within VTP Binary Code that is folded window by window,
+ * e.g. because it is too large to be held in memory at once
+ *
+ * To resume folding later on, it is sufficient to keep the byte offset along with the state of the accumulator.
+ */
+struct sVTPStreamCursorV1 {
+    /** The accumulator that the instruction words are folded into */
+    VTPAccumulatorV1* accumulator;
+
+    /** The offset of the next instruction word to be folded, in bytes from the start of the VTP Binary Code */
+    unsigned long byte_offset;
+};
+typedef struct sVTPStreamCursorV1 VTPStreamCursorV1;
+
 /**
  * Applies each given VTPv1 instruction to the accumulator, one after another
  *
@@ -78,4 +140,125 @@ VTPError vtp_fold_single_v1(VTPAccumulatorV1* accumulator, const VTPInstructionV
  */
 VTPError vtp_fold_until_v1(VTPAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions, unsigned long until_ms, size_t* n_processed);
 
+/**
+ * Applies each given VTPv1 instruction word to the accumulator, without decoding them first
+ *
+ * This behaves exactly like decoding the given words and passing them into vtp_fold_v1,
+ * but needs neither a buffer for the decoded instructions nor a separate pass over them.
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param words The VTPv1 instruction words that are to be applied to the accumulator.
+ * @param n_words The number of instruction words given in the words array.
+ * @return @see vtp_fold_v1
+ */
+VTPError vtp_fold_words_v1(VTPAccumulatorV1* accumulator, const VTPInstructionWord words[], size_t n_words);
+
+/**
+ * Folds VTPv1 instruction words, up until the given target time, without decoding them first
+ *
+ * This behaves exactly like decoding the given words and passing them into vtp_fold_until_v1,
+ * but decodes and applies each word in one step, dispatching on its instruction code only once.
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param words The VTPv1 instruction words that are to be applied to the accumulator.
+ * @param n_words The number of instruction words given in the words array.
+ * @param until_ms @see vtp_fold_until_v1
+ * @param n_processed @see vtp_fold_until_v1
+ * @return @see vtp_fold_until_v1
+ */
+VTPError vtp_fold_words_until_v1(VTPAccumulatorV1* accumulator, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed);
+
+/**
+ * Applies VTP Binary instruction words from a byte array to the accumulator
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param bytes A byte array containing VTP Binary instruction words, as big endian. Note that the size of this must be at least 4*n_words.
+ * @param n_words The number of instruction words given in the bytes array.
+ * @return @see vtp_fold_v1
+ */
+VTPError vtp_fold_bytes_v1(VTPAccumulatorV1* accumulator, const unsigned char bytes[], size_t n_words);
+
+/**
+ * Folds VTP Binary instruction words from a byte array, up until the given target time
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param bytes @see vtp_fold_bytes_v1
+ * @param n_words @see vtp_fold_bytes_v1
+ * @param until_ms @see vtp_fold_until_v1
+ * @param n_processed Returns the count of instruction words that actually have been applied to the accumulator.
+ * @return @see vtp_fold_until_v1
+ */
+VTPError vtp_fold_bytes_until_v1(VTPAccumulatorV1* accumulator, const unsigned char bytes[], size_t n_words, unsigned long until_ms, size_t* n_processed);
+
+/**
+ * Folds the instruction words of a window of VTP Binary Code up until the given target time, continuing at the cursor
+ *
+ * The window is a slice of the VTP Binary Code that contains the cursor's byte offset, e.g. a chunk that
+ * has been read from a file or a memory mapped region of it. Only whole instruction words within the window
+ * are folded, so the next window should start at the cursor's byte offset or before it.
+ *
+ * @param cursor The stream cursor. Its byte offset is advanced past all instruction words that have been folded.
+ * @param window The bytes of the window
+ * @param window_offset The offset of the window's first byte, from the start of the VTP Binary Code. Must be a multiple of 4.
+ * @param window_size The number of bytes in the window
+ * @param until_ms @see vtp_fold_until_v1
+ * @param window_exhausted Returns 1 if all instruction words of the window have been folded without reaching the target time, so that folding has to continue with the next window, otherwise 0
+ * @return VTP_BUFFER_TOO_SMALL if the window starts after the cursor's byte offset, otherwise @see vtp_fold_until_v1
+ */
+VTPError vtp_fold_window_until_v1(VTPStreamCursorV1* cursor, const unsigned char window[], unsigned long window_offset, size_t window_size, unsigned long until_ms, int* window_exhausted);
+
+/**
+ * Folds instruction words in a single pass and records the state of the accumulator at each of the given times
+ *
+ * Row k of the output is the state after folding up until times_ms[k], i.e. the same state that
+ * vtp_fold_words_until_v1 would leave when called with that target time. Its values are written to
+ * amplitudes[k * n_channels ...] and frequencies[k * n_channels ...]. Each row starts out as a bulk copy
+ * of the previous one, so only the channels that are set in between are written individually.
+ *
+ * To split a large set of times across threads, give each thread its own accumulator and cursor, brought up
+ * to its first time, e.g. by folding up until it or by resuming from a seek point (@see vtp_build_seek_index_v1).
+ *
+ * @param accumulator @see vtp_fold_v1. Afterwards, it holds the state of the last row that has been written.
+ * @param cursor The instruction words to be folded. Its position is advanced past all words that have been folded.
+ * @param times_ms The times to record the state at, in ascending order. Times before the accumulator's time yield its current state.
+ * @param n_times The number of times given in the times_ms array
+ * @param amplitudes Returns the amplitudes. Must have room for n_times * n_channels entries.
+ * @param frequencies Returns the frequencies. Must have room for n_times * n_channels entries.
+ * @param n_written Returns the number of rows that have been written completely
+ * @return @see vtp_fold_until_v1. On error, no rows after the failing one are written.
+ */
+VTPError vtp_fold_words_at_v1(VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, const unsigned long times_ms[], size_t n_times, unsigned int amplitudes[], unsigned int frequencies[], size_t* n_written);
+
+
+/**
+ * Variant of vtp_fold_v1 for narrow accumulators
+ *
+ * @param accumulator A narrow accumulator structure. Make sure you initialize all of its fields, if you pass it into this function for the first time.
+ * @param instructions @see vtp_fold_v1
+ * @param n_instructions @see vtp_fold_v1
+ * @return @see vtp_fold_v1
+ */
+VTPError vtp_fold_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions);
+
+/**
+ * Variant of vtp_fold_single_v1 for narrow accumulators
+ *
+ * @param accumulator @see vtp_fold_narrow_v1
+ * @param instruction @see vtp_fold_single_v1
+ * @return @see vtp_fold_single_v1
+ */
+VTPError vtp_fold_single_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1* instruction);
+
+/**
+ * Variant of vtp_fold_until_v1 for narrow accumulators
+ *
+ * @param accumulator @see vtp_fold_narrow_v1
+ * @param instructions @see vtp_fold_until_v1
+ * @param n_instructions @see vtp_fold_until_v1
+ * @param until_ms @see vtp_fold_until_v1
+ * @param n_processed @see vtp_fold_until_v1
+ * @return @see vtp_fold_until_v1
+ */
+VTPError vtp_fold_until_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions, unsigned long until_ms, size_t* n_processed);
+
 #endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_FOLD_FIXED_H
+#define LIBVTP_FOLD_FIXED_H
+
+#include <stddef.h>
+#include <vtp/codec.h>
+#include <vtp/error.h>
+#include <vtp/instruction_types.h>
+
+/*
+ * Fold variants that are specialized for displays with a fixed number of channels.
+ *
+ * With the channel count known at compile time, the channel arrays live inline in the accumulator,
+ * broadcasts become loops of constant length that compilers unroll fully, and the range check of
+ * channel selects compares against a constant. Use them like this:
+ *
+ *     In a header:   VTP_DECLARE_FIXED_FOLD_V1(Display16, display16, 16)
+ *     In one .c file: VTP_DEFINE_FIXED_FOLD_V1(Display16, display16, 16)
+ *
+ * This declares the accumulator type Display16 (struct sDisplay16) and the functions
+ * display16_fold_single_v1, display16_fold_v1, display16_fold_until_v1, display16_fold_words_v1 and
+ * display16_fold_words_until_v1, which behave exactly like their vtp_*_v1 counterparts in fold.h.
+ * Zero-initialize the accumulator before its first use.
+ */
+
+/**
+ * Declares the accumulator type and fold functions for displays with channel_count channels
+ *
+ * @param type The name of the accumulator type. The struct is called s ## type.
+ * @param prefix The prefix of the function names
+ * @param channel_count The number of channels, between 1 and 255
+ */
+#define VTP_DECLARE_FIXED_FOLD_V1(type, prefix, channel_count) \
+    struct s##type { \
+        unsigned int amplitudes[channel_count]; \
+        unsigned int frequencies[channel_count]; \
+        unsigned long milliseconds_elapsed; \
+    }; \
+    typedef struct s##type type; \
+    \
+    VTPError prefix##_fold_single_v1(type* accumulator, const VTPInstructionV1* instruction); \
+    VTPError prefix##_fold_v1(type* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions); \
+    VTPError prefix##_fold_until_v1(type* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions, unsigned long until_ms, size_t* n_processed); \
+    VTPError prefix##_fold_words_v1(type* accumulator, const VTPInstructionWord words[], size_t n_words); \
+    VTPError prefix##_fold_words_until_v1(type* accumulator, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed);
+
+/**
+ * Defines the fold functions declared by VTP_DECLARE_FIXED_FOLD_V1. Use the same arguments.
+ */
+#define VTP_DEFINE_FIXED_FOLD_V1(type, prefix, channel_count) \
+    static VTPError prefix##_set_v1(unsigned int target[channel_count], unsigned int new_value, unsigned int channel_select) { \
+        size_t i; \
+        \
+        if (channel_select == 0) { \
+            for (i=0; i < (channel_count); i++) \
+                target[i] = new_value; \
+        } \
+        else if (channel_select > (channel_count)) { \
+            return VTP_CHANNEL_OUT_OF_RANGE; \
+        } \
+        else { \
+            target[channel_select - 1] = new_value; \
+        } \
+        \
+        return VTP_OK; \
+    } \
+    \
+    static VTPError prefix##_fold_word_v1(type* accumulator, VTPInstructionWord word) { \
+        switch ((word & 0xF0000000u) >> 28u) { \
+            case VTP_INST_INCREMENT_TIME: \
+                accumulator->milliseconds_elapsed += word & 0x0FFFFFFFu; \
+                return VTP_OK; \
+            case VTP_INST_SET_FREQUENCY: \
+                accumulator->milliseconds_elapsed += (word & 0x000FFC00u) >> 10u; \
+                return prefix##_set_v1(accumulator->frequencies, (unsigned int)(word & 0x3FFu), (unsigned int)((word & 0x0FF00000u) >> 20u)); \
+            case VTP_INST_SET_AMPLITUDE: \
+                accumulator->milliseconds_elapsed += (word & 0x000FFC00u) >> 10u; \
+                return prefix##_set_v1(accumulator->amplitudes, (unsigned int)(word & 0x3FFu), (unsigned int)((word & 0x0FF00000u) >> 20u)); \
+            default: \
+                return VTP_INVALID_INSTRUCTION_CODE; \
+        } \
+    } \
+    \
+    VTPError prefix##_fold_single_v1(type* accumulator, const VTPInstructionV1* instruction) { \
+        switch (instruction->code) { \
+            case VTP_INST_INCREMENT_TIME: \
+                accumulator->milliseconds_elapsed += instruction->params.format_a.parameter_a; \
+                return VTP_OK; \
+            case VTP_INST_SET_FREQUENCY: \
+                accumulator->milliseconds_elapsed += instruction->params.format_b.time_offset; \
+                return prefix##_set_v1(accumulator->frequencies, instruction->params.format_b.parameter_a, instruction->params.format_b.channel_select); \
+            case VTP_INST_SET_AMPLITUDE: \
+                accumulator->milliseconds_elapsed += instruction->params.format_b.time_offset; \
+                return prefix##_set_v1(accumulator->amplitudes, instruction->params.format_b.parameter_a, instruction->params.format_b.channel_select); \
+            default: \
+                return VTP_INVALID_INSTRUCTION_CODE; \
+        } \
+    } \
+    \
+    VTPError prefix##_fold_v1(type* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions) { \
+        size_t i; \
+        VTPError err; \
+        \
+        for (i=0; i < n_instructions; i++) { \
+            if ((err = prefix##_fold_single_v1(accumulator, instructions + i)) != VTP_OK) \
+                return err; \
+        } \
+        \
+        return VTP_OK; \
+    } \
+    \
+    VTPError prefix##_fold_until_v1(type* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions, unsigned long until_ms, size_t* n_processed) { \
+        size_t i; \
+        VTPError err; \
+        \
+        err = VTP_OK; \
+        \
+        for (i=0; i < n_instructions && accumulator->milliseconds_elapsed + vtp_get_time_offset_v1(instructions + i) <= until_ms; i++) { \
+            if ((err = prefix##_fold_single_v1(accumulator, instructions + i)) != VTP_OK) \
+                break; \
+        } \
+        \
+        if (n_processed) \
+            *n_processed = i; \
+        \
+        return err; \
+    } \
+    \
+    VTPError prefix##_fold_words_v1(type* accumulator, const VTPInstructionWord words[], size_t n_words) { \
+        size_t i; \
+        VTPError err; \
+        \
+        for (i=0; i < n_words; i++) { \
+            if ((err = prefix##_fold_word_v1(accumulator, words[i])) != VTP_OK) \
+                return err; \
+        } \
+        \
+        return VTP_OK; \
+    } \
+    \
+    VTPError prefix##_fold_words_until_v1(type* accumulator, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed) { \
+        size_t i; \
+        VTPError err; \
+        \
+        err = VTP_OK; \
+        \
+        for (i=0; i < n_words && accumulator->milliseconds_elapsed + vtp_get_word_time_offset_v1(words[i]) <= until_ms; i++) { \
+            if ((err = prefix##_fold_word_v1(accumulator, words[i])) != VTP_OK) \
+                break; \
+        } \
+        \
+        if (n_processed) \
+            *n_processed = i; \
+        \
+        return err; \
+    }
+
+#endif
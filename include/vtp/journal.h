@@ -0,0 +1,118 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_JOURNAL_H
+#define LIBVTP_JOURNAL_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+#include <vtp/instruction_types.h>
+
+/**
+ * The information that is needed to undo an instruction word, or part of it
+ */
+struct sVTPJournalEntryV1 {
+    /**
+     * The instruction word that has been folded. Its time offset is subtracted when undoing it.
+     * For broadcasts that are journaled per channel, this selects the single channel, and only the first entry keeps the time offset.
+     */
+    VTPInstructionWord word;
+
+    /** The value of the selected channel(s) before the word has been folded */
+    unsigned int previous_value;
+
+    /** 1 if the next entry belongs to the same instruction word, otherwise 0 */
+    unsigned char continued;
+};
+typedef struct sVTPJournalEntryV1 VTPJournalEntryV1;
+
+/**
+ * A ring buffer of journal entries, recorded during fold, that allows stepping backwards in time
+ *
+ * Set instructions are journaled with the previous value of their channel. Broadcasts take a single entry
+ * if all channels had the same value before, otherwise one entry per channel. Time instructions only
+ * take an entry for their time offset. Once the journal is full, the entries of the oldest instruction
+ * words are overwritten, so it always covers the most recent ones.
+ */
+struct sVTPJournalV1 {
+    /** The ring buffer of entries */
+    VTPJournalEntryV1* entries;
+
+    /** The number of entries in the ring buffer. Must be at least the number of channels of the journaled accumulator. */
+    size_t capacity;
+
+    /** The index of the oldest entry in the ring buffer */
+    size_t first;
+
+    /** The number of entries currently in the ring buffer */
+    size_t n_entries;
+};
+typedef struct sVTPJournalV1 VTPJournalV1;
+
+/**
+ * Initializes an empty journal
+ *
+ * @param journal The journal to be initialized
+ * @param entries An array of capacity entries that is used as the journal's ring buffer
+ * @param capacity @see VTPJournalV1
+ */
+void vtp_journal_init_v1(VTPJournalV1* journal, VTPJournalEntryV1 entries[], size_t capacity);
+
+/**
+ * Variant of vtp_fold_words_until_v1 that records each folded instruction word in a journal
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param journal The journal to record the folded instruction words in
+ * @param words @see vtp_fold_words_until_v1
+ * @param n_words @see vtp_fold_words_until_v1
+ * @param until_ms @see vtp_fold_until_v1
+ * @param n_processed @see vtp_fold_until_v1
+ * @return @see vtp_fold_until_v1. An erroneous instruction word affects the accumulator like in vtp_fold_words_until_v1,
+ * but is not journaled, so the journal can only be used to unfold an accumulator that has been folded without errors.
+ */
+VTPError vtp_fold_words_until_journaled_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed);
+
+/**
+ * Undoes the most recently folded instruction words, using the journal
+ *
+ * The cost is proportional to the number of channels changed by the undone words, independently of
+ * how long the pattern has been folded. The undone words are removed from the journal.
+ *
+ * @param accumulator The accumulator that the journaled instruction words have been folded into
+ * @param journal The journal
+ * @param n_words The number of instruction words to be undone
+ * @param n_undone Returns the number of instruction words that have been undone, e.g. to move a cursor back by
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the journal has run out of entries before n_words have been undone
+ */
+VTPError vtp_unfold_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, size_t n_words, size_t* n_undone);
+
+/**
+ * Undoes the most recently folded instruction words, back until the given target time
+ *
+ * Afterwards, the accumulator is in the same state as if it had been folded from the start using
+ * vtp_fold_until_v1 with the same target time.
+ *
+ * @param accumulator @see vtp_unfold_v1
+ * @param journal @see vtp_unfold_v1
+ * @param until_ms The target time in milliseconds
+ * @param n_undone @see vtp_unfold_v1
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the journal doesn't reach back to the target time. In that case, fold again from the start or from a snapshot.
+ */
+VTPError vtp_unfold_until_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, unsigned long until_ms, size_t* n_undone);
+
+#endif
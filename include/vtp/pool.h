@@ -0,0 +1,158 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_POOL_H
+#define LIBVTP_POOL_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+#include <vtp/instruction_types.h>
+
+/** The alignment of the channel arrays handed out by an accumulator pool, in bytes */
+#define VTP_CACHE_LINE_SIZE (64)
+
+/**
+ * A bump allocator for instruction and instruction word buffers.
+ *
+ * Allocations are served from a single block of memory and cannot be freed individually -
+ * instead, the whole arena is reset at once.
+ */
+struct sVTPArenaV1 {
+    /** The block of memory that allocations are served from */
+    unsigned char* memory;
+
+    /** The size of memory, in bytes */
+    size_t capacity;
+
+    /** The number of bytes currently allocated from memory */
+    size_t n_used;
+
+    /** Whether memory has been allocated by vtp_arena_init_v1 and is to be freed by vtp_arena_destroy_v1 */
+    int owns_memory;
+};
+typedef struct sVTPArenaV1 VTPArenaV1;
+
+/**
+ * A pool of accumulators of equal channel count, whose channel arrays all live in one contiguous block of memory.
+ *
+ * The amplitudes and frequencies of each accumulator are stored next to each other, starting at
+ * a VTP_CACHE_LINE_SIZE boundary.
+ */
+struct sVTPAccumulatorPoolV1 {
+    /** The number of accumulators in the pool */
+    size_t n_accumulators;
+
+    /** The number of channels of each accumulator */
+    unsigned char n_channels;
+
+    /** Bookkeeping of the pool - do not touch */
+    VTPAccumulatorV1* accumulators;
+    size_t* free_list;
+    unsigned char* acquired;
+    size_t n_free;
+    size_t stride;
+    void* block;
+    unsigned int* channels;
+};
+typedef struct sVTPAccumulatorPoolV1 VTPAccumulatorPoolV1;
+
+
+/**
+ * Initializes an arena
+ *
+ * @param arena The arena to be initialized
+ * @param memory The block of memory to serve allocations from, aligned like memory returned by malloc. Pass NULL to let the arena allocate it.
+ * @param capacity The size of memory, in bytes. Must not be zero.
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if capacity is zero, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_arena_init_v1(VTPArenaV1* arena, void* memory, size_t capacity);
+
+/**
+ * Frees the memory of an arena, if it has been allocated by vtp_arena_init_v1
+ *
+ * @param arena The arena to be destroyed
+ */
+void vtp_arena_destroy_v1(VTPArenaV1* arena);
+
+/**
+ * Allocates an array of instructions from an arena
+ *
+ * @param arena The arena to allocate from
+ * @param n The number of instructions to allocate
+ * @return The allocated array, or NULL if the arena is exhausted
+ */
+VTPInstructionV1* vtp_arena_alloc_instructions_v1(VTPArenaV1* arena, size_t n);
+
+/**
+ * Allocates an array of instruction words from an arena
+ *
+ * @param arena The arena to allocate from
+ * @param n The number of instruction words to allocate
+ * @return The allocated array, or NULL if the arena is exhausted
+ */
+VTPInstructionWord* vtp_arena_alloc_words_v1(VTPArenaV1* arena, size_t n);
+
+/**
+ * Releases all allocations of an arena at once
+ *
+ * @param arena The arena to be reset
+ */
+void vtp_arena_reset_v1(VTPArenaV1* arena);
+
+
+/**
+ * Initializes an accumulator pool, allocating the memory for all of its accumulators in one go
+ *
+ * @param pool The pool to be initialized
+ * @param n_accumulators The number of accumulators in the pool
+ * @param n_channels The number of channels of each accumulator
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h
+ */
+VTPError vtp_accumulator_pool_init_v1(VTPAccumulatorPoolV1* pool, size_t n_accumulators, unsigned char n_channels);
+
+/**
+ * Frees all memory of an accumulator pool, including all of its accumulators
+ *
+ * @param pool The pool to be destroyed
+ */
+void vtp_accumulator_pool_destroy_v1(VTPAccumulatorPoolV1* pool);
+
+/**
+ * Hands out an accumulator from the pool
+ *
+ * @param pool The pool to take the accumulator from
+ * @return An accumulator with all amplitudes, frequencies and milliseconds_elapsed set to zero, or NULL if the pool is exhausted
+ */
+VTPAccumulatorV1* vtp_accumulator_pool_acquire_v1(VTPAccumulatorPoolV1* pool);
+
+/**
+ * Hands back an accumulator to the pool
+ *
+ * @param pool The pool that the accumulator has been acquired from
+ * @param accumulator The accumulator to hand back. Must not be used anymore afterwards. Accumulators that are not currently acquired from the pool are ignored.
+ */
+void vtp_accumulator_pool_release_v1(VTPAccumulatorPoolV1* pool, VTPAccumulatorV1* accumulator);
+
+/**
+ * Hands back all accumulators to the pool at once
+ *
+ * @param pool The pool to be reset
+ */
+void vtp_accumulator_pool_reset_v1(VTPAccumulatorPoolV1* pool);
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_READER_H
+#define LIBVTP_READER_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+#include <vtp/instruction_types.h>
+
+/**
+ * Fetches the next bytes of VTP Binary Code from a source, e.g. flash memory, a file or a socket
+ *
+ * @param source The source that has been passed to vtp_reader_init_v1
+ * @param bytes The buffer to write the fetched bytes to
+ * @param max_bytes The number of bytes that fit into bytes. Fetching fewer bytes is fine, even ones that end within an instruction word.
+ * @param n_bytes Returns the number of bytes that have been fetched. 0 signals the end of the source.
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h, e.g. VTP_READ_ERROR, which is passed on to the caller of the reader
+ */
+typedef VTPError (*VTPFetchV1)(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes);
+
+/**
+ * Pulls VTP Binary instruction words from a source as they are needed, through a small buffer
+ *
+ * This lets instruction words be decoded or folded without ever holding the whole VTP Binary Code in RAM.
+ * Initialize it with vtp_reader_init_v1 or vtp_reader_init_memory_v1.
+ */
+struct sVTPReaderV1 {
+    /** The function that fetches more bytes. NULL for readers of memory. */
+    VTPFetchV1 fetch;
+
+    /** The source that is passed to fetch */
+    void* source;
+
+    /** The buffer that fetched bytes are written to */
+    unsigned char* buffer;
+
+    /** The size of buffer in bytes */
+    size_t buffer_size;
+
+    /** The bytes that are currently available. Points into buffer, or to the memory of a memory reader. */
+    const unsigned char* bytes;
+
+    /** The number of valid bytes in the bytes field */
+    size_t n_bytes;
+
+    /** The position of the next instruction word within the bytes field */
+    size_t position;
+
+    /** The index of the next instruction word, counted from the start of the source */
+    unsigned long word_index;
+
+    /** Whether fetch has signaled the end of the source */
+    int end_of_source;
+};
+typedef struct sVTPReaderV1 VTPReaderV1;
+
+/**
+ * Initializes a reader that pulls bytes from a fetch callback
+ *
+ * @param reader The reader to be initialized
+ * @param fetch @see VTPFetchV1
+ * @param source Passed on to fetch, e.g. a file or the state of a flash memory address
+ * @param buffer A buffer for bytes that have been fetched, but not yet decoded or folded. Bigger buffers call fetch less often.
+ * @param buffer_size The size of buffer in bytes. Must be at least 4.
+ */
+void vtp_reader_init_v1(VTPReaderV1* reader, VTPFetchV1 fetch, void* source, unsigned char buffer[], size_t buffer_size);
+
+/**
+ * Initializes a reader of VTP Binary Code that is already in memory, which reads it in place without copying it
+ *
+ * @param reader The reader to be initialized
+ * @param bytes The VTP Binary Code. Must stay valid as long as the reader is used.
+ * @param n_bytes The size of the VTP Binary Code in bytes
+ */
+void vtp_reader_init_memory_v1(VTPReaderV1* reader, const unsigned char bytes[], size_t n_bytes);
+
+/**
+ * Pulls and decodes instruction words, until max_instructions have been decoded or the source has ended
+ *
+ * @param reader The reader
+ * @param out The array to write the decoded instructions to
+ * @param max_instructions The number of slots in the out array
+ * @param n_decoded Returns the number of instructions that have been decoded. If this is less than max_instructions without an error, the source has ended.
+ * @return VTP_OK on success, VTP_READ_ERROR if the source ends within an instruction word, otherwise an error code as defined in vtp/error.h. The erroneous word is not consumed.
+ */
+VTPError vtp_read_instructions_v1(VTPReaderV1* reader, VTPInstructionV1 out[], size_t max_instructions, size_t* n_decoded);
+
+/**
+ * Pulls instruction words and folds them, up until the given target time
+ *
+ * This behaves like vtp_fold_until_v1 on all instructions of the source. The first instruction word
+ * that is not due yet stays in the reader, so that folding can be continued with a later target time.
+ *
+ * @param accumulator @see vtp_fold_v1
+ * @param reader The reader
+ * @param until_ms @see vtp_fold_until_v1
+ * @param n_processed Returns the count of instruction words that have been applied to the accumulator. May be NULL.
+ * @return @see vtp_read_instructions_v1
+ */
+VTPError vtp_fold_reader_until_v1(VTPAccumulatorV1* accumulator, VTPReaderV1* reader, unsigned long until_ms, size_t* n_processed);
+
+/**
+ * Checks whether all instruction words of the source have been consumed
+ *
+ * As the end of a source is only noticed when fetching from it, this can only return 1
+ * after a call to vtp_read_instructions_v1 or vtp_fold_reader_until_v1 has run into the end.
+ *
+ * @param reader The reader
+ * @return 1 if the source has ended and all of its instruction words have been consumed, otherwise 0
+ */
+int vtp_reader_at_end_v1(const VTPReaderV1* reader);
+
+#endif
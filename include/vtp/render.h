@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_RENDER_H
+#define LIBVTP_RENDER_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+
+/**
+ * The ways in which a renderer moves from one set-point of a channel to the next
+ */
+enum eVTPRampModeV1 {
+    /** Jump to the new value immediately, exactly like the accumulator does */
+    VTP_RAMP_NONE = 0,
+
+    /** Move to the new value in equal steps, arriving after the ramp time */
+    VTP_RAMP_LINEAR = 1,
+
+    /** Approach the new value like a one-pole low pass filter, whose time constant is the ramp time */
+    VTP_RAMP_EXPONENTIAL = 2
+};
+typedef enum eVTPRampModeV1 VTPRampModeV1;
+
+/**
+ * The rendering state of a single parameter (amplitude or frequency) of a channel
+ */
+struct sVTPRampStateV1 {
+    /** The value that is currently output, as fixed point number with 10 fractional bits */
+    long value;
+
+    /** The change of value per frame of a linear ramp, as fixed point number with 10 fractional bits */
+    long step;
+
+    /** The set-point that is being approached */
+    unsigned int target;
+
+    /** The number of frames left until a linear ramp arrives at its set-point */
+    unsigned int n_frames_left;
+};
+typedef struct sVTPRampStateV1 VTPRampStateV1;
+
+/**
+ * Turns the step changes of an accumulator into smooth, ramped sample frames.
+ *
+ * The renderer follows the accumulator causally: Whenever it sees that a channel's amplitude or
+ * frequency has changed since the previous frame, it starts a ramp from the value it currently
+ * outputs towards the new set-point. This lets compact patterns render smoothly without having
+ * to spell out ramps as many tiny instructions. All arithmetic is fixed point.
+ */
+struct sVTPRendererV1 {
+    /** The ramp mode used for all channels */
+    VTPRampModeV1 mode;
+
+    /** The time between two consecutive frames, in milliseconds */
+    unsigned int frame_ms;
+
+    /** The number of frames a linear ramp takes */
+    unsigned int n_ramp_frames;
+
+    /** The filter coefficient of an exponential ramp, as fixed point number with 10 fractional bits */
+    long coefficient;
+
+    /** The number of channels. Also the length of both the amplitudes and frequencies fields */
+    unsigned char n_channels;
+
+    /** The rendering state of each channel's amplitude, indexed by channel number - 1 */
+    VTPRampStateV1* amplitudes;
+
+    /** The rendering state of each channel's frequency, indexed by channel number - 1 */
+    VTPRampStateV1* frequencies;
+};
+typedef struct sVTPRendererV1 VTPRendererV1;
+
+
+/**
+ * Initializes a renderer, starting out at the current state of the accumulator without any ramps
+ *
+ * @param renderer The renderer to be initialized
+ * @param accumulator The accumulator that will be rendered. Its n_channels field determines the number of channels to be rendered.
+ * @param mode @see VTPRendererV1
+ * @param ramp_ms The duration of a linear ramp or the time constant of an exponential ramp, in milliseconds
+ * @param frame_ms @see VTPRendererV1. Must be at least 1.
+ * @param amplitude_states An array of accumulator->n_channels states that is used as the renderer's amplitudes field
+ * @param frequency_states An array of accumulator->n_channels states that is used as the renderer's frequencies field
+ */
+void vtp_render_init_v1(VTPRendererV1* renderer, const VTPAccumulatorV1* accumulator, VTPRampModeV1 mode, unsigned int ramp_ms, unsigned int frame_ms, VTPRampStateV1 amplitude_states[], VTPRampStateV1 frequency_states[]);
+
+/**
+ * Renders the next frame from the current state of an accumulator
+ *
+ * Call this once per frame, after folding the accumulator up until the frame's time.
+ *
+ * @param renderer The renderer
+ * @param accumulator The accumulator to be rendered. Must have the same number of channels as the renderer.
+ * @param amplitudes Returns the rendered amplitude of each channel. Must have room for n_channels entries.
+ * @param frequencies Returns the rendered frequency of each channel. Must have room for n_channels entries.
+ */
+void vtp_render_frame_v1(VTPRendererV1* renderer, const VTPAccumulatorV1* accumulator, unsigned int amplitudes[], unsigned int frequencies[]);
+
+/**
+ * Folds instruction words and renders a sequence of frames from them
+ *
+ * Frame k is rendered after folding the accumulator up until start_ms + k * frame_ms.
+ * Its values are written to amplitudes[k * n_channels ...] and frequencies[k * n_channels ...].
+ *
+ * @param renderer The renderer
+ * @param accumulator @see vtp_render_frame_v1
+ * @param cursor The instruction words to be folded. Its position is advanced past all words that have been folded.
+ * @param start_ms The time of the first frame
+ * @param n_frames The number of frames to be rendered
+ * @param amplitudes Returns the rendered amplitudes. Must have room for n_frames * n_channels entries.
+ * @param frequencies Returns the rendered frequencies. Must have room for n_frames * n_channels entries.
+ * @return VTP_OK on success, otherwise an error code as defined in vtp/error.h. On error, no frames after the failing one are rendered.
+ */
+VTPError vtp_render_words_v1(VTPRendererV1* renderer, VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, unsigned long start_ms, size_t n_frames, unsigned int amplitudes[], unsigned int frequencies[]);
+
+#endif
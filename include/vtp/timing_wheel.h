@@ -0,0 +1,100 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_TIMING_WHEEL_H
+#define LIBVTP_TIMING_WHEEL_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/fold.h>
+
+/** The number of levels of a timing wheel */
+#define VTP_WHEEL_LEVELS (4)
+
+/** The number of slots per level of a timing wheel. Each level covers 256 times the time span of the level below it. */
+#define VTP_WHEEL_SLOTS (256)
+
+/**
+ * A hierarchical timing wheel that schedules instruction streams by the time of their next instruction.
+ *
+ * Level 0 has one slot per millisecond, level 1 one slot per 256 milliseconds and so on, so that
+ * four levels cover the whole range of 32 bit time offsets. Streams further in the future than that
+ * are kept in an overflow list. Advancing the wheel only touches the slots that are passed and the
+ * streams that are due, and skips over empty levels altogether - so the cost per tick is
+ * proportional to the number of due streams, even for long `time` instructions.
+ */
+struct sVTPTimingWheelV1 {
+    /** The number of streams known to the wheel. Also the length of all arrays below */
+    size_t n_streams;
+
+    /** The accumulator of each stream */
+    VTPAccumulatorV1* accumulators;
+
+    /** The instruction words of each stream */
+    VTPWordCursorV1* cursors;
+
+    /** The error that stopped each stream, or VTP_OK. Streams with an error are not scheduled any further. */
+    VTPError* errors;
+
+    /** The time up until which all streams have been folded */
+    unsigned long current_ms;
+
+    /** Bookkeeping of the wheel - do not touch */
+    size_t* links;
+    size_t slots[VTP_WHEEL_LEVELS][VTP_WHEEL_SLOTS];
+    size_t n_scheduled[VTP_WHEEL_LEVELS];
+    size_t overflow;
+};
+typedef struct sVTPTimingWheelV1 VTPTimingWheelV1;
+
+
+/**
+ * Initializes a timing wheel and schedules all streams that have instruction words left
+ *
+ * @param wheel The wheel to be initialized
+ * @param accumulators @see VTPTimingWheelV1. Make sure you initialize all of their fields.
+ * @param cursors @see VTPTimingWheelV1
+ * @param errors @see VTPTimingWheelV1. Will be set to VTP_OK.
+ * @param link_storage An array of n_streams entries that the wheel uses internally
+ * @param n_streams @see VTPTimingWheelV1
+ * @param start_ms The initial value of current_ms
+ */
+void vtp_timing_wheel_init_v1(VTPTimingWheelV1* wheel, VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], VTPError errors[], size_t link_storage[], size_t n_streams, unsigned long start_ms);
+
+/**
+ * Schedules a stream that isn't scheduled anymore, e.g. after appending instruction words to its cursor once it ran dry
+ *
+ * Streams that are still scheduled or that have no instruction words left are ignored.
+ *
+ * @param wheel The wheel to schedule the stream in
+ * @param stream The index of the stream
+ */
+void vtp_timing_wheel_schedule_v1(VTPTimingWheelV1* wheel, size_t stream);
+
+/**
+ * Folds all streams whose instructions are due, up until the given target time
+ *
+ * This has the same effect as calling vtp_fold_words_until_v1 for each stream and advancing its cursor.
+ *
+ * @param wheel The wheel to advance
+ * @param until_ms The target time in milliseconds. Calls with a target time before current_ms have no effect.
+ * @param n_processed Returns the count of instructions that have been applied to all accumulators in total. May be NULL.
+ * @return VTP_OK if no stream ran into an error, otherwise the first error that occurred. See the errors field for which stream failed.
+ */
+VTPError vtp_timing_wheel_advance_v1(VTPTimingWheelV1* wheel, unsigned long until_ms, size_t* n_processed);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_TRANSFORM_H
+#define LIBVTP_TRANSFORM_H
+
+#include <stddef.h>
+#include <vtp/error.h>
+#include <vtp/instruction_types.h>
+
+/** The gain that leaves amplitudes unchanged, @see vtp_transform_gain_v1 */
+#define VTP_GAIN_UNITY (256u)
+
+/**
+ * Scales the timing of VTPv1 instruction words by numerator / denominator
+ *
+ * Both the parameter of time instructions and the time offsets of set instructions are scaled.
+ * Rounding remainders are carried over to the following instructions, so that the scaled
+ * pattern doesn't drift. Time offsets that would overflow their 10 bits are moved into
+ * inserted time instructions, which is why the output may be longer than the input when
+ * slowing down. Time instructions that scale down to zero are dropped.
+ *
+ * When speeding up or keeping the speed (numerator <= denominator), the output is never longer
+ * than the input, and out may be the same array as in.
+ *
+ * If the out array is too small, the instruction words that have been processed can be continued from
+ * with the updated remainder, by calling this function again with a new out array.
+ *
+ * The scaled time of each instruction word must not exceed 0xFFFFFFFF milliseconds, which is the range of
+ * unsigned long on all platforms. Slowing down by more than a factor of 16 can exceed it for long time
+ * instructions.
+ *
+ * @param in The instruction words to be scaled
+ * @param n_in The number of instruction words in the in array
+ * @param numerator The factor by which all times are multiplied. numerator * denominator must not exceed 0xFFFFFFFF.
+ * @param denominator The divisor by which all times are divided. Must not be 0.
+ * @param remainder The rounding remainder carried over from the preceding instruction words, in 1/denominator milliseconds. Set it to 0 before scaling the first word. It is updated past all words that have been processed.
+ * @param out The array to write the scaled instruction words to
+ * @param max_out The number of slots in the out array
+ * @param n_processed Returns the number of instruction words from the in array that have been scaled completely
+ * @param n_out Returns the number of instruction words that have been written
+ * @return VTP_OK on success, VTP_BUFFER_TOO_SMALL if the out array is too small, VTP_TIME_OUT_OF_RANGE if the scaled time of a word exceeds 0xFFFFFFFF milliseconds, otherwise an error code as defined in vtp/error.h. The erroneous word is not processed.
+ */
+VTPError vtp_transform_time_scale_v1(const VTPInstructionWord in[], size_t n_in, unsigned long numerator, unsigned long denominator, unsigned long* remainder, VTPInstructionWord out[], size_t max_out, size_t* n_processed, size_t* n_out);
+
+/**
+ * Maps the channel select of all set instructions through a lookup table, in place
+ *
+ * Words with other instruction codes are left untouched.
+ *
+ * @param words The instruction words to be remapped
+ * @param n_words The number of instruction words in the words array
+ * @param map The new channel select for each channel select value, including 0 for broadcasts
+ */
+void vtp_transform_remap_channels_v1(VTPInstructionWord words[], size_t n_words, const unsigned char map[256]);
+
+/**
+ * Scales the parameter of all amplitude instructions, in place
+ *
+ * Amplitudes are rounded and clamped to 1023. Words with other instruction codes are left untouched.
+ *
+ * @param words The instruction words to be attenuated or amplified
+ * @param n_words The number of instruction words in the words array
+ * @param gain The gain in 1/256th, e.g. VTP_GAIN_UNITY / 2 to halve all amplitudes. Must be less than 0x200000.
+ */
+void vtp_transform_gain_v1(VTPInstructionWord words[], size_t n_words, unsigned long gain);
+
+#endif
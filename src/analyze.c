@@ -0,0 +1,191 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/analyze.h>
+#include <vtp/codec.h>
+
+static void begin_summary(VTPPatternSummaryV1* summary);
+static void account_instruction(VTPPatternSummaryV1* summary, unsigned long time_offset, size_t* run_length);
+static void account_channel_select(VTPPatternSummaryV1* summary, unsigned char channel_select, unsigned char n_channels);
+
+/* Masks and shifts to extract the fields of an instruction word, indexed by its (valid) instruction code */
+static const unsigned long analyze_time_offset_masks[3] = { 0x0FFFFFFFu, 0x000FFC00u, 0x000FFC00u };
+static const unsigned char analyze_time_offset_shifts[3] = { 0, 10, 10 };
+static const unsigned long analyze_channel_select_masks[3] = { 0, 0x0FF00000u, 0x0FF00000u };
+
+
+VTPError vtp_analyze_v1(const VTPInstructionV1 instructions[], size_t n_instructions, unsigned char n_channels, VTPPatternSummaryV1* summary) {
+    size_t i, run_length;
+
+    begin_summary(summary);
+    run_length = 0;
+
+    for (i=0; i < n_instructions; i++) {
+        switch (instructions[i].code) {
+            case VTP_INST_INCREMENT_TIME:
+                account_instruction(summary, instructions[i].params.format_a.parameter_a, &run_length);
+                break;
+            case VTP_INST_SET_FREQUENCY:
+            case VTP_INST_SET_AMPLITUDE:
+                account_instruction(summary, instructions[i].params.format_b.time_offset, &run_length);
+                account_channel_select(summary, instructions[i].params.format_b.channel_select, n_channels);
+                break;
+            default:
+                return VTP_INVALID_INSTRUCTION_CODE;
+        }
+    }
+
+    return VTP_OK;
+}
+
+VTPError vtp_analyze_words_v1(const VTPInstructionWord words[], size_t n_words, unsigned char n_channels, VTPPatternSummaryV1* summary) {
+    size_t i, run_length, max_run_length, n_broadcasts, n_out_of_range, first_out_of_range, n_without_channel;
+    unsigned long duration_ms, time_offset;
+    unsigned char code, channel_select, max_channel, is_out_of_range;
+    VTPInstructionWord word;
+    VTPError err;
+
+    begin_summary(summary);
+    err = VTP_OK;
+    run_length = max_run_length = n_broadcasts = n_out_of_range = first_out_of_range = n_without_channel = 0;
+    duration_ms = 0;
+    max_channel = 0;
+
+    /*
+     * The fields of each word are extracted through tables instead of a switch, and all counters are
+     * updated unconditionally, so that the loop body only branches on rare events (invalid instruction
+     * codes, the first out-of-range channel), which are predicted well.
+     */
+    for (i=0; i < n_words; i++) {
+        word = words[i];
+        code = (unsigned char)((word >> 28u) & 0xFu);
+
+        if (code > VTP_INST_SET_AMPLITUDE) {
+            err = VTP_INVALID_INSTRUCTION_CODE;
+            break;
+        }
+
+        time_offset = (word & analyze_time_offset_masks[code]) >> analyze_time_offset_shifts[code];
+        channel_select = (unsigned char)((word & analyze_channel_select_masks[code]) >> 20u);
+
+        /* Instructions without a time offset take effect at the same millisecond as their predecessor */
+        run_length = (time_offset == 0 ? run_length : 0) + 1;
+        max_run_length = run_length > max_run_length ? run_length : max_run_length;
+        duration_ms += time_offset;
+
+        n_broadcasts += (code != VTP_INST_INCREMENT_TIME) & (channel_select == 0);
+        max_channel = channel_select > max_channel ? channel_select : max_channel;
+
+        is_out_of_range = channel_select > n_channels;
+        first_out_of_range = n_out_of_range == 0 && is_out_of_range ? i : first_out_of_range;
+        n_out_of_range += is_out_of_range;
+
+        /* Words without a channel are counted for channel 1 as well, and subtracted from it afterwards */
+        if (summary->channel_writes)
+            summary->channel_writes[channel_select - (channel_select != 0)]++;
+        n_without_channel += channel_select == 0;
+    }
+
+    if (summary->channel_writes)
+        summary->channel_writes[0] -= n_without_channel;
+
+    summary->n_instructions = i;
+    summary->duration_ms = duration_ms;
+    summary->max_channel = max_channel;
+    summary->max_instructions_per_ms = max_run_length;
+    summary->n_broadcasts = n_broadcasts;
+    summary->n_out_of_range = n_out_of_range;
+    summary->first_out_of_range = first_out_of_range;
+
+    return err;
+}
+
+void vtp_build_seek_index_v1(const VTPInstructionWord words[], size_t n_words, unsigned long interval_ms, VTPSeekPointV1 out[], size_t n_seek_points) {
+    size_t i, i_seek_point;
+    unsigned long time;
+
+    time = 0;
+    i_seek_point = 0;
+
+    for (i=0; i < n_words && i_seek_point < n_seek_points; i++) {
+        time += vtp_get_word_time_offset_v1(words[i]);
+
+        /* Seek points refer to the first instruction that takes effect after them */
+        while (i_seek_point < n_seek_points && i_seek_point * interval_ms < time) {
+            out[i_seek_point].milliseconds = i_seek_point * interval_ms;
+            out[i_seek_point].instruction_index = i;
+            i_seek_point++;
+        }
+    }
+
+    for (; i_seek_point < n_seek_points; i_seek_point++) {
+        out[i_seek_point].milliseconds = i_seek_point * interval_ms;
+        out[i_seek_point].instruction_index = n_words;
+    }
+}
+
+
+static void begin_summary(VTPPatternSummaryV1* summary) {
+    size_t i;
+
+    summary->n_instructions = 0;
+    summary->duration_ms = 0;
+    summary->max_channel = 0;
+    summary->max_instructions_per_ms = 0;
+    summary->n_broadcasts = 0;
+    summary->n_out_of_range = 0;
+    summary->first_out_of_range = 0;
+
+    if (summary->channel_writes) {
+        for (i=0; i < VTP_MAX_CHANNELS; i++)
+            summary->channel_writes[i] = 0;
+    }
+}
+
+static void account_instruction(VTPPatternSummaryV1* summary, unsigned long time_offset, size_t* run_length) {
+    /* Instructions without a time offset take effect at the same millisecond as their predecessor */
+    if (time_offset == 0 && summary->n_instructions > 0)
+        (*run_length)++;
+    else
+        *run_length = 1;
+
+    if (*run_length > summary->max_instructions_per_ms)
+        summary->max_instructions_per_ms = *run_length;
+
+    summary->duration_ms += time_offset;
+    summary->n_instructions++;
+}
+
+static void account_channel_select(VTPPatternSummaryV1* summary, unsigned char channel_select, unsigned char n_channels) {
+    if (channel_select == 0) {
+        summary->n_broadcasts++;
+        return;
+    }
+
+    if (channel_select > summary->max_channel)
+        summary->max_channel = channel_select;
+
+    if (summary->channel_writes)
+        summary->channel_writes[channel_select - 1]++;
+
+    if (channel_select > n_channels) {
+        if (summary->n_out_of_range == 0)
+            summary->first_out_of_range = summary->n_instructions - 1;
+
+        summary->n_out_of_range++;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/batch.h>
+#include <vtp/codec.h>
+
+static unsigned long next_event_ms(const VTPFoldBatchV1* batch, size_t display);
+static void sift_down(VTPFoldBatchV1* batch, size_t i);
+static void remove_heap_root(VTPFoldBatchV1* batch);
+
+
+void vtp_fold_batch_init_v1(VTPFoldBatchV1* batch, VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], VTPError errors[], size_t heap_storage[], size_t n_displays) {
+    size_t i;
+
+    batch->n_displays = n_displays;
+    batch->accumulators = accumulators;
+    batch->cursors = cursors;
+    batch->errors = errors;
+    batch->heap = heap_storage;
+    batch->heap_size = 0;
+
+    for (i=0; i < n_displays; i++) {
+        errors[i] = VTP_OK;
+
+        if (cursors[i].position < cursors[i].n_words)
+            batch->heap[batch->heap_size++] = i;
+    }
+
+    /* Heapify bottom-up */
+    for (i = batch->heap_size / 2; i > 0; i--)
+        sift_down(batch, i - 1);
+}
+
+VTPError vtp_fold_batch_until_v1(VTPFoldBatchV1* batch, unsigned long until_ms, size_t* n_processed) {
+    size_t display, n_display_processed, n_total_processed;
+    VTPError err, first_err;
+    VTPWordCursorV1* cursor;
+
+    first_err = VTP_OK;
+    n_total_processed = 0;
+
+    while (batch->heap_size > 0 && next_event_ms(batch, batch->heap[0]) <= until_ms) {
+        display = batch->heap[0];
+        cursor = batch->cursors + display;
+
+        err = vtp_fold_words_until_v1(batch->accumulators + display, cursor->words + cursor->position, cursor->n_words - cursor->position, until_ms, &n_display_processed);
+
+        cursor->position += n_display_processed;
+        n_total_processed += n_display_processed;
+
+        if (err != VTP_OK) {
+            batch->errors[display] = err;
+            if (first_err == VTP_OK)
+                first_err = err;
+
+            remove_heap_root(batch);
+        }
+        else if (cursor->position == cursor->n_words) {
+            remove_heap_root(batch);
+        }
+        else {
+            /* The next instruction of this display lies beyond until_ms now */
+            sift_down(batch, 0);
+        }
+    }
+
+    if (n_processed)
+        *n_processed = n_total_processed;
+
+    return first_err;
+}
+
+
+static unsigned long next_event_ms(const VTPFoldBatchV1* batch, size_t display) {
+    const VTPWordCursorV1* cursor = batch->cursors + display;
+
+    return batch->accumulators[display].milliseconds_elapsed + vtp_get_word_time_offset_v1(cursor->words[cursor->position]);
+}
+
+static void sift_down(VTPFoldBatchV1* batch, size_t i) {
+    size_t child, display;
+    unsigned long key, child_key;
+
+    display = batch->heap[i];
+    key = next_event_ms(batch, display);
+
+    while ((child = 2*i + 1) < batch->heap_size) {
+        child_key = next_event_ms(batch, batch->heap[child]);
+
+        if (child + 1 < batch->heap_size && next_event_ms(batch, batch->heap[child + 1]) < child_key) {
+            child++;
+            child_key = next_event_ms(batch, batch->heap[child]);
+        }
+
+        if (key <= child_key)
+            break;
+
+        batch->heap[i] = batch->heap[child];
+        i = child;
+    }
+
+    batch->heap[i] = display;
+}
+
+static void remove_heap_root(VTPFoldBatchV1* batch) {
+    batch->heap_size--;
+
+    if (batch->heap_size > 0) {
+        batch->heap[0] = batch->heap[batch->heap_size];
+        sift_down(batch, 0);
+    }
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <vtp/cache.h>
+#include <vtp/codec.h>
+
+#define FNV_OFFSET_BASIS (2166136261ul)
+#define FNV_PRIME (16777619ul)
+
+static void lock_cache(VTPPatternCacheV1* cache);
+static void unlock_cache(VTPPatternCacheV1* cache);
+
+static VTPError create_cached_pattern(const VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, unsigned long hash, VTPCachedPatternV1** out);
+static void free_cached_pattern(VTPCachedPatternV1* pattern);
+
+static VTPCachedPatternV1* find_cached_pattern(const VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, unsigned long hash);
+static int cached_pattern_matches(const VTPCachedPatternV1* pattern, const unsigned char bytes[], size_t n_words, unsigned long hash);
+static void insert_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern);
+static void remove_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern);
+static void touch_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern);
+static void evict_cached_patterns(VTPPatternCacheV1* cache);
+
+
+unsigned long vtp_hash_bytes_v1(const unsigned char bytes[], size_t n_bytes) {
+    size_t i;
+    unsigned long hash = FNV_OFFSET_BASIS;
+
+    for (i=0; i < n_bytes; i++) {
+        hash ^= bytes[i];
+        hash = (hash * FNV_PRIME) & 0xFFFFFFFFu;
+    }
+
+    return hash;
+}
+
+VTPError vtp_cache_init_v1(VTPPatternCacheV1* cache, size_t n_buckets, size_t max_bytes, unsigned long seek_interval_ms, const VTPLockV1* lock) {
+    size_t i;
+
+    if (n_buckets == 0)
+        n_buckets = 1;
+
+    cache->buckets = (VTPCachedPatternV1**)malloc(n_buckets * sizeof(VTPCachedPatternV1*));
+    if (!cache->buckets)
+        return VTP_OUT_OF_MEMORY;
+
+    for (i=0; i < n_buckets; i++)
+        cache->buckets[i] = NULL;
+
+    cache->n_buckets = n_buckets;
+    cache->max_bytes = max_bytes;
+    cache->n_bytes = 0;
+    cache->seek_interval_ms = seek_interval_ms;
+    cache->newest = cache->oldest = NULL;
+
+    cache->has_lock = (lock != NULL);
+    if (lock)
+        cache->lock = *lock;
+
+    return VTP_OK;
+}
+
+void vtp_cache_destroy_v1(VTPPatternCacheV1* cache) {
+    VTPCachedPatternV1* pattern;
+    VTPCachedPatternV1* older;
+
+    for (pattern = cache->newest; pattern; pattern = older) {
+        older = pattern->older;
+        free_cached_pattern(pattern);
+    }
+
+    free(cache->buckets);
+
+    cache->buckets = NULL;
+    cache->n_buckets = 0;
+    cache->n_bytes = 0;
+    cache->newest = cache->oldest = NULL;
+}
+
+VTPError vtp_cache_acquire_v1(VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, const VTPCachedPatternV1** out) {
+    VTPCachedPatternV1* pattern;
+    VTPCachedPatternV1* existing;
+    VTPError err;
+    unsigned long hash;
+
+    /* The size in bytes must not wrap around, or the hash would only cover a prefix of the pattern */
+    if (n_words > ((size_t)-1) / 4)
+        return VTP_OUT_OF_MEMORY;
+
+    hash = vtp_hash_bytes_v1(bytes, n_words * 4);
+
+    lock_cache(cache);
+
+    if ((pattern = find_cached_pattern(cache, bytes, n_words, hash)) != NULL) {
+        pattern->n_references++;
+        touch_cached_pattern(cache, pattern);
+        unlock_cache(cache);
+
+        *out = pattern;
+        return VTP_OK;
+    }
+
+    unlock_cache(cache);
+
+    /* Decoding happens outside the lock, so that lookups of other patterns aren't blocked by it */
+    if ((err = create_cached_pattern(cache, bytes, n_words, hash, &pattern)) != VTP_OK)
+        return err;
+
+    lock_cache(cache);
+
+    /* Another thread might have inserted the same pattern in the meantime */
+    if ((existing = find_cached_pattern(cache, bytes, n_words, hash)) != NULL) {
+        existing->n_references++;
+        touch_cached_pattern(cache, existing);
+        unlock_cache(cache);
+
+        free_cached_pattern(pattern);
+        *out = existing;
+        return VTP_OK;
+    }
+
+    pattern->n_references = 1;
+    insert_cached_pattern(cache, pattern);
+    evict_cached_patterns(cache);
+
+    unlock_cache(cache);
+
+    *out = pattern;
+    return VTP_OK;
+}
+
+void vtp_cache_release_v1(VTPPatternCacheV1* cache, const VTPCachedPatternV1* pattern) {
+    VTPCachedPatternV1* mutable_pattern = (VTPCachedPatternV1*)pattern;
+
+    lock_cache(cache);
+
+    if (mutable_pattern->n_references > 0)
+        mutable_pattern->n_references--;
+
+    evict_cached_patterns(cache);
+
+    unlock_cache(cache);
+}
+
+
+static void lock_cache(VTPPatternCacheV1* cache) {
+    if (cache->has_lock)
+        cache->lock.lock(cache->lock.context);
+}
+
+static void unlock_cache(VTPPatternCacheV1* cache) {
+    if (cache->has_lock)
+        cache->lock.unlock(cache->lock.context);
+}
+
+static VTPError create_cached_pattern(const VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, unsigned long hash, VTPCachedPatternV1** out) {
+    VTPCachedPatternV1* pattern;
+    VTPError err;
+
+    if (!(pattern = (VTPCachedPatternV1*)malloc(sizeof(VTPCachedPatternV1))))
+        return VTP_OUT_OF_MEMORY;
+
+    pattern->hash = hash;
+    pattern->n_instructions = n_words;
+    pattern->n_references = 0;
+    pattern->next_in_bucket = pattern->newer = pattern->older = NULL;
+    pattern->n_seek_points = 0;
+    pattern->seek_points = NULL;
+
+    if (n_words >= ((size_t)-1) / sizeof(VTPInstructionV1)) {
+        free(pattern);
+        return VTP_OUT_OF_MEMORY;
+    }
+
+    /* One extra slot each, so that empty patterns don't depend on the behaviour of malloc(0) */
+    pattern->words = (VTPInstructionWord*)malloc((n_words + 1) * sizeof(VTPInstructionWord));
+    pattern->instructions = (VTPInstructionV1*)malloc((n_words + 1) * sizeof(VTPInstructionV1));
+
+    if (!pattern->words || !pattern->instructions) {
+        free_cached_pattern(pattern);
+        return VTP_OUT_OF_MEMORY;
+    }
+
+    vtp_read_instruction_words(n_words, bytes, pattern->words);
+
+    if ((err = vtp_decode_instructions_v1(pattern->words, pattern->instructions, n_words)) != VTP_OK) {
+        free_cached_pattern(pattern);
+        return err;
+    }
+
+    pattern->summary.channel_writes = NULL;
+    vtp_analyze_v1(pattern->instructions, n_words, VTP_MAX_CHANNELS, &pattern->summary);
+
+    if (cache->seek_interval_ms > 0) {
+        /* A long pattern with a short interval could need more seek points than the cache may hold, or even than fit into a size_t */
+        if (pattern->summary.duration_ms / cache->seek_interval_ms >= cache->max_bytes / sizeof(VTPSeekPointV1)) {
+            free_cached_pattern(pattern);
+            return VTP_BUFFER_TOO_SMALL;
+        }
+
+        pattern->n_seek_points = pattern->summary.duration_ms / cache->seek_interval_ms + 1;
+
+        if (!(pattern->seek_points = (VTPSeekPointV1*)malloc(pattern->n_seek_points * sizeof(VTPSeekPointV1)))) {
+            free_cached_pattern(pattern);
+            return VTP_OUT_OF_MEMORY;
+        }
+
+        vtp_build_seek_index_v1(pattern->words, n_words, cache->seek_interval_ms, pattern->seek_points, pattern->n_seek_points);
+    }
+
+    pattern->size_bytes = sizeof(VTPCachedPatternV1)
+        + n_words * (sizeof(VTPInstructionWord) + sizeof(VTPInstructionV1))
+        + pattern->n_seek_points * sizeof(VTPSeekPointV1);
+
+    *out = pattern;
+    return VTP_OK;
+}
+
+static void free_cached_pattern(VTPCachedPatternV1* pattern) {
+    free(pattern->words);
+    free(pattern->instructions);
+    free(pattern->seek_points);
+    free(pattern);
+}
+
+static VTPCachedPatternV1* find_cached_pattern(const VTPPatternCacheV1* cache, const unsigned char bytes[], size_t n_words, unsigned long hash) {
+    VTPCachedPatternV1* pattern;
+
+    for (pattern = cache->buckets[hash % cache->n_buckets]; pattern; pattern = pattern->next_in_bucket) {
+        if (cached_pattern_matches(pattern, bytes, n_words, hash))
+            return pattern;
+    }
+
+    return NULL;
+}
+
+static int cached_pattern_matches(const VTPCachedPatternV1* pattern, const unsigned char bytes[], size_t n_words, unsigned long hash) {
+    size_t i;
+    VTPInstructionWord word;
+
+    if (pattern->hash != hash || pattern->n_instructions != n_words)
+        return 0;
+
+    /* Guard against hash collisions */
+    for (i=0; i < n_words; i++) {
+        vtp_read_instruction_words(1, bytes + i*4, &word);
+
+        if (word != pattern->words[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+static void insert_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern) {
+    VTPCachedPatternV1** bucket = cache->buckets + (pattern->hash % cache->n_buckets);
+
+    pattern->next_in_bucket = *bucket;
+    *bucket = pattern;
+
+    pattern->older = cache->newest;
+    pattern->newer = NULL;
+
+    if (cache->newest)
+        cache->newest->newer = pattern;
+    else
+        cache->oldest = pattern;
+
+    cache->newest = pattern;
+    cache->n_bytes += pattern->size_bytes;
+}
+
+static void remove_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern) {
+    VTPCachedPatternV1** link = cache->buckets + (pattern->hash % cache->n_buckets);
+
+    while (*link != pattern)
+        link = &(*link)->next_in_bucket;
+
+    *link = pattern->next_in_bucket;
+
+    if (pattern->newer)
+        pattern->newer->older = pattern->older;
+    else
+        cache->newest = pattern->older;
+
+    if (pattern->older)
+        pattern->older->newer = pattern->newer;
+    else
+        cache->oldest = pattern->newer;
+
+    cache->n_bytes -= pattern->size_bytes;
+}
+
+static void touch_cached_pattern(VTPPatternCacheV1* cache, VTPCachedPatternV1* pattern) {
+    if (cache->newest == pattern)
+        return;
+
+    /* Unlink from the LRU list... */
+    pattern->newer->older = pattern->older;
+
+    if (pattern->older)
+        pattern->older->newer = pattern->newer;
+    else
+        cache->oldest = pattern->newer;
+
+    /* ...and re-insert as the newest entry */
+    pattern->older = cache->newest;
+    pattern->newer = NULL;
+    cache->newest->newer = pattern;
+    cache->newest = pattern;
+}
+
+static void evict_cached_patterns(VTPPatternCacheV1* cache) {
+    VTPCachedPatternV1* pattern;
+    VTPCachedPatternV1* newer;
+
+    for (pattern = cache->oldest; pattern && cache->n_bytes > cache->max_bytes; pattern = newer) {
+        newer = pattern->newer;
+
+        if (pattern->n_references > 0)
+            continue;
+
+        remove_cached_pattern(cache, pattern);
+        free_cached_pattern(pattern);
+    }
+}
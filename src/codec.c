@@ -85,6 +85,40 @@ VTPError vtp_decode_instructions_v1(const VTPInstructionWord instructions[], VTP
     return VTP_OK;
 }
 
+VTPError vtp_decode_instructions_lenient_v1(const VTPInstructionWord instructions[], size_t n, VTPRecoveryModeV1 mode, const VTPInstructionV1* substitute, VTPInstructionV1 out[], size_t* n_out, VTPDecodeIssueV1 issues[], size_t max_issues, size_t* n_issues) {
+    size_t i, n_written, n_invalid;
+    VTPError err, first_err;
+
+    n_written = 0;
+    n_invalid = 0;
+    first_err = VTP_OK;
+
+    for (i = 0; i < n; i++) {
+        if ((err = vtp_decode_instruction_v1(instructions[i], out + n_written)) == VTP_OK) {
+            n_written++;
+            continue;
+        }
+
+        if (n_invalid < max_issues) {
+            issues[n_invalid].index = i;
+            issues[n_invalid].error = err;
+        }
+
+        if (n_invalid == 0)
+            first_err = err;
+        n_invalid++;
+
+        /* When skipping, the slot that has been written to is reused by the next word */
+        if (mode == VTP_RECOVERY_SUBSTITUTE)
+            out[n_written++] = *substitute;
+    }
+
+    *n_out = n_written;
+    *n_issues = n_invalid;
+
+    return first_err;
+}
+
 VTPError vtp_encode_instructions_v1(const VTPInstructionV1 instructions[], VTPInstructionWord out[], size_t n) {
     size_t i;
     VTPError err;
@@ -98,6 +132,39 @@ VTPError vtp_encode_instructions_v1(const VTPInstructionV1 instructions[], VTPIn
     return VTP_OK;
 }
 
+VTPError vtp_encode_bytes_v1(const VTPInstructionV1 instructions[], unsigned char out[], size_t n) {
+    size_t i;
+    VTPInstructionWord word;
+    const VTPInstructionV1* instruction;
+
+    for (i = 0; i < n; i++) {
+        instruction = instructions + i;
+
+        switch (instruction->code) {
+            case VTP_INST_INCREMENT_TIME:
+                word = ((unsigned long)VTP_INST_INCREMENT_TIME << 28u) | (instruction->params.format_a.parameter_a & 0xFFFFFFFu);
+                break;
+            case VTP_INST_SET_AMPLITUDE:
+            case VTP_INST_SET_FREQUENCY:
+                word = ((unsigned long)instruction->code << 28u) |
+                       ((unsigned long)instruction->params.format_b.channel_select << 20u) |
+                       (((unsigned long)instruction->params.format_b.time_offset & 0x3FFu) << 10u) |
+                       ((unsigned long)instruction->params.format_b.parameter_a & 0x3FFu);
+                break;
+            default:
+                return VTP_INVALID_INSTRUCTION_CODE;
+        }
+
+        /* Written as separate byte stores, which compilers merge into a byte swap and a single store */
+        out[i*4]   = (word >> 24u) & 0xFFu;
+        out[i*4+1] = (word >> 16u) & 0xFFu;
+        out[i*4+2] = (word >> 8u) & 0xFFu;
+        out[i*4+3] = word & 0xFFu;
+    }
+
+    return VTP_OK;
+}
+
 unsigned long vtp_get_time_offset_v1(const VTPInstructionV1* instruction) {
     switch (instruction->code) {
         case VTP_INST_INCREMENT_TIME:
@@ -110,6 +177,18 @@ unsigned long vtp_get_time_offset_v1(const VTPInstructionV1* instruction) {
     }
 }
 
+unsigned long vtp_get_word_time_offset_v1(VTPInstructionWord instruction) {
+    switch ((instruction & 0xF0000000u) >> 28u) {
+        case VTP_INST_INCREMENT_TIME:
+            return instruction & 0x0FFFFFFFu;
+        case VTP_INST_SET_AMPLITUDE:
+        case VTP_INST_SET_FREQUENCY:
+            return (instruction & 0x000FFC00u) >> 10u;
+        default:
+            return 0;
+    }
+}
+
 void vtp_read_instruction_words(size_t n_words, const unsigned char in[], VTPInstructionWord out[]) {
     size_t i;
 
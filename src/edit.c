@@ -0,0 +1,401 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <vtp/codec.h>
+#include <vtp/edit.h>
+#include <vtp/fold.h>
+
+#define CODE_SHIFT (28u)
+#define CHANNEL_SELECT_SHIFT (20u)
+#define TIME_OFFSET_MASK (0x000FFC00ul)
+#define TIME_OFFSET_SHIFT (10u)
+#define MAX_TIME_OFFSET (0x3FFul)
+#define MAX_TIME_INCREMENT (0x0FFFFFFFul)
+
+static VTPError insert_segments(VTPEditListV1* list, size_t index, const VTPSegmentV1 segments[], size_t n_segments);
+static void split_segment(const VTPSegmentV1* segment, unsigned long at_ms, VTPSegmentV1* head, VTPSegmentV1* tail);
+static VTPError fold_entry_state(VTPEditListV1* list, size_t index, const VTPSegmentV1* head, size_t* entry_state);
+static VTPError restore_channels(unsigned long code, unsigned int current[], const unsigned int values[], unsigned char n_channels, unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written);
+static VTPError write_set_word(unsigned long word, unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written);
+static VTPError write_pending_time(unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written);
+
+
+VTPError vtp_segment_init_v1(VTPSegmentV1* segment, const VTPInstructionWord words[], size_t n_words) {
+    size_t i;
+    unsigned long duration_ms;
+    VTPInstructionV1 instruction;
+    VTPError err;
+
+    duration_ms = 0;
+
+    for (i=0; i < n_words; i++) {
+        if ((err = vtp_decode_instruction_v1(words[i], &instruction)) != VTP_OK)
+            return err;
+
+        duration_ms += vtp_get_time_offset_v1(&instruction);
+    }
+
+    segment->words = words;
+    segment->n_words = n_words;
+    segment->lead_ms = n_words > 0 ? vtp_get_word_time_offset_v1(words[0]) : 0;
+    segment->tail_ms = 0;
+    segment->duration_ms = duration_ms;
+    segment->entry_state = VTP_SEGMENT_STATE_ZERO;
+
+    return VTP_OK;
+}
+
+void vtp_edit_init_v1(VTPEditListV1* list, VTPSegmentV1 segment_storage[], size_t max_segments, unsigned char n_channels, unsigned int state_storage[], size_t max_states) {
+    list->segments = segment_storage;
+    list->n_segments = 0;
+    list->max_segments = max_segments;
+    list->n_channels = n_channels;
+    list->states = state_storage;
+    list->n_states = 0;
+    list->max_states = max_states;
+}
+
+unsigned long vtp_edit_duration_v1(const VTPEditListV1* list) {
+    size_t i;
+    unsigned long duration_ms = 0;
+
+    for (i=0; i < list->n_segments; i++)
+        duration_ms += list->segments[i].duration_ms;
+
+    return duration_ms;
+}
+
+VTPError vtp_edit_append_v1(VTPEditListV1* list, const VTPSegmentV1* segment) {
+    return insert_segments(list, list->n_segments, segment, 1);
+}
+
+VTPError vtp_edit_cut_v1(VTPEditListV1* list, unsigned long at_ms, size_t* index) {
+    size_t i;
+    unsigned long start_ms;
+    VTPSegmentV1 parts[2];
+    VTPError err;
+
+    /* Stop at a segment that ends exactly at the cut, as it might have instructions at that time */
+    for (i=0, start_ms = 0; i < list->n_segments && start_ms + list->segments[i].duration_ms < at_ms; i++)
+        start_ms += list->segments[i].duration_ms;
+
+    if (i == list->n_segments && start_ms < at_ms) {
+        /* Pad with silence up until the cut, which keeps the state at the end of the list wherever it is moved to */
+        parts[0].words = NULL;
+        parts[0].n_words = 0;
+        parts[0].lead_ms = 0;
+        parts[0].tail_ms = at_ms - start_ms;
+        parts[0].duration_ms = at_ms - start_ms;
+
+        if (list->n_segments == list->max_segments)
+            return VTP_BUFFER_TOO_SMALL;
+
+        if ((err = fold_entry_state(list, i, NULL, &parts[0].entry_state)) != VTP_OK)
+            return err;
+
+        insert_segments(list, i, parts, 1);
+
+        i++;
+    }
+    else if (start_ms < at_ms) {
+        split_segment(list->segments + i, at_ms - start_ms, parts, parts + 1);
+
+        if (parts[1].n_words > 0 || parts[1].duration_ms > 0) {
+            if (list->n_segments == list->max_segments)
+                return VTP_BUFFER_TOO_SMALL;
+
+            /* The second part starts with the state the first part leaves behind, even if it is only silence */
+            if ((err = fold_entry_state(list, i, parts, &parts[1].entry_state)) != VTP_OK)
+                return err;
+
+            insert_segments(list, i + 1, parts + 1, 1);
+        }
+
+        list->segments[i] = parts[0];
+        i++;
+    }
+
+    if (index)
+        *index = i;
+
+    return VTP_OK;
+}
+
+VTPError vtp_edit_insert_v1(VTPEditListV1* list, unsigned long at_ms, const VTPSegmentV1* segment) {
+    size_t index;
+    VTPError err;
+
+    if ((err = vtp_edit_cut_v1(list, at_ms, &index)) != VTP_OK)
+        return err;
+
+    return insert_segments(list, index, segment, 1);
+}
+
+VTPError vtp_edit_repeat_v1(VTPEditListV1* list, unsigned long from_ms, unsigned long to_ms, size_t n_times) {
+    size_t first, end, n_section, i;
+    VTPError err;
+
+    if ((err = vtp_edit_cut_v1(list, from_ms, &first)) != VTP_OK)
+        return err;
+
+    if ((err = vtp_edit_cut_v1(list, to_ms, &end)) != VTP_OK)
+        return err;
+
+    n_section = end - first;
+
+    if (n_times == 0) {
+        memmove(list->segments + first, list->segments + end, (list->n_segments - end) * sizeof(VTPSegmentV1));
+        list->n_segments -= n_section;
+        return VTP_OK;
+    }
+
+    if ((n_times - 1) * n_section > list->max_segments - list->n_segments)
+        return VTP_BUFFER_TOO_SMALL;
+
+    /* The section is copied from its first occurrence, which stays in front of all insertions */
+    for (i=1; i < n_times; i++) {
+        if ((err = insert_segments(list, end, list->segments + first, n_section)) != VTP_OK)
+            return err;
+    }
+
+    return VTP_OK;
+}
+
+VTPError vtp_edit_flatten_v1(const VTPEditListV1* list, unsigned int state[], VTPInstructionWord out[], size_t max_out, size_t* n_out) {
+    size_t i, j, n_written;
+    unsigned long pending_ms, word;
+    const VTPSegmentV1* segment;
+    const unsigned int* entry;
+    VTPAccumulatorV1 current;
+    VTPError err;
+
+    n_written = 0;
+    pending_ms = 0;
+    err = VTP_OK;
+
+    current.n_channels = list->n_channels;
+    current.amplitudes = state;
+    current.frequencies = state + list->n_channels;
+    current.milliseconds_elapsed = 0;
+    memset(state, 0, 2 * list->n_channels * sizeof(unsigned int));
+
+    for (i=0; i < list->n_segments && err == VTP_OK; i++) {
+        segment = list->segments + i;
+
+        if (segment->entry_state != VTP_SEGMENT_STATE_INHERIT) {
+            entry = segment->entry_state == VTP_SEGMENT_STATE_ZERO ? NULL : list->states + 2 * list->n_channels * segment->entry_state;
+
+            err = restore_channels(VTP_INST_SET_AMPLITUDE, current.amplitudes, entry, list->n_channels, &pending_ms, out, max_out, &n_written);
+
+            if (err == VTP_OK)
+                err = restore_channels(VTP_INST_SET_FREQUENCY, current.frequencies, entry ? entry + list->n_channels : NULL, list->n_channels, &pending_ms, out, max_out, &n_written);
+        }
+
+        for (j=0; j < segment->n_words && err == VTP_OK; j++) {
+            word = segment->words[j];
+            pending_ms += j == 0 ? segment->lead_ms : vtp_get_word_time_offset_v1(word);
+
+            if (((word >> CODE_SHIFT) & 0xFu) == VTP_INST_INCREMENT_TIME)
+                continue;
+
+            if ((err = write_set_word(word & ~TIME_OFFSET_MASK, &pending_ms, out, max_out, &n_written)) == VTP_OK)
+                err = vtp_fold_words_v1(&current, out + n_written - 1, 1);
+        }
+
+        pending_ms += segment->tail_ms;
+    }
+
+    /* Keep the duration, so that the output can be concatenated again */
+    if (err == VTP_OK)
+        err = write_pending_time(&pending_ms, out, max_out, &n_written);
+
+    *n_out = n_written;
+    return err;
+}
+
+static VTPError insert_segments(VTPEditListV1* list, size_t index, const VTPSegmentV1 segments[], size_t n_segments) {
+    if (n_segments > list->max_segments - list->n_segments)
+        return VTP_BUFFER_TOO_SMALL;
+
+    memmove(list->segments + index + n_segments, list->segments + index, (list->n_segments - index) * sizeof(VTPSegmentV1));
+
+    /* The inserted segments may have been moved by the memmove above, if they are part of the list themselves */
+    if (segments >= list->segments + index && segments < list->segments + list->n_segments)
+        segments += n_segments;
+
+    memmove(list->segments + index, segments, n_segments * sizeof(VTPSegmentV1));
+    list->n_segments += n_segments;
+
+    return VTP_OK;
+}
+
+static void split_segment(const VTPSegmentV1* segment, unsigned long at_ms, VTPSegmentV1* head, VTPSegmentV1* tail) {
+    size_t split;
+    unsigned long time_ms, next_ms;
+
+    /* Find the first word that takes effect at or after at_ms, keeping track of the time of the word before it */
+    time_ms = 0;
+    next_ms = segment->lead_ms;
+
+    for (split = 0; split < segment->n_words && next_ms < at_ms; split++) {
+        time_ms = next_ms;
+
+        if (split + 1 < segment->n_words)
+            next_ms += vtp_get_word_time_offset_v1(segment->words[split + 1]);
+    }
+
+    head->words = segment->words;
+    head->n_words = split;
+    head->lead_ms = split > 0 ? segment->lead_ms : 0;
+    head->tail_ms = at_ms - time_ms;
+    head->duration_ms = at_ms;
+    head->entry_state = segment->entry_state;
+
+    tail->words = segment->words + split;
+    tail->n_words = segment->n_words - split;
+    tail->lead_ms = split < segment->n_words ? next_ms - at_ms : 0;
+    tail->tail_ms = split < segment->n_words ? segment->tail_ms : segment->duration_ms - at_ms;
+    tail->duration_ms = segment->duration_ms - at_ms;
+    tail->entry_state = segment->entry_state;
+}
+
+/*
+ * Finds the state after the segments before index and then head, which may be NULL. Segments that inherit
+ * their state are resolved by folding forward from the nearest segment before them with an explicit one.
+ */
+static VTPError fold_entry_state(VTPEditListV1* list, size_t index, const VTPSegmentV1* head, size_t* entry_state) {
+    VTPAccumulatorV1 accumulator;
+    size_t first, i, n_words, state_size, start_state;
+    VTPError err;
+
+    first = index;
+    start_state = head ? head->entry_state : VTP_SEGMENT_STATE_INHERIT;
+
+    while (start_state == VTP_SEGMENT_STATE_INHERIT && first > 0)
+        start_state = list->segments[--first].entry_state;
+
+    n_words = head ? head->n_words : 0;
+    for (i=first; i < index; i++)
+        n_words += list->segments[i].n_words;
+
+    /* Without any instruction words in between, the state that has been found can be shared */
+    if (n_words == 0) {
+        *entry_state = start_state == VTP_SEGMENT_STATE_INHERIT ? VTP_SEGMENT_STATE_ZERO : start_state;
+        return VTP_OK;
+    }
+
+    if (list->n_states == list->max_states)
+        return VTP_BUFFER_TOO_SMALL;
+
+    state_size = 2 * list->n_channels;
+    accumulator.n_channels = list->n_channels;
+    accumulator.amplitudes = list->states + state_size * list->n_states;
+    accumulator.frequencies = accumulator.amplitudes + list->n_channels;
+    accumulator.milliseconds_elapsed = 0;
+
+    if (start_state < list->n_states)
+        memcpy(accumulator.amplitudes, list->states + state_size * start_state, state_size * sizeof(unsigned int));
+    else
+        memset(accumulator.amplitudes, 0, state_size * sizeof(unsigned int));
+
+    for (err = VTP_OK; first < index && err == VTP_OK; first++)
+        err = vtp_fold_words_v1(&accumulator, list->segments[first].words, list->segments[first].n_words);
+
+    if (err == VTP_OK && head)
+        err = vtp_fold_words_v1(&accumulator, head->words, head->n_words);
+
+    if (err != VTP_OK)
+        return err;
+
+    *entry_state = list->n_states++;
+    return VTP_OK;
+}
+
+/* Writes set instructions for the channels whose current value differs from the given one, which is zero if values is NULL */
+static VTPError restore_channels(unsigned long code, unsigned int current[], const unsigned int values[], unsigned char n_channels, unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written) {
+    unsigned int channel, n_changed;
+    unsigned long value;
+    int is_uniform;
+    VTPError err;
+
+    n_changed = 0;
+    is_uniform = 1;
+    value = 0;
+
+    for (channel = 0; channel < n_channels; channel++) {
+        value = values ? values[channel] : 0;
+        n_changed += current[channel] != value;
+        is_uniform = is_uniform && value == (values ? values[0] : 0);
+    }
+
+    /* A single broadcast instruction is enough if all channels end up with the same value */
+    if (n_changed > 1 && is_uniform) {
+        if ((err = write_set_word((code << CODE_SHIFT) | value, pending_ms, out, max_out, n_written)) != VTP_OK)
+            return err;
+
+        for (channel = 0; channel < n_channels; channel++)
+            current[channel] = value;
+
+        return VTP_OK;
+    }
+
+    for (channel = 0; channel < n_channels; channel++) {
+        value = values ? values[channel] : 0;
+
+        if (current[channel] == value)
+            continue;
+
+        if ((err = write_set_word((code << CODE_SHIFT) | ((channel + 1ul) << CHANNEL_SELECT_SHIFT) | value, pending_ms, out, max_out, n_written)) != VTP_OK)
+            return err;
+
+        current[channel] = value;
+    }
+
+    return VTP_OK;
+}
+
+static VTPError write_set_word(unsigned long word, unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written) {
+    VTPError err;
+
+    /* Time that doesn't fit into the offset of the set instruction goes into time instructions before it */
+    if (*pending_ms > MAX_TIME_OFFSET && (err = write_pending_time(pending_ms, out, max_out, n_written)) != VTP_OK)
+        return err;
+
+    if (*n_written == max_out)
+        return VTP_BUFFER_TOO_SMALL;
+
+    out[(*n_written)++] = word | (*pending_ms << TIME_OFFSET_SHIFT);
+    *pending_ms = 0;
+
+    return VTP_OK;
+}
+
+static VTPError write_pending_time(unsigned long* pending_ms, VTPInstructionWord out[], size_t max_out, size_t* n_written) {
+    unsigned long increment;
+
+    while (*pending_ms > 0) {
+        if (*n_written == max_out)
+            return VTP_BUFFER_TOO_SMALL;
+
+        increment = *pending_ms > MAX_TIME_INCREMENT ? MAX_TIME_INCREMENT : *pending_ms;
+        out[(*n_written)++] = increment;
+        *pending_ms -= increment;
+    }
+
+    return VTP_OK;
+}
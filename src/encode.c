@@ -0,0 +1,180 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/codec.h>
+#include <vtp/encode.h>
+
+#define MAX_PARAMETER (0x3FFu)
+#define MAX_TIME_OFFSET (0x3FFu)
+#define MAX_TIME_INCREMENT (0x0FFFFFFFul)
+
+static size_t count_changed_channels(const unsigned int current[], const unsigned int samples[], unsigned char n_channels, size_t channel_stride, unsigned int tolerance, int* is_uniform);
+static size_t count_time_words(unsigned long delta_ms);
+static int exceeds_tolerance(unsigned int current, unsigned int sample, unsigned int tolerance);
+static unsigned int clamp_sample(unsigned int sample);
+static void emit_format_b(VTPInstructionCode code, unsigned char channel_select, unsigned int value, unsigned long* delta_ms, VTPInstructionWord** out);
+static void emit_parameter(VTPInstructionCode code, unsigned int current[], const unsigned int samples[], unsigned char n_channels, size_t channel_stride, unsigned int tolerance, int is_uniform, unsigned long* delta_ms, VTPInstructionWord** out);
+static void emit_time(unsigned long* delta_ms, VTPInstructionWord** out);
+
+
+VTPError vtp_encode_samples_v1(VTPAccumulatorV1* state, const VTPSamplesV1* samples, unsigned int tolerance, VTPInstructionWord out[], size_t max_words, size_t* n_words, size_t* n_samples_encoded) {
+    size_t i, n_amplitude_words, n_frequency_words, n_needed;
+    int amplitudes_uniform, frequencies_uniform;
+    unsigned long sample_time_ms, delta_ms;
+    VTPInstructionWord* next;
+    VTPError err;
+
+    err = VTP_OK;
+    next = out;
+
+    for (i=0; i < samples->n_samples; i++) {
+        n_amplitude_words = count_changed_channels(state->amplitudes, samples->amplitudes + i, state->n_channels, samples->channel_stride, tolerance, &amplitudes_uniform);
+        n_frequency_words = count_changed_channels(state->frequencies, samples->frequencies + i, state->n_channels, samples->channel_stride, tolerance, &frequencies_uniform);
+
+        if (n_amplitude_words + n_frequency_words == 0)
+            continue;
+
+        /* Samples from before the current state can only take effect right away */
+        sample_time_ms = samples->start_ms + i * samples->sample_ms;
+        if (sample_time_ms < state->milliseconds_elapsed)
+            sample_time_ms = state->milliseconds_elapsed;
+
+        delta_ms = sample_time_ms - state->milliseconds_elapsed;
+
+        /* Only write complete samples, so that the state always matches the output */
+        n_needed = count_time_words(delta_ms) + n_amplitude_words + n_frequency_words;
+        if (n_needed > max_words - (size_t)(next - out)) {
+            err = VTP_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (delta_ms > MAX_TIME_OFFSET)
+            emit_time(&delta_ms, &next);
+
+        emit_parameter(VTP_INST_SET_AMPLITUDE, state->amplitudes, samples->amplitudes + i, state->n_channels, samples->channel_stride, tolerance, amplitudes_uniform, &delta_ms, &next);
+        emit_parameter(VTP_INST_SET_FREQUENCY, state->frequencies, samples->frequencies + i, state->n_channels, samples->channel_stride, tolerance, frequencies_uniform, &delta_ms, &next);
+
+        state->milliseconds_elapsed = sample_time_ms;
+    }
+
+    *n_words = (size_t)(next - out);
+    if (n_samples_encoded)
+        *n_samples_encoded = i;
+
+    return err;
+}
+
+
+static size_t count_changed_channels(const unsigned int current[], const unsigned int samples[], unsigned char n_channels, size_t channel_stride, unsigned int tolerance, int* is_uniform) {
+    size_t n_changed;
+    unsigned char i;
+    unsigned int sample, first_sample;
+
+    n_changed = 0;
+    *is_uniform = 0;
+
+    if (n_channels == 0)
+        return 0;
+
+    *is_uniform = 1;
+    first_sample = clamp_sample(samples[0]);
+
+    for (i=0; i < n_channels; i++) {
+        sample = clamp_sample(samples[i * channel_stride]);
+
+        if (exceeds_tolerance(current[i], sample, tolerance))
+            n_changed++;
+
+        if (sample != first_sample)
+            *is_uniform = 0;
+    }
+
+    /* Several channels changing to the same value take only one broadcast */
+    if (n_changed > 1 && *is_uniform)
+        return 1;
+
+    *is_uniform = 0;
+    return n_changed;
+}
+
+static size_t count_time_words(unsigned long delta_ms) {
+    if (delta_ms <= MAX_TIME_OFFSET)
+        return 0;
+
+    return delta_ms / MAX_TIME_INCREMENT + (delta_ms % MAX_TIME_INCREMENT != 0);
+}
+
+/* Compares the distance instead of shifting the bounds by the tolerance, which could wrap around */
+static int exceeds_tolerance(unsigned int current, unsigned int sample, unsigned int tolerance) {
+    return (current > sample ? current - sample : sample - current) > tolerance;
+}
+
+static unsigned int clamp_sample(unsigned int sample) {
+    return sample > MAX_PARAMETER ? MAX_PARAMETER : sample;
+}
+
+static void emit_format_b(VTPInstructionCode code, unsigned char channel_select, unsigned int value, unsigned long* delta_ms, VTPInstructionWord** out) {
+    VTPInstructionV1 instruction;
+
+    /* Only the first instruction of a sample carries the time offset */
+    instruction.code = code;
+    instruction.params.format_b.channel_select = channel_select;
+    instruction.params.format_b.time_offset = (unsigned int)*delta_ms;
+    instruction.params.format_b.parameter_a = value;
+    *delta_ms = 0;
+
+    vtp_encode_instruction_v1(&instruction, *out);
+    (*out)++;
+}
+
+static void emit_parameter(VTPInstructionCode code, unsigned int current[], const unsigned int samples[], unsigned char n_channels, size_t channel_stride, unsigned int tolerance, int is_uniform, unsigned long* delta_ms, VTPInstructionWord** out) {
+    unsigned char i;
+    unsigned int sample;
+
+    if (is_uniform) {
+        sample = clamp_sample(samples[0]);
+        emit_format_b(code, 0, sample, delta_ms, out);
+
+        for (i=0; i < n_channels; i++)
+            current[i] = sample;
+
+        return;
+    }
+
+    for (i=0; i < n_channels; i++) {
+        sample = clamp_sample(samples[i * channel_stride]);
+
+        if (exceeds_tolerance(current[i], sample, tolerance)) {
+            emit_format_b(code, (unsigned char)(i + 1), sample, delta_ms, out);
+            current[i] = sample;
+        }
+    }
+}
+
+static void emit_time(unsigned long* delta_ms, VTPInstructionWord** out) {
+    VTPInstructionV1 instruction;
+
+    instruction.code = VTP_INST_INCREMENT_TIME;
+
+    while (*delta_ms > 0) {
+        instruction.params.format_a.parameter_a = *delta_ms > MAX_TIME_INCREMENT ? MAX_TIME_INCREMENT : *delta_ms;
+        *delta_ms -= instruction.params.format_a.parameter_a;
+
+        vtp_encode_instruction_v1(&instruction, *out);
+        (*out)++;
+    }
+}
@@ -14,10 +14,38 @@
  * limitations under the License.
  */
 
+#include <string.h>
 #include <vtp/fold.h>
 
 VTPError apply_fold_format_b(const VTPInstructionParamsB* parameters, VTPAccumulatorV1* accumulator, unsigned int* target);
 VTPError set_with_channel_select(unsigned int new_value, unsigned char channel_select, unsigned int* target, unsigned char n_channels);
+static void fill_channels(unsigned int new_value, unsigned int* target, unsigned char n_channels);
+static VTPError fold_word(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static int word_is_due(const VTPAccumulatorV1* accumulator, VTPInstructionWord word, unsigned long until_ms);
+static VTPInstructionWord read_word(const unsigned char bytes[]);
+static VTPError fold_word_increment_time(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static VTPError fold_word_set_frequency(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static VTPError fold_word_set_amplitude(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static VTPError fold_word_invalid(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static VTPError apply_fold_format_b_narrow(const VTPInstructionParamsB* parameters, VTPNarrowAccumulatorV1* accumulator, int is_amplitude);
+
+typedef VTPError (*FoldWordHandler)(VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+
+/* Handlers for applying an instruction word, indexed by instruction code */
+static const FoldWordHandler fold_word_handlers[16] = {
+    fold_word_increment_time, fold_word_set_frequency, fold_word_set_amplitude, fold_word_invalid,
+    fold_word_invalid, fold_word_invalid, fold_word_invalid, fold_word_invalid,
+    fold_word_invalid, fold_word_invalid, fold_word_invalid, fold_word_invalid,
+    fold_word_invalid, fold_word_invalid, fold_word_invalid, fold_word_invalid
+};
+
+/* Mask and shift to extract the time offset from an instruction word, indexed by instruction code */
+static const unsigned long word_time_offset_masks[16] = {
+    0x0FFFFFFFu, 0x000FFC00u, 0x000FFC00u, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+static const unsigned char word_time_offset_shifts[16] = {
+    0, 10, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
 
 
 VTPError vtp_fold_v1(VTPAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions) {
@@ -68,6 +96,177 @@ VTPError vtp_fold_until_v1(VTPAccumulatorV1* accumulator, const VTPInstructionV1
     return VTP_OK;
 }
 
+VTPError vtp_fold_words_v1(VTPAccumulatorV1* accumulator, const VTPInstructionWord words[], size_t n_words) {
+    size_t i;
+    VTPError err;
+
+    for (i=0; i < n_words; i++) {
+        if ((err = fold_word(accumulator, words[i])) != VTP_OK) {
+            return err;
+        }
+    }
+
+    return VTP_OK;
+}
+
+VTPError vtp_fold_words_until_v1(VTPAccumulatorV1* accumulator, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed) {
+    size_t i;
+    VTPError err;
+
+    err = VTP_OK;
+
+    for (i=0; i < n_words && word_is_due(accumulator, words[i], until_ms); i++) {
+        if ((err = fold_word(accumulator, words[i])) != VTP_OK)
+            break;
+    }
+
+    if (n_processed)
+        *n_processed = i;
+
+    return err;
+}
+
+VTPError vtp_fold_bytes_v1(VTPAccumulatorV1* accumulator, const unsigned char bytes[], size_t n_words) {
+    size_t i;
+    VTPError err;
+
+    for (i=0; i < n_words; i++) {
+        if ((err = fold_word(accumulator, read_word(bytes + i*4))) != VTP_OK) {
+            return err;
+        }
+    }
+
+    return VTP_OK;
+}
+
+VTPError vtp_fold_bytes_until_v1(VTPAccumulatorV1* accumulator, const unsigned char bytes[], size_t n_words, unsigned long until_ms, size_t* n_processed) {
+    size_t i;
+    VTPError err;
+    VTPInstructionWord word;
+
+    err = VTP_OK;
+
+    for (i=0; i < n_words; i++) {
+        word = read_word(bytes + i*4);
+
+        if (!word_is_due(accumulator, word, until_ms))
+            break;
+
+        if ((err = fold_word(accumulator, word)) != VTP_OK)
+            break;
+    }
+
+    if (n_processed)
+        *n_processed = i;
+
+    return err;
+}
+
+VTPError vtp_fold_window_until_v1(VTPStreamCursorV1* cursor, const unsigned char window[], unsigned long window_offset, size_t window_size, unsigned long until_ms, int* window_exhausted) {
+    size_t start, n_words, n_processed;
+    VTPError err;
+
+    *window_exhausted = 0;
+
+    /* The words between the cursor and the window are missing */
+    if (cursor->byte_offset < window_offset)
+        return VTP_BUFFER_TOO_SMALL;
+
+    start = (size_t)(cursor->byte_offset - window_offset);
+    n_words = start < window_size ? (window_size - start) / 4 : 0;
+
+    err = vtp_fold_bytes_until_v1(cursor->accumulator, window + start, n_words, until_ms, &n_processed);
+    cursor->byte_offset += 4ul * n_processed;
+
+    /* The next instruction word might still be due, but it can only be checked once the next window is available */
+    *window_exhausted = err == VTP_OK && n_processed == n_words;
+
+    return err;
+}
+
+VTPError vtp_fold_words_at_v1(VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, const unsigned long times_ms[], size_t n_times, unsigned int amplitudes[], unsigned int frequencies[], size_t* n_written) {
+    VTPAccumulatorV1 row;
+    size_t i, n_processed, row_size;
+    VTPError err;
+
+    err = VTP_OK;
+    row = *accumulator;
+    row_size = accumulator->n_channels * sizeof(unsigned int);
+
+    /* The words are folded straight into the output rows, instead of folding into the accumulator and copying each row out of it */
+    for (i=0; i < n_times; i++) {
+        memcpy(amplitudes + i * accumulator->n_channels, row.amplitudes, row_size);
+        memcpy(frequencies + i * accumulator->n_channels, row.frequencies, row_size);
+        row.amplitudes = amplitudes + i * accumulator->n_channels;
+        row.frequencies = frequencies + i * accumulator->n_channels;
+
+        err = vtp_fold_words_until_v1(&row, cursor->words + cursor->position, cursor->n_words - cursor->position, times_ms[i], &n_processed);
+        cursor->position += n_processed;
+
+        if (err != VTP_OK)
+            break;
+    }
+
+    if (row.amplitudes != accumulator->amplitudes) {
+        memcpy(accumulator->amplitudes, row.amplitudes, row_size);
+        memcpy(accumulator->frequencies, row.frequencies, row_size);
+    }
+    accumulator->milliseconds_elapsed = row.milliseconds_elapsed;
+
+    if (n_written)
+        *n_written = i;
+
+    return err;
+}
+
+VTPError vtp_fold_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions) {
+    size_t i;
+    VTPError err;
+
+    for (i=0; i < n_instructions; i++) {
+        if ((err = vtp_fold_single_narrow_v1(accumulator, instructions + i)) != VTP_OK) {
+            return err;
+        }
+    }
+
+    return VTP_OK;
+}
+
+VTPError vtp_fold_single_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1* instruction) {
+    switch (instruction->code) {
+        case VTP_INST_INCREMENT_TIME:
+            accumulator->milliseconds_elapsed += instruction->params.format_a.parameter_a;
+            return VTP_OK;
+        case VTP_INST_SET_FREQUENCY:
+            return apply_fold_format_b_narrow(&instruction->params.format_b, accumulator, 0);
+        case VTP_INST_SET_AMPLITUDE:
+            return apply_fold_format_b_narrow(&instruction->params.format_b, accumulator, 1);
+        default:
+            return VTP_INVALID_INSTRUCTION_CODE;
+    }
+}
+
+VTPError vtp_fold_until_narrow_v1(VTPNarrowAccumulatorV1* accumulator, const VTPInstructionV1 instructions[], size_t n_instructions, unsigned long until_ms, size_t* n_processed) {
+    VTPError err;
+
+    if (n_processed)
+        *n_processed = 0;
+
+    while (n_instructions > 0 && (accumulator->milliseconds_elapsed + vtp_get_time_offset_v1(instructions)) <= until_ms) {
+        if ((err = vtp_fold_single_narrow_v1(accumulator, instructions)) != VTP_OK) {
+            return err;
+        }
+
+        n_instructions--;
+        instructions++;
+
+        if (n_processed)
+            *n_processed += 1;
+    }
+
+    return VTP_OK;
+}
+
 
 VTPError apply_fold_format_b(const VTPInstructionParamsB* parameters, VTPAccumulatorV1* accumulator, unsigned int* target) {
     accumulator->milliseconds_elapsed += parameters->time_offset;
@@ -75,12 +274,8 @@ VTPError apply_fold_format_b(const VTPInstructionParamsB* parameters, VTPAccumul
 }
 
 VTPError set_with_channel_select(unsigned int new_value, unsigned char channel_select, unsigned int* target, unsigned char n_channels) {
-    unsigned char i;
-
     if (channel_select == 0) {
-        for (i=0; i < n_channels; i++) {
-            target[i] = new_value;
-        }
+        fill_channels(new_value, target, n_channels);
     }
     else {
         if (channel_select > n_channels)
@@ -91,3 +286,91 @@ VTPError set_with_channel_select(unsigned int new_value, unsigned char channel_s
 
     return VTP_OK;
 }
+
+static VTPError fold_word(VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    return fold_word_handlers[(word & 0xF0000000u) >> 28u](accumulator, word);
+}
+
+static int word_is_due(const VTPAccumulatorV1* accumulator, VTPInstructionWord word, unsigned long until_ms) {
+    unsigned int code = (unsigned int)((word & 0xF0000000u) >> 28u);
+
+    return accumulator->milliseconds_elapsed + ((word & word_time_offset_masks[code]) >> word_time_offset_shifts[code]) <= until_ms;
+}
+
+static VTPInstructionWord read_word(const unsigned char bytes[]) {
+    return ((unsigned long)bytes[0] << 24u) | ((unsigned long)bytes[1] << 16u) | ((unsigned long)bytes[2] << 8u) | bytes[3];
+}
+
+static VTPError fold_word_increment_time(VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    accumulator->milliseconds_elapsed += word & 0x0FFFFFFFu;
+    return VTP_OK;
+}
+
+static VTPError fold_word_set_frequency(VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    accumulator->milliseconds_elapsed += (word & 0x000FFC00u) >> 10u;
+    return set_with_channel_select((unsigned int)(word & 0x000003FFu), (unsigned char)((word & 0x0FF00000u) >> 20u), accumulator->frequencies, accumulator->n_channels);
+}
+
+static VTPError fold_word_set_amplitude(VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    accumulator->milliseconds_elapsed += (word & 0x000FFC00u) >> 10u;
+    return set_with_channel_select((unsigned int)(word & 0x000003FFu), (unsigned char)((word & 0x0FF00000u) >> 20u), accumulator->amplitudes, accumulator->n_channels);
+}
+
+static VTPError fold_word_invalid(VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    return VTP_INVALID_INSTRUCTION_CODE;
+}
+
+static void fill_channels(unsigned int new_value, unsigned int* target, unsigned char n_channels) {
+    size_t i;
+    size_t n = n_channels;
+
+    /*
+     * Broadcasts are written in blocks of eight independent stores, which compilers merge
+     * into a few wide (SIMD) stores. A plain loop over an unsigned char index usually
+     * ends up as one scalar store per channel.
+     */
+    for (i=0; i + 8 <= n; i += 8) {
+        target[i] = new_value;
+        target[i+1] = new_value;
+        target[i+2] = new_value;
+        target[i+3] = new_value;
+        target[i+4] = new_value;
+        target[i+5] = new_value;
+        target[i+6] = new_value;
+        target[i+7] = new_value;
+    }
+
+    for (; i < n; i++) {
+        target[i] = new_value;
+    }
+}
+
+static VTPError apply_fold_format_b_narrow(const VTPInstructionParamsB* parameters, VTPNarrowAccumulatorV1* accumulator, int is_amplitude) {
+    unsigned char i;
+    unsigned short new_value = (unsigned short)parameters->parameter_a;
+    VTPChannelStateV1* channels = accumulator->channels;
+
+    accumulator->milliseconds_elapsed += parameters->time_offset;
+
+    if (parameters->channel_select == 0) {
+        if (is_amplitude) {
+            for (i=0; i < accumulator->n_channels; i++)
+                channels[i].amplitude = new_value;
+        }
+        else {
+            for (i=0; i < accumulator->n_channels; i++)
+                channels[i].frequency = new_value;
+        }
+    }
+    else {
+        if (parameters->channel_select > accumulator->n_channels)
+            return VTP_CHANNEL_OUT_OF_RANGE;
+
+        if (is_amplitude)
+            channels[parameters->channel_select - 1].amplitude = new_value;
+        else
+            channels[parameters->channel_select - 1].frequency = new_value;
+    }
+
+    return VTP_OK;
+}
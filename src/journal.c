@@ -0,0 +1,186 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/codec.h>
+#include <vtp/journal.h>
+
+#define CODE_SHIFT (28u)
+#define CHANNEL_MASK (0x0FF00000ul)
+#define CHANNEL_SHIFT (20u)
+#define TIME_OFFSET_MASK (0x000FFC00ul)
+
+static VTPError journal_word(VTPJournalV1* journal, const VTPAccumulatorV1* accumulator, VTPInstructionWord word);
+static void push_journal_entry(VTPJournalV1* journal, VTPInstructionWord word, unsigned int previous_value, unsigned char continued);
+static void undo_journal_entry(VTPAccumulatorV1* accumulator, const VTPJournalEntryV1* entry);
+static int undo_last_word(VTPAccumulatorV1* accumulator, VTPJournalV1* journal);
+
+
+void vtp_journal_init_v1(VTPJournalV1* journal, VTPJournalEntryV1 entries[], size_t capacity) {
+    journal->entries = entries;
+    journal->capacity = capacity;
+    journal->first = 0;
+    journal->n_entries = 0;
+}
+
+VTPError vtp_fold_words_until_journaled_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, const VTPInstructionWord words[], size_t n_words, unsigned long until_ms, size_t* n_processed) {
+    size_t i;
+    VTPError err;
+
+    err = VTP_OK;
+
+    for (i=0; i < n_words; i++) {
+        if (accumulator->milliseconds_elapsed + vtp_get_word_time_offset_v1(words[i]) > until_ms)
+            break;
+
+        /* Journaling validates the word. An erroneous word is still folded, to affect the accumulator exactly like vtp_fold_words_until_v1. */
+        err = journal_word(journal, accumulator, words[i]);
+        vtp_fold_words_v1(accumulator, words + i, 1);
+        if (err != VTP_OK)
+            break;
+    }
+
+    if (n_processed)
+        *n_processed = i;
+
+    return err;
+}
+
+VTPError vtp_unfold_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, size_t n_words, size_t* n_undone) {
+    size_t i;
+
+    for (i=0; i < n_words && undo_last_word(accumulator, journal); i++);
+
+    if (n_undone)
+        *n_undone = i;
+
+    return i < n_words ? VTP_BUFFER_TOO_SMALL : VTP_OK;
+}
+
+VTPError vtp_unfold_until_v1(VTPAccumulatorV1* accumulator, VTPJournalV1* journal, unsigned long until_ms, size_t* n_undone) {
+    size_t i;
+
+    /* The most recent word took effect at milliseconds_elapsed, so it is undone while that lies beyond the target time */
+    for (i=0; accumulator->milliseconds_elapsed > until_ms && undo_last_word(accumulator, journal); i++);
+
+    if (n_undone)
+        *n_undone = i;
+
+    return accumulator->milliseconds_elapsed > until_ms ? VTP_BUFFER_TOO_SMALL : VTP_OK;
+}
+
+
+static VTPError journal_word(VTPJournalV1* journal, const VTPAccumulatorV1* accumulator, VTPInstructionWord word) {
+    const unsigned int* values;
+    unsigned char channel_select, i;
+
+    switch (word >> CODE_SHIFT) {
+        case VTP_INST_INCREMENT_TIME:
+            push_journal_entry(journal, word, 0, 0);
+            return VTP_OK;
+        case VTP_INST_SET_AMPLITUDE:
+            values = accumulator->amplitudes;
+            break;
+        case VTP_INST_SET_FREQUENCY:
+            values = accumulator->frequencies;
+            break;
+        default:
+            return VTP_INVALID_INSTRUCTION_CODE;
+    }
+
+    channel_select = (unsigned char)((word & CHANNEL_MASK) >> CHANNEL_SHIFT);
+
+    if (channel_select > accumulator->n_channels)
+        return VTP_CHANNEL_OUT_OF_RANGE;
+
+    if (channel_select != 0) {
+        push_journal_entry(journal, word, values[channel_select - 1], 0);
+        return VTP_OK;
+    }
+
+    for (i=1; i < accumulator->n_channels && values[i] == values[0]; i++);
+
+    /* A broadcast over channels that all had the same value is undone by another broadcast */
+    if (i >= accumulator->n_channels) {
+        push_journal_entry(journal, word, accumulator->n_channels > 0 ? values[0] : 0, 0);
+        return VTP_OK;
+    }
+
+    for (i=0; i < accumulator->n_channels; i++) {
+        push_journal_entry(
+            journal,
+            (word & ~(CHANNEL_MASK | (i > 0 ? TIME_OFFSET_MASK : 0ul))) | ((VTPInstructionWord)(i + 1u) << CHANNEL_SHIFT),
+            values[i],
+            (unsigned char)(i + 1u < accumulator->n_channels)
+        );
+    }
+
+    return VTP_OK;
+}
+
+static void push_journal_entry(VTPJournalV1* journal, VTPInstructionWord word, unsigned int previous_value, unsigned char continued) {
+    VTPJournalEntryV1* entry;
+    int dropped_continued;
+
+    /* Overwrite the oldest instruction word as a whole, so that no word is left half undoable */
+    if (journal->n_entries == journal->capacity) {
+        do {
+            dropped_continued = journal->entries[journal->first].continued;
+            journal->first = (journal->first + 1) % journal->capacity;
+            journal->n_entries--;
+        } while (dropped_continued && journal->n_entries > 0);
+    }
+
+    entry = journal->entries + (journal->first + journal->n_entries) % journal->capacity;
+    entry->word = word;
+    entry->previous_value = previous_value;
+    entry->continued = continued;
+    journal->n_entries++;
+}
+
+static void undo_journal_entry(VTPAccumulatorV1* accumulator, const VTPJournalEntryV1* entry) {
+    unsigned int* values;
+    unsigned char channel_select, i;
+
+    accumulator->milliseconds_elapsed -= vtp_get_word_time_offset_v1(entry->word);
+
+    if (entry->word >> CODE_SHIFT == VTP_INST_INCREMENT_TIME)
+        return;
+
+    values = entry->word >> CODE_SHIFT == VTP_INST_SET_AMPLITUDE ? accumulator->amplitudes : accumulator->frequencies;
+    channel_select = (unsigned char)((entry->word & CHANNEL_MASK) >> CHANNEL_SHIFT);
+
+    if (channel_select != 0) {
+        values[channel_select - 1] = entry->previous_value;
+        return;
+    }
+
+    for (i=0; i < accumulator->n_channels; i++)
+        values[i] = entry->previous_value;
+}
+
+static int undo_last_word(VTPAccumulatorV1* accumulator, VTPJournalV1* journal) {
+    if (journal->n_entries == 0)
+        return 0;
+
+    /* Entries of the same word are undone from the last to the first, which holds the time offset */
+    do {
+        journal->n_entries--;
+        undo_journal_entry(accumulator, journal->entries + (journal->first + journal->n_entries) % journal->capacity);
+    } while (journal->n_entries > 0 && journal->entries[(journal->first + journal->n_entries - 1) % journal->capacity].continued);
+
+    return 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vtp/pool.h>
+
+/* Strictest alignment required by any of the types allocated from an arena */
+union uArenaAlignment {
+    VTPInstructionV1 instruction;
+    VTPInstructionWord word;
+};
+
+struct sArenaAlignmentProbe {
+    char offset;
+    union uArenaAlignment alignment;
+};
+
+#define ARENA_ALIGNMENT (offsetof(struct sArenaAlignmentProbe, alignment))
+
+static void* arena_alloc(VTPArenaV1* arena, size_t n_bytes);
+
+
+VTPError vtp_arena_init_v1(VTPArenaV1* arena, void* memory, size_t capacity) {
+    arena->owns_memory = 0;
+    arena->memory = NULL;
+    arena->capacity = arena->n_used = 0;
+
+    if (capacity == 0)
+        return VTP_BUFFER_TOO_SMALL;
+
+    arena->owns_memory = (memory == NULL);
+
+    if (!memory && !(memory = malloc(capacity)))
+        return VTP_OUT_OF_MEMORY;
+
+    arena->memory = (unsigned char*)memory;
+    arena->capacity = capacity;
+    arena->n_used = 0;
+
+    return VTP_OK;
+}
+
+void vtp_arena_destroy_v1(VTPArenaV1* arena) {
+    if (arena->owns_memory)
+        free(arena->memory);
+
+    arena->memory = NULL;
+    arena->capacity = arena->n_used = 0;
+}
+
+VTPInstructionV1* vtp_arena_alloc_instructions_v1(VTPArenaV1* arena, size_t n) {
+    if (n > arena->capacity / sizeof(VTPInstructionV1))
+        return NULL;
+
+    return (VTPInstructionV1*)arena_alloc(arena, n * sizeof(VTPInstructionV1));
+}
+
+VTPInstructionWord* vtp_arena_alloc_words_v1(VTPArenaV1* arena, size_t n) {
+    if (n > arena->capacity / sizeof(VTPInstructionWord))
+        return NULL;
+
+    return (VTPInstructionWord*)arena_alloc(arena, n * sizeof(VTPInstructionWord));
+}
+
+void vtp_arena_reset_v1(VTPArenaV1* arena) {
+    arena->n_used = 0;
+}
+
+
+VTPError vtp_accumulator_pool_init_v1(VTPAccumulatorPoolV1* pool, size_t n_accumulators, unsigned char n_channels) {
+    size_t i, unaligned;
+
+    /* Round each accumulator's channel arrays up to a whole number of cache lines */
+    pool->stride = (2 * n_channels * sizeof(unsigned int) + VTP_CACHE_LINE_SIZE - 1) / VTP_CACHE_LINE_SIZE * VTP_CACHE_LINE_SIZE;
+    pool->n_accumulators = n_accumulators;
+    pool->n_channels = n_channels;
+    pool->accumulators = NULL;
+    pool->free_list = NULL;
+    pool->acquired = NULL;
+    pool->block = NULL;
+    pool->n_free = 0;
+
+    /* None of the sizes below may wrap around */
+    if (n_accumulators >= ((size_t)-1) / sizeof(VTPAccumulatorV1)
+        || (pool->stride > 0 && n_accumulators > (((size_t)-1) - VTP_CACHE_LINE_SIZE) / pool->stride))
+        return VTP_OUT_OF_MEMORY;
+
+    pool->accumulators = (VTPAccumulatorV1*)malloc((n_accumulators + 1) * sizeof(VTPAccumulatorV1));
+    pool->free_list = (size_t*)malloc((n_accumulators + 1) * sizeof(size_t));
+    pool->acquired = (unsigned char*)malloc(n_accumulators + 1);
+    pool->block = malloc(n_accumulators * pool->stride + VTP_CACHE_LINE_SIZE);
+
+    if (!pool->accumulators || !pool->free_list || !pool->acquired || !pool->block) {
+        vtp_accumulator_pool_destroy_v1(pool);
+        return VTP_OUT_OF_MEMORY;
+    }
+
+    unaligned = (size_t)pool->block % VTP_CACHE_LINE_SIZE;
+    pool->channels = (unsigned int*)((unsigned char*)pool->block + (unaligned ? VTP_CACHE_LINE_SIZE - unaligned : 0));
+
+    for (i=0; i < n_accumulators; i++) {
+        pool->accumulators[i].n_channels = n_channels;
+        pool->accumulators[i].amplitudes = (unsigned int*)((unsigned char*)pool->channels + i * pool->stride);
+        pool->accumulators[i].frequencies = pool->accumulators[i].amplitudes + n_channels;
+        pool->accumulators[i].milliseconds_elapsed = 0;
+    }
+
+    vtp_accumulator_pool_reset_v1(pool);
+
+    return VTP_OK;
+}
+
+void vtp_accumulator_pool_destroy_v1(VTPAccumulatorPoolV1* pool) {
+    free(pool->accumulators);
+    free(pool->free_list);
+    free(pool->acquired);
+    free(pool->block);
+
+    pool->accumulators = NULL;
+    pool->free_list = NULL;
+    pool->acquired = NULL;
+    pool->block = NULL;
+    pool->channels = NULL;
+    pool->n_accumulators = pool->n_free = 0;
+}
+
+VTPAccumulatorV1* vtp_accumulator_pool_acquire_v1(VTPAccumulatorPoolV1* pool) {
+    VTPAccumulatorV1* accumulator;
+
+    if (pool->n_free == 0)
+        return NULL;
+
+    pool->n_free--;
+    accumulator = pool->accumulators + pool->free_list[pool->n_free];
+    pool->acquired[pool->free_list[pool->n_free]] = 1;
+
+    memset(accumulator->amplitudes, 0, 2 * pool->n_channels * sizeof(unsigned int));
+    accumulator->milliseconds_elapsed = 0;
+
+    return accumulator;
+}
+
+void vtp_accumulator_pool_release_v1(VTPAccumulatorPoolV1* pool, VTPAccumulatorV1* accumulator) {
+    size_t index;
+
+    if (accumulator < pool->accumulators || accumulator >= pool->accumulators + pool->n_accumulators)
+        return;
+
+    /* Releasing an accumulator twice would put it on the free list twice, so that it could be handed out twice */
+    index = (size_t)(accumulator - pool->accumulators);
+    if (!pool->acquired[index])
+        return;
+
+    pool->acquired[index] = 0;
+    pool->free_list[pool->n_free] = index;
+    pool->n_free++;
+}
+
+void vtp_accumulator_pool_reset_v1(VTPAccumulatorPoolV1* pool) {
+    size_t i;
+
+    /* Hand out accumulators in ascending order, for the sake of locality */
+    for (i=0; i < pool->n_accumulators; i++) {
+        pool->free_list[i] = pool->n_accumulators - 1 - i;
+        pool->acquired[i] = 0;
+    }
+
+    pool->n_free = pool->n_accumulators;
+}
+
+
+static void* arena_alloc(VTPArenaV1* arena, size_t n_bytes) {
+    void* result;
+    size_t offset = (arena->n_used + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+    if (offset > arena->capacity || n_bytes > arena->capacity - offset)
+        return NULL;
+
+    result = arena->memory + offset;
+    arena->n_used = offset + n_bytes;
+
+    return result;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <vtp/codec.h>
+#include <vtp/reader.h>
+
+static VTPError fill_reader(VTPReaderV1* reader);
+
+
+void vtp_reader_init_v1(VTPReaderV1* reader, VTPFetchV1 fetch, void* source, unsigned char buffer[], size_t buffer_size) {
+    reader->fetch = fetch;
+    reader->source = source;
+    reader->buffer = buffer;
+    reader->buffer_size = buffer_size;
+    reader->bytes = buffer;
+    reader->n_bytes = 0;
+    reader->position = 0;
+    reader->word_index = 0;
+    reader->end_of_source = 0;
+}
+
+void vtp_reader_init_memory_v1(VTPReaderV1* reader, const unsigned char bytes[], size_t n_bytes) {
+    reader->fetch = NULL;
+    reader->source = NULL;
+    reader->buffer = NULL;
+    reader->buffer_size = 0;
+    reader->bytes = bytes;
+    reader->n_bytes = n_bytes;
+    reader->position = 0;
+    reader->word_index = 0;
+    reader->end_of_source = 1;
+}
+
+VTPError vtp_read_instructions_v1(VTPReaderV1* reader, VTPInstructionV1 out[], size_t max_instructions, size_t* n_decoded) {
+    size_t i;
+    VTPInstructionWord word;
+    VTPError err;
+
+    err = VTP_OK;
+
+    for (i=0; i < max_instructions; i++) {
+        if ((err = fill_reader(reader)) != VTP_OK || reader->n_bytes - reader->position < 4)
+            break;
+
+        vtp_read_instruction_words(1, reader->bytes + reader->position, &word);
+        if ((err = vtp_decode_instruction_v1(word, out + i)) != VTP_OK)
+            break;
+
+        reader->position += 4;
+        reader->word_index++;
+    }
+
+    *n_decoded = i;
+    return err;
+}
+
+VTPError vtp_fold_reader_until_v1(VTPAccumulatorV1* accumulator, VTPReaderV1* reader, unsigned long until_ms, size_t* n_processed) {
+    size_t n_words, n_folded, n_total;
+    VTPError err;
+
+    n_total = 0;
+
+    /* Fold all buffered words at once, until one of them is not due yet */
+    while ((err = fill_reader(reader)) == VTP_OK && reader->n_bytes - reader->position >= 4) {
+        n_words = (reader->n_bytes - reader->position) / 4;
+        err = vtp_fold_bytes_until_v1(accumulator, reader->bytes + reader->position, n_words, until_ms, &n_folded);
+
+        reader->position += 4 * n_folded;
+        reader->word_index += n_folded;
+        n_total += n_folded;
+
+        if (err != VTP_OK || n_folded < n_words)
+            break;
+    }
+
+    if (n_processed)
+        *n_processed = n_total;
+
+    return err;
+}
+
+int vtp_reader_at_end_v1(const VTPReaderV1* reader) {
+    return reader->end_of_source && reader->position == reader->n_bytes;
+}
+
+
+static VTPError fill_reader(VTPReaderV1* reader) {
+    size_t n_left, n_fetched;
+    VTPError err;
+
+    while (reader->n_bytes - reader->position < 4 && !reader->end_of_source) {
+        /* Move the start of a partially fetched word to the front, and fetch the rest of the buffer */
+        n_left = reader->n_bytes - reader->position;
+        memmove(reader->buffer, reader->bytes + reader->position, n_left);
+        reader->bytes = reader->buffer;
+        reader->n_bytes = n_left;
+        reader->position = 0;
+
+        if ((err = reader->fetch(reader->source, reader->buffer + n_left, reader->buffer_size - n_left, &n_fetched)) != VTP_OK)
+            return err;
+
+        if (n_fetched == 0)
+            reader->end_of_source = 1;
+
+        reader->n_bytes += n_fetched;
+    }
+
+    if (reader->n_bytes != reader->position && reader->n_bytes - reader->position < 4)
+        return VTP_READ_ERROR;
+
+    return VTP_OK;
+}
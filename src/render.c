@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/render.h>
+
+#define RAMP_FRACTION_BITS (10u)
+#define RAMP_ONE (1l << RAMP_FRACTION_BITS)
+#define RAMP_HALF (1l << (RAMP_FRACTION_BITS - 1u))
+
+static void reset_ramps(VTPRampStateV1 states[], const unsigned int values[], unsigned char n_channels);
+static void render_ramps_none(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels);
+static void render_ramps_linear(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels, unsigned int n_ramp_frames);
+static void render_ramps_exponential(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels, long coefficient);
+
+
+void vtp_render_init_v1(VTPRendererV1* renderer, const VTPAccumulatorV1* accumulator, VTPRampModeV1 mode, unsigned int ramp_ms, unsigned int frame_ms, VTPRampStateV1 amplitude_states[], VTPRampStateV1 frequency_states[]) {
+    renderer->mode = mode;
+    renderer->frame_ms = frame_ms;
+    renderer->n_channels = accumulator->n_channels;
+    renderer->amplitudes = amplitude_states;
+    renderer->frequencies = frequency_states;
+
+    /* A ramp that is shorter than a frame has arrived by the next frame */
+    renderer->n_ramp_frames = ramp_ms / frame_ms;
+    if (renderer->n_ramp_frames == 0)
+        renderer->n_ramp_frames = 1;
+
+    /* Backward Euler discretization of a one-pole low pass with time constant ramp_ms */
+    renderer->coefficient = (long)(((unsigned long)frame_ms << RAMP_FRACTION_BITS) / ((unsigned long)ramp_ms + frame_ms));
+
+    reset_ramps(amplitude_states, accumulator->amplitudes, accumulator->n_channels);
+    reset_ramps(frequency_states, accumulator->frequencies, accumulator->n_channels);
+}
+
+void vtp_render_frame_v1(VTPRendererV1* renderer, const VTPAccumulatorV1* accumulator, unsigned int amplitudes[], unsigned int frequencies[]) {
+    /* Dispatch once per frame, so that the per-channel loops stay free of mode checks */
+    switch (renderer->mode) {
+        case VTP_RAMP_LINEAR:
+            render_ramps_linear(renderer->amplitudes, accumulator->amplitudes, amplitudes, renderer->n_channels, renderer->n_ramp_frames);
+            render_ramps_linear(renderer->frequencies, accumulator->frequencies, frequencies, renderer->n_channels, renderer->n_ramp_frames);
+            break;
+        case VTP_RAMP_EXPONENTIAL:
+            render_ramps_exponential(renderer->amplitudes, accumulator->amplitudes, amplitudes, renderer->n_channels, renderer->coefficient);
+            render_ramps_exponential(renderer->frequencies, accumulator->frequencies, frequencies, renderer->n_channels, renderer->coefficient);
+            break;
+        default:
+            render_ramps_none(renderer->amplitudes, accumulator->amplitudes, amplitudes, renderer->n_channels);
+            render_ramps_none(renderer->frequencies, accumulator->frequencies, frequencies, renderer->n_channels);
+            break;
+    }
+}
+
+VTPError vtp_render_words_v1(VTPRendererV1* renderer, VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, unsigned long start_ms, size_t n_frames, unsigned int amplitudes[], unsigned int frequencies[]) {
+    size_t i, n_processed;
+    unsigned long frame_ms;
+    VTPError err;
+
+    for (i=0, frame_ms = start_ms; i < n_frames; i++, frame_ms += renderer->frame_ms) {
+        err = vtp_fold_words_until_v1(accumulator, cursor->words + cursor->position, cursor->n_words - cursor->position, frame_ms, &n_processed);
+        cursor->position += n_processed;
+
+        if (err != VTP_OK)
+            return err;
+
+        vtp_render_frame_v1(renderer, accumulator, amplitudes + i * renderer->n_channels, frequencies + i * renderer->n_channels);
+    }
+
+    return VTP_OK;
+}
+
+
+static void reset_ramps(VTPRampStateV1 states[], const unsigned int values[], unsigned char n_channels) {
+    unsigned char i;
+
+    for (i=0; i < n_channels; i++) {
+        states[i].value = (long)values[i] << RAMP_FRACTION_BITS;
+        states[i].step = 0;
+        states[i].target = values[i];
+        states[i].n_frames_left = 0;
+    }
+}
+
+static void render_ramps_none(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels) {
+    unsigned char i;
+
+    for (i=0; i < n_channels; i++) {
+        states[i].target = targets[i];
+        states[i].value = (long)targets[i] << RAMP_FRACTION_BITS;
+        states[i].n_frames_left = 0;
+        out[i] = targets[i];
+    }
+}
+
+static void render_ramps_linear(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels, unsigned int n_ramp_frames) {
+    unsigned char i;
+    VTPRampStateV1* state;
+
+    for (i=0; i < n_channels; i++) {
+        state = states + i;
+
+        if (targets[i] != state->target) {
+            state->target = targets[i];
+            state->n_frames_left = n_ramp_frames;
+            state->step = (((long)targets[i] << RAMP_FRACTION_BITS) - state->value) / (long)n_ramp_frames;
+        }
+
+        if (state->n_frames_left != 0) {
+            /* Arrive exactly at the set-point, regardless of the rounding of step */
+            if (--state->n_frames_left == 0)
+                state->value = (long)state->target << RAMP_FRACTION_BITS;
+            else
+                state->value += state->step;
+
+            out[i] = (unsigned int)((state->value + RAMP_HALF) >> RAMP_FRACTION_BITS);
+        }
+        else {
+            out[i] = state->target;
+        }
+    }
+}
+
+static void render_ramps_exponential(VTPRampStateV1 states[], const unsigned int targets[], unsigned int out[], unsigned char n_channels, long coefficient) {
+    unsigned char i;
+    long difference, change;
+    VTPRampStateV1* state;
+
+    for (i=0; i < n_channels; i++) {
+        state = states + i;
+        state->target = targets[i];
+        difference = ((long)targets[i] << RAMP_FRACTION_BITS) - state->value;
+
+        if (difference == 0) {
+            out[i] = state->target;
+            continue;
+        }
+
+        /* Snap to the set-point once the remaining distance is too small to be covered in fixed point */
+        change = difference * coefficient / RAMP_ONE;
+        if (change == 0)
+            state->value += difference;
+        else
+            state->value += change;
+
+        out[i] = (unsigned int)((state->value + RAMP_HALF) >> RAMP_FRACTION_BITS);
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/codec.h>
+#include <vtp/timing_wheel.h>
+
+#define LIST_END ((size_t)-1)
+#define UNSCHEDULED ((size_t)-2)
+#define SLOT_BITS (8u)
+#define SLOT_MASK (0xFFu)
+
+static void wheel_insert(VTPTimingWheelV1* wheel, size_t stream);
+static void wheel_cascade(VTPTimingWheelV1* wheel, size_t list);
+static VTPError wheel_fold_slot(VTPTimingWheelV1* wheel, size_t level, size_t slot, unsigned long until_ms, size_t* n_processed);
+static unsigned long wheel_next_tick(const VTPTimingWheelV1* wheel);
+static size_t wheel_take_slot(VTPTimingWheelV1* wheel, size_t level, size_t slot);
+
+
+void vtp_timing_wheel_init_v1(VTPTimingWheelV1* wheel, VTPAccumulatorV1 accumulators[], VTPWordCursorV1 cursors[], VTPError errors[], size_t link_storage[], size_t n_streams, unsigned long start_ms) {
+    size_t i, j;
+
+    wheel->n_streams = n_streams;
+    wheel->accumulators = accumulators;
+    wheel->cursors = cursors;
+    wheel->errors = errors;
+    wheel->links = link_storage;
+    wheel->current_ms = start_ms;
+    wheel->overflow = LIST_END;
+
+    for (i=0; i < VTP_WHEEL_LEVELS; i++) {
+        wheel->n_scheduled[i] = 0;
+
+        for (j=0; j < VTP_WHEEL_SLOTS; j++)
+            wheel->slots[i][j] = LIST_END;
+    }
+
+    for (i=0; i < n_streams; i++) {
+        errors[i] = VTP_OK;
+        wheel->links[i] = UNSCHEDULED;
+        vtp_timing_wheel_schedule_v1(wheel, i);
+    }
+}
+
+void vtp_timing_wheel_schedule_v1(VTPTimingWheelV1* wheel, size_t stream) {
+    const VTPWordCursorV1* cursor = wheel->cursors + stream;
+
+    if (wheel->links[stream] != UNSCHEDULED || wheel->errors[stream] != VTP_OK || cursor->position >= cursor->n_words)
+        return;
+
+    wheel_insert(wheel, stream);
+}
+
+VTPError vtp_timing_wheel_advance_v1(VTPTimingWheelV1* wheel, unsigned long until_ms, size_t* n_processed) {
+    size_t level, n_total_processed;
+    unsigned long next_ms;
+    VTPError err, first_err;
+
+    first_err = VTP_OK;
+    n_total_processed = 0;
+
+    while (until_ms >= wheel->current_ms) {
+        err = wheel_fold_slot(wheel, 0, wheel->current_ms & SLOT_MASK, until_ms, &n_total_processed);
+        if (first_err == VTP_OK)
+            first_err = err;
+
+        if (wheel->current_ms == until_ms)
+            break;
+
+        next_ms = wheel_next_tick(wheel);
+        if (next_ms > until_ms || next_ms <= wheel->current_ms) {
+            /* Nothing is scheduled up until the target time */
+            wheel->current_ms = until_ms;
+            continue;
+        }
+
+        wheel->current_ms = next_ms;
+
+        /* Crossing the 32 bit boundary - any stream in the overflow list might be in range now */
+        if (((next_ms & 0xFFFFFFFFu) == 0) && wheel->overflow != LIST_END)
+            wheel_cascade(wheel, wheel_take_slot(wheel, VTP_WHEEL_LEVELS, 0));
+
+        /* Higher levels first, as they might cascade into a slot of a lower level that is due right now */
+        for (level = VTP_WHEEL_LEVELS - 1; level > 0; level--) {
+            if ((next_ms & ((1ul << (SLOT_BITS * level)) - 1)) == 0)
+                wheel_cascade(wheel, wheel_take_slot(wheel, level, (next_ms >> (SLOT_BITS * level)) & SLOT_MASK));
+        }
+    }
+
+    if (n_processed)
+        *n_processed = n_total_processed;
+
+    return first_err;
+}
+
+
+static void wheel_insert(VTPTimingWheelV1* wheel, size_t stream) {
+    const VTPWordCursorV1* cursor = wheel->cursors + stream;
+    unsigned long due_ms, difference;
+    size_t level, slot, *head;
+
+    due_ms = wheel->accumulators[stream].milliseconds_elapsed + vtp_get_word_time_offset_v1(cursor->words[cursor->position]);
+    if (due_ms < wheel->current_ms)
+        due_ms = wheel->current_ms;
+
+    /* The level is determined by the most significant byte in which due_ms differs from current_ms */
+    difference = due_ms ^ wheel->current_ms;
+
+    if ((difference >> 16u) >> 16u) {
+        head = &wheel->overflow;
+    }
+    else {
+        for (level = 0; level < VTP_WHEEL_LEVELS - 1 && (difference >> (SLOT_BITS * (level + 1))) != 0; level++);
+
+        slot = (due_ms >> (SLOT_BITS * level)) & SLOT_MASK;
+        head = &wheel->slots[level][slot];
+        wheel->n_scheduled[level]++;
+    }
+
+    wheel->links[stream] = *head;
+    *head = stream;
+}
+
+static void wheel_cascade(VTPTimingWheelV1* wheel, size_t list) {
+    size_t stream;
+
+    while (list != LIST_END) {
+        stream = list;
+        list = wheel->links[stream];
+        wheel_insert(wheel, stream);
+    }
+}
+
+static size_t wheel_take_slot(VTPTimingWheelV1* wheel, size_t level, size_t slot) {
+    size_t list, stream;
+
+    if (level == VTP_WHEEL_LEVELS) {
+        list = wheel->overflow;
+        wheel->overflow = LIST_END;
+        return list;
+    }
+
+    list = wheel->slots[level][slot];
+    wheel->slots[level][slot] = LIST_END;
+
+    for (stream = list; stream != LIST_END; stream = wheel->links[stream])
+        wheel->n_scheduled[level]--;
+
+    return list;
+}
+
+static VTPError wheel_fold_slot(VTPTimingWheelV1* wheel, size_t level, size_t slot, unsigned long until_ms, size_t* n_processed) {
+    size_t list, stream, n_stream_processed;
+    VTPWordCursorV1* cursor;
+    VTPError err, first_err;
+
+    first_err = VTP_OK;
+    list = wheel_take_slot(wheel, level, slot);
+
+    while (list != LIST_END) {
+        stream = list;
+        list = wheel->links[stream];
+        wheel->links[stream] = UNSCHEDULED;
+
+        cursor = wheel->cursors + stream;
+        err = vtp_fold_words_until_v1(wheel->accumulators + stream, cursor->words + cursor->position, cursor->n_words - cursor->position, until_ms, &n_stream_processed);
+
+        cursor->position += n_stream_processed;
+        *n_processed += n_stream_processed;
+
+        if (err != VTP_OK) {
+            wheel->errors[stream] = err;
+            if (first_err == VTP_OK)
+                first_err = err;
+        }
+
+        vtp_timing_wheel_schedule_v1(wheel, stream);
+    }
+
+    return first_err;
+}
+
+static unsigned long wheel_next_tick(const VTPTimingWheelV1* wheel) {
+    size_t level;
+
+    /* Skip to the end of the rotation of all levels that are empty */
+    for (level = 0; level < VTP_WHEEL_LEVELS && wheel->n_scheduled[level] == 0; level++);
+
+    if (level == 0)
+        return wheel->current_ms + 1;
+
+    if (level < VTP_WHEEL_LEVELS)
+        return (wheel->current_ms | ((1ul << (SLOT_BITS * level)) - 1)) + 1;
+
+    if (wheel->overflow != LIST_END)
+        return ((wheel->current_ms | 0xFFFFu) | (0xFFFFul << 16u)) + 1;
+
+    return wheel->current_ms;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <vtp/transform.h>
+
+#define CODE_SHIFT (28u)
+#define CHANNEL_MASK (0x0FF00000ul)
+#define CHANNEL_SHIFT (20u)
+#define TIME_OFFSET_MASK (0x000FFC00ul)
+#define TIME_OFFSET_SHIFT (10u)
+#define PARAMETER_MASK (0x000003FFul)
+#define MAX_TIME_OFFSET (0x3FFul)
+#define MAX_TIME_INCREMENT (0x0FFFFFFFul)
+#define MAX_SCALED_TIME (0xFFFFFFFFul)
+
+static VTPError scale_time(unsigned long time, unsigned long numerator, unsigned long denominator, unsigned long* remainder, unsigned long* scaled);
+
+
+VTPError vtp_transform_time_scale_v1(const VTPInstructionWord in[], size_t n_in, unsigned long numerator, unsigned long denominator, unsigned long* remainder, VTPInstructionWord out[], size_t max_out, size_t* n_processed, size_t* n_out) {
+    size_t i, n_written, n_needed;
+    unsigned long word, code, scaled, word_remainder, increment;
+    VTPError err;
+
+    err = VTP_OK;
+    n_written = 0;
+
+    for (i=0; i < n_in; i++) {
+        word = in[i];
+        code = (word >> CODE_SHIFT) & 0xFu;
+
+        if (code != VTP_INST_INCREMENT_TIME && code != VTP_INST_SET_FREQUENCY && code != VTP_INST_SET_AMPLITUDE) {
+            err = VTP_INVALID_INSTRUCTION_CODE;
+            break;
+        }
+
+        /* The remainder is only committed once the word has been written, so that a full out array can be resumed from */
+        word_remainder = *remainder;
+
+        if (code == VTP_INST_INCREMENT_TIME) {
+            if ((err = scale_time(word & MAX_TIME_INCREMENT, numerator, denominator, &word_remainder, &scaled)) != VTP_OK)
+                break;
+        } else {
+            if ((err = scale_time((word & TIME_OFFSET_MASK) >> TIME_OFFSET_SHIFT, numerator, denominator, &word_remainder, &scaled)) != VTP_OK)
+                break;
+
+            word &= ~TIME_OFFSET_MASK;
+
+            /* Whatever doesn't fit into the offset is carried by inserted time instructions */
+            if (scaled <= MAX_TIME_OFFSET) {
+                word |= scaled << TIME_OFFSET_SHIFT;
+                scaled = 0;
+            }
+        }
+
+        /* Time instructions are replaced entirely by the inserted ones */
+        n_needed = scaled / MAX_TIME_INCREMENT + (scaled % MAX_TIME_INCREMENT != 0) + (code != VTP_INST_INCREMENT_TIME);
+
+        if (n_needed > max_out - n_written) {
+            err = VTP_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        for (; scaled > 0; scaled -= increment) {
+            increment = scaled > MAX_TIME_INCREMENT ? MAX_TIME_INCREMENT : scaled;
+            out[n_written++] = increment;
+        }
+
+        if (code != VTP_INST_INCREMENT_TIME)
+            out[n_written++] = word;
+
+        *remainder = word_remainder;
+    }
+
+    if (n_processed)
+        *n_processed = i;
+
+    *n_out = n_written;
+    return err;
+}
+
+void vtp_transform_remap_channels_v1(VTPInstructionWord words[], size_t n_words, const unsigned char map[256]) {
+    size_t i;
+    unsigned long word, code;
+
+    for (i=0; i < n_words; i++) {
+        word = words[i];
+        code = (word >> CODE_SHIFT) & 0xFu;
+
+        if (code == VTP_INST_SET_FREQUENCY || code == VTP_INST_SET_AMPLITUDE)
+            words[i] = (word & ~CHANNEL_MASK) | ((unsigned long)map[(word & CHANNEL_MASK) >> CHANNEL_SHIFT] << CHANNEL_SHIFT);
+    }
+}
+
+void vtp_transform_gain_v1(VTPInstructionWord words[], size_t n_words, unsigned long gain) {
+    size_t i;
+    unsigned long word, amplitude;
+
+    /* Computes the new amplitude for every word and selects it afterwards, which keeps the loop free of branches */
+    for (i=0; i < n_words; i++) {
+        word = words[i];
+        amplitude = ((word & PARAMETER_MASK) * gain + VTP_GAIN_UNITY / 2) / VTP_GAIN_UNITY;
+        amplitude = amplitude > PARAMETER_MASK ? PARAMETER_MASK : amplitude;
+
+        words[i] = ((word >> CODE_SHIFT) & 0xFu) == VTP_INST_SET_AMPLITUDE ? (word & ~PARAMETER_MASK) | amplitude : word;
+    }
+}
+
+
+static VTPError scale_time(unsigned long time, unsigned long numerator, unsigned long denominator, unsigned long* remainder, unsigned long* scaled) {
+    unsigned long whole, fraction, carry;
+
+    /* Split time into multiples of denominator and the rest, so that only products below numerator * denominator occur */
+    whole = time / denominator;
+    fraction = (time % denominator) * numerator;
+
+    /* Adding the remainder carries at most one millisecond, which is checked without adding it, as that could overflow */
+    carry = fraction % denominator >= denominator - *remainder;
+    *remainder = carry ? fraction % denominator - (denominator - *remainder) : fraction % denominator + *remainder;
+    fraction = fraction / denominator + carry;
+
+    /* fraction is at most numerator, so the check itself can't overflow either */
+    if (numerator != 0 && whole > (MAX_SCALED_TIME - fraction) / numerator)
+        return VTP_TIME_OUT_OF_RANGE;
+
+    *scaled = whole * numerator + fraction;
+    return VTP_OK;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/analyze.h>
+#include <vtp/codec.h>
+
+
+#define N_ANALYZE_TEST_WORDS (8)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord analyze_test_words[N_ANALYZE_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+
+TEST words_can_be_analyzed(void) {
+    VTPPatternSummaryV1 summary;
+    size_t channel_writes[VTP_MAX_CHANNELS];
+
+    summary.channel_writes = channel_writes;
+
+    ASSERT_EQ(VTP_OK, vtp_analyze_words_v1(analyze_test_words, N_ANALYZE_TEST_WORDS, 3, &summary));
+
+    ASSERT_EQ(N_ANALYZE_TEST_WORDS, summary.n_instructions);
+    ASSERT_EQ(2050, summary.duration_ms);
+    ASSERT_EQ(2, summary.max_channel);
+    ASSERT_EQ(3, summary.max_instructions_per_ms);
+    ASSERT_EQ(3, summary.n_broadcasts);
+    ASSERT_EQ(1, channel_writes[0]);
+    ASSERT_EQ(3, channel_writes[1]);
+    ASSERT_EQ(0, channel_writes[2]);
+    ASSERT_EQ(0, channel_writes[VTP_MAX_CHANNELS - 1]);
+    ASSERT_EQ(0, summary.n_out_of_range);
+
+    PASS();
+}
+
+TEST words_and_instructions_yield_same_summary(void) {
+    VTPInstructionV1 instructions[N_ANALYZE_TEST_WORDS];
+    VTPPatternSummaryV1 from_words, from_instructions;
+    size_t channel_writes_words[VTP_MAX_CHANNELS], channel_writes_instructions[VTP_MAX_CHANNELS];
+
+    from_words.channel_writes = channel_writes_words;
+    from_instructions.channel_writes = channel_writes_instructions;
+
+    ASSERT_EQ(VTP_OK, vtp_decode_instructions_v1(analyze_test_words, instructions, N_ANALYZE_TEST_WORDS));
+    ASSERT_EQ(VTP_OK, vtp_analyze_words_v1(analyze_test_words, N_ANALYZE_TEST_WORDS, 1, &from_words));
+    ASSERT_EQ(VTP_OK, vtp_analyze_v1(instructions, N_ANALYZE_TEST_WORDS, 1, &from_instructions));
+
+    ASSERT_EQ(from_words.n_instructions, from_instructions.n_instructions);
+    ASSERT_EQ(from_words.duration_ms, from_instructions.duration_ms);
+    ASSERT_EQ(from_words.max_channel, from_instructions.max_channel);
+    ASSERT_EQ(from_words.max_instructions_per_ms, from_instructions.max_instructions_per_ms);
+    ASSERT_EQ(from_words.n_broadcasts, from_instructions.n_broadcasts);
+    ASSERT_EQ(from_words.n_out_of_range, from_instructions.n_out_of_range);
+    ASSERT_EQ(from_words.first_out_of_range, from_instructions.first_out_of_range);
+    ASSERT_MEM_EQ(channel_writes_words, channel_writes_instructions, sizeof(channel_writes_words));
+
+    PASS();
+}
+
+TEST out_of_range_channels_are_flagged(void) {
+    VTPPatternSummaryV1 summary;
+
+    summary.channel_writes = NULL;
+
+    ASSERT_EQ(VTP_OK, vtp_analyze_words_v1(analyze_test_words, N_ANALYZE_TEST_WORDS, 1, &summary));
+    ASSERT_EQ(3, summary.n_out_of_range);
+    ASSERT_EQ(2, summary.first_out_of_range);
+
+    PASS();
+}
+
+TEST analyzing_invalid_instruction_code_yields_error(void) {
+    VTPInstructionWord words[N_ANALYZE_TEST_WORDS];
+    VTPPatternSummaryV1 summary;
+
+    memcpy(words, analyze_test_words, sizeof(words));
+    words[5] = 0xF00007D0;
+    summary.channel_writes = NULL;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_analyze_words_v1(words, N_ANALYZE_TEST_WORDS, 3, &summary));
+    ASSERT_EQ(5, summary.n_instructions);
+    ASSERT_EQ(50, summary.duration_ms);
+
+    PASS();
+}
+
+TEST seek_index_points_to_first_pending_instruction(void) {
+    VTPSeekPointV1 seek_points[4];
+
+    vtp_build_seek_index_v1(analyze_test_words, N_ANALYZE_TEST_WORDS, 1000, seek_points, 4);
+
+    ASSERT_EQ(0, seek_points[0].milliseconds);
+    ASSERT_EQ(3, seek_points[0].instruction_index);
+    ASSERT_EQ(1000, seek_points[1].milliseconds);
+    ASSERT_EQ(5, seek_points[1].instruction_index);
+    ASSERT_EQ(2000, seek_points[2].milliseconds);
+    ASSERT_EQ(5, seek_points[2].instruction_index);
+    ASSERT_EQ(3000, seek_points[3].milliseconds);
+    ASSERT_EQ(N_ANALYZE_TEST_WORDS, seek_points[3].instruction_index);
+
+    PASS();
+}
+
+GREATEST_SUITE(analyze_suite) {
+    RUN_TEST(words_can_be_analyzed);
+    RUN_TEST(words_and_instructions_yield_same_summary);
+    RUN_TEST(out_of_range_channels_are_flagged);
+    RUN_TEST(analyzing_invalid_instruction_code_yields_error);
+    RUN_TEST(seek_index_points_to_first_pending_instruction);
+}
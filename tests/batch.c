@@ -0,0 +1,173 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/batch.h>
+
+
+#define N_BATCH_DISPLAYS (3)
+#define N_BATCH_CHANNELS (3)
+#define N_BATCH_TEST_WORDS (8)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord batch_test_words[N_BATCH_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+#define DECLARE_BATCH_TEST \
+    VTPFoldBatchV1 batch; \
+    VTPAccumulatorV1 accumulators[N_BATCH_DISPLAYS]; \
+    VTPWordCursorV1 cursors[N_BATCH_DISPLAYS]; \
+    VTPError errors[N_BATCH_DISPLAYS]; \
+    size_t heap_storage[N_BATCH_DISPLAYS]; \
+    unsigned int channels[N_BATCH_DISPLAYS][2 * N_BATCH_CHANNELS]; \
+    size_t i;
+
+/* Display 0 plays the whole pattern, display 1 starts at the 50ms mark, display 2 has nothing to play */
+#define PREPARE_BATCH_TEST \
+    memset(channels, 0, sizeof(channels)); \
+    for (i=0; i < N_BATCH_DISPLAYS; i++) { \
+        accumulators[i].n_channels = N_BATCH_CHANNELS; \
+        accumulators[i].amplitudes = channels[i]; \
+        accumulators[i].frequencies = channels[i] + N_BATCH_CHANNELS; \
+        accumulators[i].milliseconds_elapsed = 0; \
+        cursors[i].words = batch_test_words; \
+        cursors[i].n_words = N_BATCH_TEST_WORDS; \
+        cursors[i].position = 0; \
+    } \
+    cursors[1].position = 3; \
+    cursors[2].position = N_BATCH_TEST_WORDS; \
+    vtp_fold_batch_init_v1(&batch, accumulators, cursors, errors, heap_storage, N_BATCH_DISPLAYS);
+
+
+TEST batch_advances_all_displays(void) {
+    DECLARE_BATCH_TEST
+    size_t n_processed;
+
+    PREPARE_BATCH_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, 0, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(3, cursors[0].position);
+    ASSERT_EQ(3, cursors[1].position);
+    ASSERT_EQ(123, accumulators[0].amplitudes[0]);
+    ASSERT_EQ(0, accumulators[1].amplitudes[0]);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, 50, &n_processed));
+    ASSERT_EQ(4, n_processed);
+    ASSERT_EQ(5, cursors[0].position);
+    ASSERT_EQ(5, cursors[1].position);
+    ASSERT_EQ(456, accumulators[0].frequencies[1]);
+    ASSERT_EQ(456, accumulators[1].frequencies[1]);
+    ASSERT_EQ(50, accumulators[1].milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, 2049, &n_processed));
+    ASSERT_EQ(0, n_processed);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, 2050, &n_processed));
+    ASSERT_EQ(6, n_processed);
+    ASSERT_EQ(0, batch.heap_size);
+
+    for (i=0; i < 2; i++) {
+        ASSERT_EQ(N_BATCH_TEST_WORDS, cursors[i].position);
+        ASSERT_EQ(2050, accumulators[i].milliseconds_elapsed);
+        ASSERT_EQ(234, accumulators[i].amplitudes[2]);
+        ASSERT_EQ(567, accumulators[i].frequencies[1]);
+    }
+
+    ASSERT_EQ(0, accumulators[2].milliseconds_elapsed);
+    ASSERT_EQ(0, accumulators[2].amplitudes[0]);
+
+    PASS();
+}
+
+TEST batch_matches_individual_folds(void) {
+    DECLARE_BATCH_TEST
+    VTPAccumulatorV1 reference;
+    unsigned int reference_channels[2 * N_BATCH_CHANNELS];
+    size_t position, n_processed;
+    unsigned long until_ms;
+
+    PREPARE_BATCH_TEST
+
+    memset(reference_channels, 0, sizeof(reference_channels));
+    reference.n_channels = N_BATCH_CHANNELS;
+    reference.amplitudes = reference_channels;
+    reference.frequencies = reference_channels + N_BATCH_CHANNELS;
+    reference.milliseconds_elapsed = 0;
+    position = 0;
+
+    for (until_ms = 0; until_ms <= 2100; until_ms += 25) {
+        ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, until_ms, NULL));
+        ASSERT_EQ(VTP_OK, vtp_fold_words_until_v1(&reference, batch_test_words + position, N_BATCH_TEST_WORDS - position, until_ms, &n_processed));
+        position += n_processed;
+
+        ASSERT_EQ(position, cursors[0].position);
+        ASSERT_EQ(reference.milliseconds_elapsed, accumulators[0].milliseconds_elapsed);
+        ASSERT_MEM_EQ(reference_channels, channels[0], sizeof(reference_channels));
+    }
+
+    PASS();
+}
+
+TEST batch_stops_failing_displays_only(void) {
+    DECLARE_BATCH_TEST
+    VTPInstructionWord invalid_words[N_BATCH_TEST_WORDS];
+    size_t n_processed;
+
+    PREPARE_BATCH_TEST
+
+    memcpy(invalid_words, batch_test_words, sizeof(invalid_words));
+    invalid_words[4] = 0xB0100315;
+    cursors[0].words = invalid_words;
+    vtp_fold_batch_init_v1(&batch, accumulators, cursors, errors, heap_storage, N_BATCH_DISPLAYS);
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_batch_until_v1(&batch, 100, &n_processed));
+    ASSERT_EQ(6, n_processed);
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, errors[0]);
+    ASSERT_EQ(VTP_OK, errors[1]);
+    ASSERT_EQ(4, cursors[0].position);
+    ASSERT_EQ(5, cursors[1].position);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_batch_until_v1(&batch, 2050, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(4, cursors[0].position);
+
+    PASS();
+}
+
+GREATEST_SUITE(batch_suite) {
+    RUN_TEST(batch_advances_all_displays);
+    RUN_TEST(batch_matches_individual_folds);
+    RUN_TEST(batch_stops_failing_displays_only);
+}
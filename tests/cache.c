@@ -0,0 +1,240 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <vtp/cache.h>
+
+
+#define N_CACHE_TEST_WORDS (8)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const unsigned char cache_test_bytes[4 * N_CACHE_TEST_WORDS] = {
+0x10, 0x00, 0x00, 0xEA, 0x20, 0x00, 0x00, 0x7B, 0x10, 0x20, 0x01, 0x59,
+0x10, 0x20, 0xC9, 0xC8, 0x10, 0x10, 0x03, 0x15, 0x00, 0x00, 0x07, 0xD0,
+0x20, 0x00, 0x00, 0xEA, 0x10, 0x20, 0x02, 0x37
+};
+
+int n_locks, n_unlocks;
+
+void count_lock(void* context) {
+    n_locks++;
+}
+
+void count_unlock(void* context) {
+    n_unlocks++;
+}
+
+
+TEST hash_matches_fnv1a(void) {
+    const unsigned char bytes[] = { 'a' };
+
+    ASSERT_EQ(0x811c9dc5ul, vtp_hash_bytes_v1(bytes, 0));
+    ASSERT_EQ(0xe40c292cul, vtp_hash_bytes_v1(bytes, 1));
+
+    PASS();
+}
+
+TEST cached_pattern_contains_decoded_instructions_and_metadata(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* pattern;
+
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 16, 4096, 1000, NULL));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+
+    ASSERT_EQ(N_CACHE_TEST_WORDS, pattern->n_instructions);
+    ASSERT_EQ(0x1020c9c8, pattern->words[3]);
+    ASSERT_EQ(VTP_INST_SET_FREQUENCY, pattern->instructions[3].code);
+    ASSERT_EQ(50, pattern->instructions[3].params.format_b.time_offset);
+    ASSERT_EQ(456, pattern->instructions[3].params.format_b.parameter_a);
+
+    ASSERT_EQ(2050, pattern->summary.duration_ms);
+    ASSERT_EQ(2, pattern->summary.max_channel);
+
+    ASSERT_EQ(3, pattern->n_seek_points);
+    ASSERT_EQ(0, pattern->seek_points[0].milliseconds);
+    ASSERT_EQ(3, pattern->seek_points[0].instruction_index);
+    ASSERT_EQ(1000, pattern->seek_points[1].milliseconds);
+    ASSERT_EQ(5, pattern->seek_points[1].instruction_index);
+    ASSERT_EQ(2000, pattern->seek_points[2].milliseconds);
+    ASSERT_EQ(5, pattern->seek_points[2].instruction_index);
+
+    vtp_cache_release_v1(&cache, pattern);
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST repeated_lookup_yields_same_pattern(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* first;
+    const VTPCachedPatternV1* second;
+    const VTPCachedPatternV1* other;
+
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 16, 4096, 0, NULL));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &first));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &second));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS - 1, &other));
+
+    ASSERT_EQ(first, second);
+    ASSERT(first != other);
+    ASSERT_EQ(0, first->n_seek_points);
+
+    vtp_cache_release_v1(&cache, first);
+    vtp_cache_release_v1(&cache, second);
+    vtp_cache_release_v1(&cache, other);
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST least_recently_used_pattern_is_evicted(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* pattern;
+    const VTPCachedPatternV1* acquired;
+    size_t pattern_size;
+
+    /* Find out how large a single pattern is */
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 4096, 0, NULL));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+    pattern_size = pattern->size_bytes;
+    vtp_cache_release_v1(&cache, pattern);
+    vtp_cache_destroy_v1(&cache);
+
+    /* Room for two patterns of this size */
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 2 * pattern_size, 0, NULL));
+
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+    vtp_cache_release_v1(&cache, pattern);
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes + 4, N_CACHE_TEST_WORDS - 1, &pattern));
+    vtp_cache_release_v1(&cache, pattern);
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+    vtp_cache_release_v1(&cache, pattern);
+    ASSERT_EQ(N_CACHE_TEST_WORDS, cache.newest->n_instructions);
+    ASSERT_EQ(N_CACHE_TEST_WORDS - 1, cache.oldest->n_instructions);
+
+    /* Inserting a third pattern evicts the second one, as it has been used least recently */
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes + 8, N_CACHE_TEST_WORDS - 2, &acquired));
+    ASSERT_EQ(cache.newest, acquired);
+    ASSERT_EQ(cache.oldest->older, NULL);
+    ASSERT_EQ(N_CACHE_TEST_WORDS, cache.oldest->n_instructions);
+    ASSERT(cache.n_bytes <= cache.max_bytes);
+
+    /* Acquired patterns are never evicted */
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes + 12, N_CACHE_TEST_WORDS - 3, &pattern));
+    ASSERT_EQ(N_CACHE_TEST_WORDS - 2, cache.oldest->n_instructions);
+    vtp_cache_release_v1(&cache, pattern);
+
+    vtp_cache_release_v1(&cache, acquired);
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST invalid_pattern_is_not_cached(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* pattern;
+    const unsigned char invalid_bytes[8] = { 0x10, 0x00, 0x00, 0xEA, 0xF0, 0x00, 0x00, 0x00 };
+
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 4096, 0, NULL));
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_cache_acquire_v1(&cache, invalid_bytes, 2, &pattern));
+    ASSERT_EQ(0, cache.n_bytes);
+    ASSERT_EQ(NULL, cache.newest);
+
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST pattern_with_oversized_seek_index_is_rejected(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* pattern;
+    const unsigned char long_bytes[4] = { 0x0F, 0xFF, 0xFF, 0xFF };
+
+    /* time +268435455ms would need 268 million seek points at an interval of 1ms */
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 4096, 1, NULL));
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_cache_acquire_v1(&cache, long_bytes, 1, &pattern));
+    ASSERT_EQ(0, cache.n_bytes);
+    ASSERT_EQ(NULL, cache.newest);
+
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST pattern_with_overflowing_size_is_rejected(void) {
+    VTPPatternCacheV1 cache;
+    const VTPCachedPatternV1* pattern;
+    const unsigned char bytes[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+    /* The size in bytes would wrap around, so this must be rejected before any byte is read */
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 4096, 0, NULL));
+    ASSERT_EQ(VTP_OUT_OF_MEMORY, vtp_cache_acquire_v1(&cache, bytes, ((size_t)-1) / 4 + 1, &pattern));
+    ASSERT_EQ(NULL, cache.newest);
+
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+TEST all_operations_are_guarded_by_lock(void) {
+    VTPPatternCacheV1 cache;
+    VTPLockV1 lock;
+    const VTPCachedPatternV1* pattern;
+
+    lock.lock = count_lock;
+    lock.unlock = count_unlock;
+    lock.context = NULL;
+    n_locks = n_unlocks = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_cache_init_v1(&cache, 4, 4096, 0, &lock));
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+    vtp_cache_release_v1(&cache, pattern);
+    ASSERT_EQ(VTP_OK, vtp_cache_acquire_v1(&cache, cache_test_bytes, N_CACHE_TEST_WORDS, &pattern));
+    vtp_cache_release_v1(&cache, pattern);
+
+    ASSERT_EQ(5, n_locks);
+    ASSERT_EQ(n_locks, n_unlocks);
+
+    vtp_cache_destroy_v1(&cache);
+
+    PASS();
+}
+
+GREATEST_SUITE(cache_suite) {
+    RUN_TEST(hash_matches_fnv1a);
+    RUN_TEST(cached_pattern_contains_decoded_instructions_and_metadata);
+    RUN_TEST(repeated_lookup_yields_same_pattern);
+    RUN_TEST(least_recently_used_pattern_is_evicted);
+    RUN_TEST(invalid_pattern_is_not_cached);
+    RUN_TEST(pattern_with_oversized_seek_index_is_rejected);
+    RUN_TEST(pattern_with_overflowing_size_is_rejected);
+    RUN_TEST(all_operations_are_guarded_by_lock);
+}
@@ -16,6 +16,7 @@
 
 #include "../vendor/greatest/greatest.h"
 
+#include <string.h>
 #include <vtp/codec.h>
 
 
@@ -124,6 +125,15 @@ TEST invalid_instruction_code_yields_error(void) {
     PASS();
 }
 
+TEST time_offset_can_be_calculated_from_words(void) {
+    ASSERT_EQ(0x56789AB, vtp_get_word_time_offset_v1(0x056789AB));
+    ASSERT_EQ(0x333, vtp_get_word_time_offset_v1(0x2AACCD6B));
+    ASSERT_EQ(0x15A, vtp_get_word_time_offset_v1(0x1AC56BBA));
+    ASSERT_EQ(0, vtp_get_word_time_offset_v1(0xFE0FFFFF));
+
+    PASS();
+}
+
 TEST array_can_be_decoded(void) {
     const VTPInstructionWord encoded[3] = { 0x056789AB, 0x2AACCD6B, 0x1AC56BBA };
     VTPInstructionV1 decoded[3];
@@ -146,6 +156,62 @@ TEST array_can_be_decoded(void) {
     PASS();
 }
 
+TEST lenient_decode_skips_invalid_words(void) {
+    const VTPInstructionWord encoded[6] = { 0x056789AB, 0xFE000000, 0x2AACCD6B, 0x30000000, 0xF0000000, 0x1AC56BBA };
+    VTPInstructionV1 decoded[6];
+    VTPDecodeIssueV1 issues[2];
+    size_t n_out, n_issues;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_decode_instructions_lenient_v1(encoded, 6, VTP_RECOVERY_SKIP, NULL, decoded, &n_out, issues, 2, &n_issues));
+
+    ASSERT_EQ(3, n_out);
+    ASSERT_EQ(VTP_INST_INCREMENT_TIME, decoded[0].code);
+    ASSERT_EQ(VTP_INST_SET_AMPLITUDE, decoded[1].code);
+    ASSERT_EQ(0xAA, decoded[1].params.format_b.channel_select);
+    ASSERT_EQ(VTP_INST_SET_FREQUENCY, decoded[2].code);
+    ASSERT_EQ(0xAC, decoded[2].params.format_b.channel_select);
+
+    /* All invalid words are counted, even if there is no room to record them */
+    ASSERT_EQ(3, n_issues);
+    ASSERT_EQ(1, issues[0].index);
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, issues[0].error);
+    ASSERT_EQ(3, issues[1].index);
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, issues[1].error);
+
+    PASS();
+}
+
+TEST lenient_decode_substitutes_invalid_words(void) {
+    const VTPInstructionWord encoded[4] = { 0xFE000000, 0x056789AB, 0x2AACCD6B, 0xF0000000 };
+    VTPInstructionV1 decoded[4], substitute;
+    VTPDecodeIssueV1 issues[4];
+    size_t n_out, n_issues;
+
+    substitute.code = VTP_INST_INCREMENT_TIME;
+    substitute.params.format_a.parameter_a = 0;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_decode_instructions_lenient_v1(encoded, 4, VTP_RECOVERY_SUBSTITUTE, &substitute, decoded, &n_out, issues, 4, &n_issues));
+
+    ASSERT_EQ(4, n_out);
+    ASSERT_EQ(VTP_INST_INCREMENT_TIME, decoded[0].code);
+    ASSERT_EQ(0, decoded[0].params.format_a.parameter_a);
+    ASSERT_EQ(0x56789AB, decoded[1].params.format_a.parameter_a);
+    ASSERT_EQ(VTP_INST_SET_AMPLITUDE, decoded[2].code);
+    ASSERT_EQ(VTP_INST_INCREMENT_TIME, decoded[3].code);
+    ASSERT_EQ(0, decoded[3].params.format_a.parameter_a);
+
+    ASSERT_EQ(2, n_issues);
+    ASSERT_EQ(0, issues[0].index);
+    ASSERT_EQ(3, issues[1].index);
+
+    /* Valid input decodes just like with vtp_decode_instructions_v1 */
+    ASSERT_EQ(VTP_OK, vtp_decode_instructions_lenient_v1(encoded + 1, 2, VTP_RECOVERY_SUBSTITUTE, &substitute, decoded, &n_out, NULL, 0, &n_issues));
+    ASSERT_EQ(2, n_out);
+    ASSERT_EQ(0, n_issues);
+
+    PASS();
+}
+
 TEST array_can_be_encoded(void) {
     VTPInstructionV1 instructions[3];
     VTPInstructionWord encoded[3];
@@ -171,6 +237,38 @@ TEST array_can_be_encoded(void) {
     PASS();
 }
 
+TEST array_can_be_encoded_to_bytes(void) {
+    const unsigned char expected[12] = { 0x0C, 0xCC, 0xCC, 0xCD, 0x2A, 0xAC, 0xCD, 0x6B, 0x1A, 0xC5, 0x6B, 0xBA };
+    VTPInstructionV1 instructions[4];
+    unsigned char encoded[16];
+
+    instructions[0].code = VTP_INST_INCREMENT_TIME;
+    instructions[0].params.format_a.parameter_a = 0xCCCCCCD;
+
+    instructions[1].code = VTP_INST_SET_AMPLITUDE;
+    instructions[1].params.format_b.channel_select = 0xAA;
+    instructions[1].params.format_b.time_offset = 0x333;
+    instructions[1].params.format_b.parameter_a = 0x16B;
+
+    instructions[2].code = VTP_INST_SET_FREQUENCY;
+    instructions[2].params.format_b.channel_select = 0xAC;
+    instructions[2].params.format_b.time_offset = 0x15A;
+    instructions[2].params.format_b.parameter_a = 0x3BA;
+
+    ASSERT_EQ(VTP_OK, vtp_encode_bytes_v1(instructions, encoded, 3));
+    ASSERT_MEM_EQ(expected, encoded, 12);
+
+    /* Instructions before an invalid one are written, just like with vtp_encode_instructions_v1 */
+    memset(encoded, 0, sizeof(encoded));
+    instructions[3] = instructions[2];
+    instructions[2].code = (VTPInstructionCode)0xFE;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_encode_bytes_v1(instructions, encoded, 4));
+    ASSERT_MEM_EQ(expected, encoded, 8);
+
+    PASS();
+}
+
 TEST instruction_words_can_be_read_from_bytes(void) {
     VTPInstructionWord wordsRead[8];
 
@@ -200,8 +298,12 @@ GREATEST_SUITE(codec_suite) {
     RUN_TEST(set_frequency_can_be_decoded);
     RUN_TEST(set_frequency_can_be_encoded);
     RUN_TEST(invalid_instruction_code_yields_error);
+    RUN_TEST(time_offset_can_be_calculated_from_words);
     RUN_TEST(array_can_be_decoded);
+    RUN_TEST(lenient_decode_skips_invalid_words);
+    RUN_TEST(lenient_decode_substitutes_invalid_words);
     RUN_TEST(array_can_be_encoded);
+    RUN_TEST(array_can_be_encoded_to_bytes);
     RUN_TEST(instruction_words_can_be_read_from_bytes);
     RUN_TEST(instruction_words_can_be_written_to_bytes);
 }
@@ -0,0 +1,437 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/edit.h>
+#include <vtp/fold.h>
+
+
+#define N_EDIT_CHANNELS (3)
+#define N_EDIT_TEST_WORDS (8)
+#define N_EDIT_SHORT_WORDS (3)
+#define N_EDIT_RAMP_WORDS (5)
+#define N_EDIT_STEP_WORDS (3)
+#define MAX_EDIT_SEGMENTS (16)
+#define MAX_EDIT_STATES (4)
+#define MAX_EDIT_WORDS (64)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord edit_test_words[N_EDIT_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * amp ch1 10
+ * time +100ms
+ * amp ch1 20
+ */
+const VTPInstructionWord edit_short_words[N_EDIT_SHORT_WORDS] = {
+    0x2010000a, 0x00000064, 0x20100014
+};
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * amp ch1 10
+ * time +100ms
+ * amp ch1 20
+ * time +100ms
+ * amp ch1 30
+ */
+const VTPInstructionWord edit_ramp_words[N_EDIT_RAMP_WORDS] = {
+    0x2010000a, 0x00000064, 0x20100014, 0x00000064, 0x2010001e
+};
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * amp ch1 100
+ * amp +10ms ch1 200
+ * time +20ms
+ */
+const VTPInstructionWord edit_step_words[N_EDIT_STEP_WORDS] = {
+    0x20100064, 0x201028c8, 0x00000014
+};
+
+#define DECLARE_EDIT_TEST \
+    VTPEditListV1 list; \
+    VTPSegmentV1 segments[MAX_EDIT_SEGMENTS]; \
+    unsigned int states[2 * N_EDIT_CHANNELS * MAX_EDIT_STATES], output_state[2 * N_EDIT_CHANNELS]; \
+    VTPSegmentV1 pattern, short_pattern; \
+    VTPInstructionWord words[MAX_EDIT_WORDS]; \
+    size_t n_words;
+
+#define PREPARE_EDIT_TEST \
+    vtp_edit_init_v1(&list, segments, MAX_EDIT_SEGMENTS, N_EDIT_CHANNELS, states, MAX_EDIT_STATES); \
+    ASSERT_EQ(VTP_OK, vtp_segment_init_v1(&pattern, edit_test_words, N_EDIT_TEST_WORDS)); \
+    ASSERT_EQ(VTP_OK, vtp_segment_init_v1(&short_pattern, edit_short_words, N_EDIT_SHORT_WORDS)); \
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &pattern));
+
+int folds_equivalently(const VTPInstructionWord a[], size_t n_a, const VTPInstructionWord b[], size_t n_b);
+void fold_state_at(const VTPInstructionWord words[], size_t n_words, unsigned long at_ms, unsigned int channels[]);
+
+
+TEST edit_concatenate(void) {
+    DECLARE_EDIT_TEST
+    unsigned int channels[2 * N_EDIT_CHANNELS];
+    const VTPInstructionWord reset_all[] = { 0x20000000, 0x10000000 };
+    const VTPInstructionWord reset_short[] = { 0x20100000 };
+    VTPInstructionWord expected[2 * N_EDIT_TEST_WORDS + N_EDIT_SHORT_WORDS + 3];
+    size_t n_expected;
+
+    PREPARE_EDIT_TEST
+
+    ASSERT_EQ(2050, pattern.duration_ms);
+    ASSERT_EQ(100, short_pattern.duration_ms);
+
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &short_pattern));
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &pattern));
+    ASSERT_EQ(4200, vtp_edit_duration_v1(&list));
+
+    /* Every pattern starts with all channels at zero, as it would on its own */
+    n_expected = 0;
+    memcpy(expected + n_expected, edit_test_words, sizeof(edit_test_words));
+    n_expected += N_EDIT_TEST_WORDS;
+    memcpy(expected + n_expected, reset_all, sizeof(reset_all));
+    n_expected += 2;
+    memcpy(expected + n_expected, edit_short_words, sizeof(edit_short_words));
+    n_expected += N_EDIT_SHORT_WORDS;
+    memcpy(expected + n_expected, reset_short, sizeof(reset_short));
+    n_expected += 1;
+    memcpy(expected + n_expected, edit_test_words, sizeof(edit_test_words));
+    n_expected += N_EDIT_TEST_WORDS;
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, n_expected));
+
+    fold_state_at(words, n_words, 2050, channels);
+    ASSERT_EQ(10, channels[0]);
+    ASSERT_EQ(0, channels[1]);
+    ASSERT_EQ(0, channels[N_EDIT_CHANNELS]);
+
+    PASS();
+}
+
+TEST edit_insert_at_instruction(void) {
+    DECLARE_EDIT_TEST
+    unsigned int channels[2 * N_EDIT_CHANNELS];
+    const VTPInstructionWord expected[] = {
+        0x100000ea, 0x2000007b, 0x10200159, 0x00000032,
+        0x20000000, 0x10000000, 0x2010000a, 0x00000064, 0x20100014,
+        0x2000007b, 0x101000ea, 0x10200159, 0x103000ea,
+        0x102001c8, 0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+    };
+
+    PREPARE_EDIT_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_edit_insert_v1(&list, 50, &short_pattern));
+    ASSERT_EQ(3, list.n_segments);
+    ASSERT_EQ(2150, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    /* The inserted pattern doesn't leak into the rest of the pattern */
+    fold_state_at(words, n_words, 150, channels);
+    ASSERT_EQ(123, channels[0]);
+    ASSERT_EQ(789, channels[N_EDIT_CHANNELS]);
+    ASSERT_EQ(456, channels[N_EDIT_CHANNELS + 1]);
+    ASSERT_EQ(234, channels[N_EDIT_CHANNELS + 2]);
+
+    PASS();
+}
+
+TEST edit_insert_within_time_instruction(void) {
+    DECLARE_EDIT_TEST
+    const VTPInstructionWord expected[] = {
+        0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8, 0x10100315, 0x000003b6,
+        0x20000000, 0x10000000, 0x2010000a, 0x00000064, 0x20100014,
+        0x2000007b, 0x10100315, 0x102001c8, 0x103000ea,
+        0x0000041a, 0x200000ea, 0x10200237
+    };
+
+    PREPARE_EDIT_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_edit_insert_v1(&list, 1000, &short_pattern));
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    PASS();
+}
+
+TEST edit_repeat(void) {
+    DECLARE_EDIT_TEST
+    const VTPInstructionWord expected[] = {
+        0x100000ea, 0x2000007b, 0x10200159, 0x00000032,
+        0x102001c8, 0x10100315, 0x000007d0,
+        0x101000ea, 0x10200159, 0x102001c8, 0x10100315, 0x000007d0,
+        0x101000ea, 0x10200159, 0x102001c8, 0x10100315, 0x000007d0,
+        0x200000ea, 0x10200237
+    };
+
+    PREPARE_EDIT_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_edit_repeat_v1(&list, 50, 2050, 3));
+    ASSERT_EQ(6050, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    PASS();
+}
+
+TEST edit_repeat_between_instructions(void) {
+    VTPEditListV1 list;
+    VTPSegmentV1 segments[MAX_EDIT_SEGMENTS], ramp;
+    unsigned int states[2 * N_EDIT_CHANNELS * MAX_EDIT_STATES], channels[2 * N_EDIT_CHANNELS], output_state[2 * N_EDIT_CHANNELS];
+    VTPInstructionWord words[MAX_EDIT_WORDS];
+    size_t n_words;
+    const VTPInstructionWord expected[] = {
+        0x2010000a, 0x00000064, 0x20100014, 0x00000032,
+        0x2010000a, 0x00000032, 0x20100014, 0x00000064, 0x2010001e
+    };
+
+    vtp_edit_init_v1(&list, segments, MAX_EDIT_SEGMENTS, N_EDIT_CHANNELS, states, MAX_EDIT_STATES);
+    ASSERT_EQ(VTP_OK, vtp_segment_init_v1(&ramp, edit_ramp_words, N_EDIT_RAMP_WORDS));
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &ramp));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_repeat_v1(&list, 50, 150, 2));
+    ASSERT_EQ(300, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    /* The second iteration starts with the state at 50ms again */
+    fold_state_at(words, n_words, 175, channels);
+    ASSERT_EQ(10, channels[0]);
+    fold_state_at(words, n_words, 275, channels);
+    ASSERT_EQ(20, channels[0]);
+
+    PASS();
+}
+
+TEST edit_remove(void) {
+    DECLARE_EDIT_TEST
+    unsigned int channels[2 * N_EDIT_CHANNELS];
+    const VTPInstructionWord expected[] = {
+        0x100000ea, 0x2000007b, 0x10200159, 0x00000032,
+        0x10100315, 0x102001c8, 0x200000ea, 0x10200237
+    };
+
+    PREPARE_EDIT_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_edit_repeat_v1(&list, 50, 2050, 0));
+    ASSERT_EQ(50, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    /* The frequencies set within the removed section still apply after it */
+    fold_state_at(words, n_words, 50, channels);
+    ASSERT_EQ(234, channels[0]);
+    ASSERT_EQ(789, channels[N_EDIT_CHANNELS]);
+    ASSERT_EQ(567, channels[N_EDIT_CHANNELS + 1]);
+
+    PASS();
+}
+
+TEST edit_remove_before_silence(void) {
+    VTPEditListV1 list;
+    VTPSegmentV1 segments[MAX_EDIT_SEGMENTS], step;
+    unsigned int states[2 * N_EDIT_CHANNELS * MAX_EDIT_STATES], channels[2 * N_EDIT_CHANNELS], output_state[2 * N_EDIT_CHANNELS];
+    VTPInstructionWord words[MAX_EDIT_WORDS];
+    size_t n_words;
+    const VTPInstructionWord expected[] = {
+        0x20100064, 0x00000005, 0x201000c8, 0x0000000a
+    };
+
+    vtp_edit_init_v1(&list, segments, MAX_EDIT_SEGMENTS, N_EDIT_CHANNELS, states, MAX_EDIT_STATES);
+    ASSERT_EQ(VTP_OK, vtp_segment_init_v1(&step, edit_step_words, N_EDIT_STEP_WORDS));
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &step));
+
+    /* The removal leaves the silence between the last instruction and 25ms behind, right after 5ms */
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 25, NULL));
+    ASSERT_EQ(VTP_OK, vtp_edit_repeat_v1(&list, 5, 20, 0));
+    ASSERT_EQ(15, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT(folds_equivalently(words, n_words, expected, sizeof(expected) / sizeof(expected[0])));
+
+    fold_state_at(words, n_words, 5, channels);
+    ASSERT_EQ(200, channels[0]);
+
+    PASS();
+}
+
+TEST edit_resolves_inherited_states(void) {
+    DECLARE_EDIT_TEST
+    unsigned int channels[2 * N_EDIT_CHANNELS];
+
+    PREPARE_EDIT_TEST
+
+    /* The short pattern continues with the state that the pattern leaves behind */
+    short_pattern.entry_state = VTP_SEGMENT_STATE_INHERIT;
+    ASSERT_EQ(VTP_OK, vtp_edit_append_v1(&list, &short_pattern));
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 2100, NULL));
+
+    /* The padding keeps the state at the end of the list, even after inserting in front of it */
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 2200, NULL));
+    ASSERT_EQ(VTP_OK, vtp_edit_insert_v1(&list, 2175, &pattern));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+
+    fold_state_at(words, n_words, 2100, channels);
+    ASSERT_EQ(10, channels[0]);
+    ASSERT_EQ(234, channels[1]);
+    ASSERT_EQ(789, channels[N_EDIT_CHANNELS]);
+    ASSERT_EQ(567, channels[N_EDIT_CHANNELS + 1]);
+
+    fold_state_at(words, n_words, 4225, channels);
+    ASSERT_EQ(20, channels[0]);
+    ASSERT_EQ(234, channels[1]);
+    ASSERT_EQ(789, channels[N_EDIT_CHANNELS]);
+    ASSERT_EQ(567, channels[N_EDIT_CHANNELS + 1]);
+
+    PASS();
+}
+
+TEST edit_cut_pads_with_silence(void) {
+    DECLARE_EDIT_TEST
+    size_t index;
+
+    PREPARE_EDIT_TEST
+
+    /* The instructions at 2050ms are moved into a segment of their own */
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 2050, &index));
+    ASSERT_EQ(1, index);
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 2050, &index));
+    ASSERT_EQ(1, index);
+    ASSERT_EQ(2, list.n_segments);
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 3000, &index));
+    ASSERT_EQ(3, index);
+    ASSERT_EQ(3000, vtp_edit_duration_v1(&list));
+
+    ASSERT_EQ(VTP_OK, vtp_edit_flatten_v1(&list, output_state, words, MAX_EDIT_WORDS, &n_words));
+    ASSERT_EQ(N_EDIT_TEST_WORDS + 1, n_words);
+    ASSERT_EQ(0x000003b6, words[n_words - 1]);
+
+    PASS();
+}
+
+TEST edit_reports_full_buffers(void) {
+    DECLARE_EDIT_TEST
+
+    PREPARE_EDIT_TEST
+
+    list.max_segments = 2;
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_edit_repeat_v1(&list, 50, 2050, 3));
+
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_edit_flatten_v1(&list, output_state, words, 4, &n_words));
+    ASSERT_EQ(4, n_words);
+
+    /* Splitting the instruction words of a segment and padding after them need a state */
+    list.max_segments = MAX_EDIT_SEGMENTS;
+    list.max_states = list.n_states;
+    ASSERT_EQ(2, list.n_segments);
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_edit_cut_v1(&list, 1000, NULL));
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_edit_cut_v1(&list, 3000, NULL));
+    ASSERT_EQ(2, list.n_segments);
+
+    /* A cut between segments doesn't */
+    ASSERT_EQ(VTP_OK, vtp_edit_cut_v1(&list, 50, NULL));
+
+    PASS();
+}
+
+GREATEST_SUITE(edit_suite) {
+    RUN_TEST(edit_concatenate);
+    RUN_TEST(edit_insert_at_instruction);
+    RUN_TEST(edit_insert_within_time_instruction);
+    RUN_TEST(edit_repeat);
+    RUN_TEST(edit_repeat_between_instructions);
+    RUN_TEST(edit_remove);
+    RUN_TEST(edit_remove_before_silence);
+    RUN_TEST(edit_resolves_inherited_states);
+    RUN_TEST(edit_cut_pads_with_silence);
+    RUN_TEST(edit_reports_full_buffers);
+}
+
+
+/* Folds both word arrays millisecond by millisecond and compares the accumulators */
+int folds_equivalently(const VTPInstructionWord a[], size_t n_a, const VTPInstructionWord b[], size_t n_b) {
+    VTPAccumulatorV1 accumulator_a, accumulator_b;
+    unsigned int channels_a[2 * N_EDIT_CHANNELS], channels_b[2 * N_EDIT_CHANNELS];
+    size_t position_a, position_b, n_processed;
+    unsigned long until_ms;
+
+    memset(channels_a, 0, sizeof(channels_a));
+    memset(channels_b, 0, sizeof(channels_b));
+    accumulator_a.n_channels = accumulator_b.n_channels = N_EDIT_CHANNELS;
+    accumulator_a.amplitudes = channels_a;
+    accumulator_a.frequencies = channels_a + N_EDIT_CHANNELS;
+    accumulator_b.amplitudes = channels_b;
+    accumulator_b.frequencies = channels_b + N_EDIT_CHANNELS;
+    accumulator_a.milliseconds_elapsed = accumulator_b.milliseconds_elapsed = 0;
+    position_a = position_b = 0;
+
+    for (until_ms = 0; position_a < n_a || position_b < n_b; until_ms++) {
+        if (vtp_fold_words_until_v1(&accumulator_a, a + position_a, n_a - position_a, until_ms, &n_processed) != VTP_OK)
+            return 0;
+        position_a += n_processed;
+
+        if (vtp_fold_words_until_v1(&accumulator_b, b + position_b, n_b - position_b, until_ms, &n_processed) != VTP_OK)
+            return 0;
+        position_b += n_processed;
+
+        if (memcmp(channels_a, channels_b, sizeof(channels_a)) != 0)
+            return 0;
+    }
+
+    return accumulator_a.milliseconds_elapsed == accumulator_b.milliseconds_elapsed;
+}
+
+/* Folds the word array up until the given time, writing the amplitudes and then the frequencies into channels */
+void fold_state_at(const VTPInstructionWord words[], size_t n_words, unsigned long at_ms, unsigned int channels[]) {
+    VTPAccumulatorV1 accumulator;
+    size_t n_processed;
+
+    memset(channels, 0, 2 * N_EDIT_CHANNELS * sizeof(unsigned int));
+    accumulator.n_channels = N_EDIT_CHANNELS;
+    accumulator.amplitudes = channels;
+    accumulator.frequencies = channels + N_EDIT_CHANNELS;
+    accumulator.milliseconds_elapsed = 0;
+
+    vtp_fold_words_until_v1(&accumulator, words, n_words, at_ms, &n_processed);
+}
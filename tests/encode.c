@@ -0,0 +1,225 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/encode.h>
+
+
+#define N_ENCODE_CHANNELS (3)
+#define N_ENCODE_SAMPLES (40)
+#define MAX_ENCODE_WORDS (2 * N_ENCODE_CHANNELS * N_ENCODE_SAMPLES + 8)
+
+#define DECLARE_ENCODE_TEST \
+    VTPAccumulatorV1 state; \
+    VTPSamplesV1 samples; \
+    unsigned int state_channels[2 * N_ENCODE_CHANNELS]; \
+    unsigned int amplitudes[N_ENCODE_CHANNELS * N_ENCODE_SAMPLES], frequencies[N_ENCODE_CHANNELS * N_ENCODE_SAMPLES]; \
+    VTPInstructionWord words[MAX_ENCODE_WORDS]; \
+    size_t n_words;
+
+#define PREPARE_ENCODE_TEST(interval_ms) \
+    memset(state_channels, 0, sizeof(state_channels)); \
+    state.n_channels = N_ENCODE_CHANNELS; \
+    state.amplitudes = state_channels; \
+    state.frequencies = state_channels + N_ENCODE_CHANNELS; \
+    state.milliseconds_elapsed = 0; \
+    fill_encode_samples(amplitudes, frequencies); \
+    samples.n_samples = N_ENCODE_SAMPLES; \
+    samples.channel_stride = N_ENCODE_SAMPLES; \
+    samples.amplitudes = amplitudes; \
+    samples.frequencies = frequencies; \
+    samples.start_ms = 0; \
+    samples.sample_ms = interval_ms;
+
+void fill_encode_samples(unsigned int amplitudes[], unsigned int frequencies[]);
+int encoded_samples_match(const VTPInstructionWord words[], size_t n_words, const VTPSamplesV1* samples, unsigned int tolerance);
+
+
+TEST encode_round_trips_losslessly(void) {
+    DECLARE_ENCODE_TEST
+
+    PREPARE_ENCODE_TEST(1)
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, 0, words, MAX_ENCODE_WORDS, &n_words, NULL));
+    ASSERT(encoded_samples_match(words, n_words, &samples, 0));
+
+    /* ch2 frequency for each of the first 10 samples, ch* at 5ms and 15ms, ch1 at 20ms, ch3 frequency at 30ms */
+    ASSERT_EQ(14, n_words);
+    ASSERT_EQ(0x200005f4, words[5]);
+    ASSERT_EQ(0x200018fa, words[11]);
+    ASSERT_EQ(0x20101720, words[12]);
+    ASSERT_EQ(30, state.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST encode_uses_time_instructions_for_long_pauses(void) {
+    DECLARE_ENCODE_TEST
+
+    PREPARE_ENCODE_TEST(500)
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, 0, words, MAX_ENCODE_WORDS, &n_words, NULL));
+    ASSERT(encoded_samples_match(words, n_words, &samples, 0));
+
+    /* The pauses before samples 15, 20 and 30 are too long for a time offset */
+    ASSERT_EQ(17, n_words);
+    ASSERT_EQ(0x00000bb8, words[11]);
+    ASSERT_EQ(0x000009c4, words[13]);
+    ASSERT_EQ(0x00001388, words[15]);
+
+    PASS();
+}
+
+TEST encode_simplifies_within_tolerance(void) {
+    DECLARE_ENCODE_TEST
+    size_t i, n_lossless_words;
+
+    PREPARE_ENCODE_TEST(1)
+
+    for (i=0; i < N_ENCODE_SAMPLES; i++)
+        amplitudes[2 * N_ENCODE_SAMPLES + i] += i % 3;
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, 0, words, MAX_ENCODE_WORDS, &n_lossless_words, NULL));
+    ASSERT(encoded_samples_match(words, n_lossless_words, &samples, 0));
+
+    memset(state_channels, 0, sizeof(state_channels));
+    state.milliseconds_elapsed = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, 2, words, MAX_ENCODE_WORDS, &n_words, NULL));
+    ASSERT(encoded_samples_match(words, n_words, &samples, 2));
+    ASSERT(n_words < n_lossless_words);
+
+    PASS();
+}
+
+TEST encode_handles_extreme_tolerance_and_no_channels(void) {
+    DECLARE_ENCODE_TEST
+    size_t i;
+
+    PREPARE_ENCODE_TEST(1)
+
+    /* A tolerance that would wrap around when added to the current state still covers every deviation */
+    for (i=0; i < 2 * N_ENCODE_CHANNELS; i++)
+        state_channels[i] = 1000;
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, (unsigned int)-1, words, MAX_ENCODE_WORDS, &n_words, NULL));
+    ASSERT_EQ(0, n_words);
+
+    state.n_channels = 0;
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &samples, 0, words, MAX_ENCODE_WORDS, &n_words, NULL));
+    ASSERT_EQ(0, n_words);
+
+    PASS();
+}
+
+TEST encode_resumes_after_full_buffer(void) {
+    DECLARE_ENCODE_TEST
+    VTPSamplesV1 rest;
+    size_t n_samples_encoded, n_more_words;
+
+    PREPARE_ENCODE_TEST(1)
+
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_encode_samples_v1(&state, &samples, 0, words, 3, &n_words, &n_samples_encoded));
+    ASSERT_EQ(3, n_words);
+    ASSERT_EQ(3, n_samples_encoded);
+
+    rest = samples;
+    rest.n_samples -= n_samples_encoded;
+    rest.amplitudes += n_samples_encoded;
+    rest.frequencies += n_samples_encoded;
+    rest.start_ms += n_samples_encoded;
+
+    ASSERT_EQ(VTP_OK, vtp_encode_samples_v1(&state, &rest, 0, words + n_words, MAX_ENCODE_WORDS - n_words, &n_more_words, &n_samples_encoded));
+    ASSERT_EQ(N_ENCODE_SAMPLES - 3, n_samples_encoded);
+    ASSERT_EQ(14, n_words + n_more_words);
+    ASSERT(encoded_samples_match(words, n_words + n_more_words, &samples, 0));
+
+    PASS();
+}
+
+GREATEST_SUITE(encode_suite) {
+    RUN_TEST(encode_round_trips_losslessly);
+    RUN_TEST(encode_uses_time_instructions_for_long_pauses);
+    RUN_TEST(encode_simplifies_within_tolerance);
+    RUN_TEST(encode_resumes_after_full_buffer);
+    RUN_TEST(encode_handles_extreme_tolerance_and_no_channels);
+}
+
+
+/*
+ * All amplitudes step to 500 at sample 5 and to 250 at sample 15, channel 1 on its own to 800 at sample 20.
+ * The frequency of channel 2 ramps up for the first 10 samples, the frequency of channel 3 jumps at sample 30.
+ */
+void fill_encode_samples(unsigned int amplitudes[], unsigned int frequencies[]) {
+    size_t channel, i;
+
+    for (channel = 0; channel < N_ENCODE_CHANNELS; channel++) {
+        for (i=0; i < N_ENCODE_SAMPLES; i++) {
+            amplitudes[channel * N_ENCODE_SAMPLES + i] = i < 5 ? 0 : (i < 15 ? 500 : 250);
+            frequencies[channel * N_ENCODE_SAMPLES + i] = 0;
+        }
+    }
+
+    for (i=20; i < N_ENCODE_SAMPLES; i++)
+        amplitudes[i] = 800;
+
+    for (i=0; i < N_ENCODE_SAMPLES; i++) {
+        frequencies[N_ENCODE_SAMPLES + i] = i < 10 ? 100 + i : 109;
+        frequencies[2 * N_ENCODE_SAMPLES + i] = i < 30 ? 0 : 1023;
+    }
+}
+
+int encoded_samples_match(const VTPInstructionWord words[], size_t n_words, const VTPSamplesV1* samples, unsigned int tolerance) {
+    VTPInstructionV1 instructions[MAX_ENCODE_WORDS];
+    VTPAccumulatorV1 accumulator;
+    unsigned int channels[2 * N_ENCODE_CHANNELS];
+    unsigned int sample, value;
+    size_t channel, i, position, n_processed;
+
+    if (vtp_decode_instructions_v1(words, instructions, n_words) != VTP_OK)
+        return 0;
+
+    memset(channels, 0, sizeof(channels));
+    accumulator.n_channels = N_ENCODE_CHANNELS;
+    accumulator.amplitudes = channels;
+    accumulator.frequencies = channels + N_ENCODE_CHANNELS;
+    accumulator.milliseconds_elapsed = 0;
+    position = 0;
+
+    for (i=0; i < samples->n_samples; i++) {
+        if (vtp_fold_until_v1(&accumulator, instructions + position, n_words - position, samples->start_ms + i * samples->sample_ms, &n_processed) != VTP_OK)
+            return 0;
+
+        position += n_processed;
+
+        for (channel = 0; channel < N_ENCODE_CHANNELS; channel++) {
+            sample = samples->amplitudes[channel * samples->channel_stride + i];
+            value = accumulator.amplitudes[channel];
+            if (sample > value + tolerance || sample + tolerance < value)
+                return 0;
+
+            sample = samples->frequencies[channel * samples->channel_stride + i];
+            value = accumulator.frequencies[channel];
+            if (sample > value + tolerance || sample + tolerance < value)
+                return 0;
+        }
+    }
+
+    return position == n_words;
+}
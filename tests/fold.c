@@ -16,14 +16,16 @@
 
 #include "../vendor/greatest/greatest.h"
 
+#include <string.h>
 #include <vtp/fold.h>
 
 
 #define N_TEST_INSTRUCTIONS (8)
 
+/* One spare slot, so that passing the end of the array doesn't trip GCC's -Wstringop-overread */
 #define DECLARE_TEST \
     VTPAccumulatorV1 accumulator; \
-    VTPInstructionV1 instructions[N_TEST_INSTRUCTIONS]; \
+    VTPInstructionV1 instructions[N_TEST_INSTRUCTIONS + 1]; \
     unsigned int amplitudes[3], frequencies[3];
 
 #define PREPARE_TEST \
@@ -37,6 +39,21 @@
     accumulator.milliseconds_elapsed = 0; \
     accumulator.n_channels = 3; \
 
+#define DECLARE_NARROW_TEST \
+    VTPNarrowAccumulatorV1 accumulator; \
+    VTPInstructionV1 instructions[N_TEST_INSTRUCTIONS + 1]; \
+    VTPChannelStateV1 channels[3];
+
+#define PREPARE_NARROW_TEST \
+    if (vtp_decode_instructions_v1(testdata_words, instructions, N_TEST_INSTRUCTIONS) != VTP_OK) { \
+        fputs("Test data broken\n", stderr); \
+        exit(-1); \
+    } \
+     \
+    accumulator.channels = channels; \
+    accumulator.milliseconds_elapsed = 0; \
+    accumulator.n_channels = 3; \
+
 /*
  * Corresponding VTP Assembly Code:
  *
@@ -197,6 +214,396 @@ TEST fold_with_out_of_range_channel_yields_error(void) {
     PASS();
 }
 
+TEST fold_words_until_matches_fold_until(void) {
+    DECLARE_TEST
+    VTPAccumulatorV1 word_accumulator;
+    unsigned int word_amplitudes[3], word_frequencies[3];
+    const unsigned long until_ms[5] = { 0, 10, 50, 2049, 2050 };
+    size_t i, n_processed, n_word_processed, position, word_position;
+
+    PREPARE_TEST
+
+    word_accumulator = accumulator;
+    word_accumulator.amplitudes = word_amplitudes;
+    word_accumulator.frequencies = word_frequencies;
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    memset(word_amplitudes, 0, sizeof(word_amplitudes));
+    memset(word_frequencies, 0, sizeof(word_frequencies));
+    position = word_position = 0;
+
+    for (i=0; i < 5; i++) {
+        ASSERT_EQ(VTP_OK, vtp_fold_until_v1(&accumulator, instructions + position, N_TEST_INSTRUCTIONS - position, until_ms[i], &n_processed));
+        ASSERT_EQ(VTP_OK, vtp_fold_words_until_v1(&word_accumulator, testdata_words + word_position, N_TEST_INSTRUCTIONS - word_position, until_ms[i], &n_word_processed));
+
+        position += n_processed;
+        word_position += n_word_processed;
+
+        ASSERT_EQ(position, word_position);
+        ASSERT_EQ(accumulator.milliseconds_elapsed, word_accumulator.milliseconds_elapsed);
+        ASSERT_MEM_EQ(amplitudes, word_amplitudes, sizeof(amplitudes));
+        ASSERT_MEM_EQ(frequencies, word_frequencies, sizeof(frequencies));
+    }
+
+    ASSERT_EQ(N_TEST_INSTRUCTIONS, word_position);
+
+    PASS();
+}
+
+TEST fold_words_until_with_invalid_input_yields_error(void) {
+    DECLARE_TEST
+    VTPInstructionWord words[N_TEST_INSTRUCTIONS];
+    size_t n_processed;
+
+    PREPARE_TEST
+
+    memcpy(words, testdata_words, sizeof(words));
+    words[2] = 0x10A00159;
+    words[4] = 0xB0100315;
+
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, vtp_fold_words_until_v1(&accumulator, words, N_TEST_INSTRUCTIONS, 5000, &n_processed));
+    ASSERT_EQ(2, n_processed);
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_words_until_v1(&accumulator, words + 3, N_TEST_INSTRUCTIONS - 3, 5000, &n_processed));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST fold_words_and_bytes_yield_expected_accumulation(void) {
+    DECLARE_TEST
+    unsigned char bytes[4 * N_TEST_INSTRUCTIONS];
+    size_t n_processed;
+
+    PREPARE_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_fold_words_v1(&accumulator, testdata_words, N_TEST_INSTRUCTIONS));
+    ASSERT_EQ(234, accumulator.amplitudes[1]);
+    ASSERT_EQ(789, accumulator.frequencies[0]);
+    ASSERT_EQ(567, accumulator.frequencies[1]);
+    ASSERT_EQ(234, accumulator.frequencies[2]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+
+    vtp_write_instruction_words(N_TEST_INSTRUCTIONS, testdata_words, bytes);
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.milliseconds_elapsed = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_fold_bytes_until_v1(&accumulator, bytes, N_TEST_INSTRUCTIONS, 50, &n_processed));
+    ASSERT_EQ(5, n_processed);
+    ASSERT_EQ(123, accumulator.amplitudes[1]);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_bytes_v1(&accumulator, bytes + 4 * n_processed, N_TEST_INSTRUCTIONS - n_processed));
+    ASSERT_EQ(234, accumulator.amplitudes[1]);
+    ASSERT_EQ(567, accumulator.frequencies[1]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST fold_words_and_bytes_with_invalid_input_yield_error(void) {
+    DECLARE_TEST
+    VTPInstructionWord words[N_TEST_INSTRUCTIONS];
+    unsigned char bytes[4 * N_TEST_INSTRUCTIONS];
+    size_t n_processed;
+
+    PREPARE_TEST
+
+    memcpy(words, testdata_words, sizeof(words));
+    words[2] = 0x10A00159;
+    words[4] = 0xB0100315;
+    vtp_write_instruction_words(N_TEST_INSTRUCTIONS, words, bytes);
+
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, vtp_fold_words_v1(&accumulator, words, 3));
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_words_v1(&accumulator, words + 3, 2));
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, vtp_fold_bytes_v1(&accumulator, bytes, 3));
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_bytes_v1(&accumulator, bytes + 12, 2));
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_bytes_until_v1(&accumulator, bytes + 12, 2, 5000, &n_processed));
+    ASSERT_EQ(1, n_processed);
+
+    PASS();
+}
+
+TEST fold_window_until_continues_across_windows(void) {
+    DECLARE_TEST
+    VTPStreamCursorV1 cursor;
+    unsigned char bytes[4 * N_TEST_INSTRUCTIONS];
+    unsigned long window_offset;
+    int window_exhausted;
+
+    PREPARE_TEST
+
+    vtp_write_instruction_words(N_TEST_INSTRUCTIONS, testdata_words, bytes);
+    cursor.accumulator = &accumulator;
+    cursor.byte_offset = 0;
+
+    /* Windows of three words, the last one being cut short by the end of the data */
+    ASSERT_EQ(VTP_OK, vtp_fold_window_until_v1(&cursor, bytes, 0, 12, 50, &window_exhausted));
+    ASSERT_EQ(1, window_exhausted);
+    ASSERT_EQ(12, cursor.byte_offset);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_window_until_v1(&cursor, bytes + 12, 12, 12, 50, &window_exhausted));
+    ASSERT_EQ(0, window_exhausted);
+    ASSERT_EQ(20, cursor.byte_offset);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    /* Resuming within the same window, which starts before the cursor */
+    ASSERT_EQ(VTP_OK, vtp_fold_window_until_v1(&cursor, bytes + 12, 12, 12, 5000, &window_exhausted));
+    ASSERT_EQ(1, window_exhausted);
+    ASSERT_EQ(24, cursor.byte_offset);
+
+    for (window_offset = 24; window_offset < sizeof(bytes); window_offset += 12) {
+        ASSERT_EQ(VTP_OK, vtp_fold_window_until_v1(&cursor, bytes + window_offset, window_offset, sizeof(bytes) - window_offset < 12 ? sizeof(bytes) - window_offset : 12, 5000, &window_exhausted));
+        ASSERT_EQ(1, window_exhausted);
+    }
+
+    ASSERT_EQ(sizeof(bytes), cursor.byte_offset);
+    ASSERT_EQ(234, accumulator.amplitudes[1]);
+    ASSERT_EQ(567, accumulator.frequencies[1]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+
+    /* A window past the end of the data doesn't contain any words */
+    ASSERT_EQ(VTP_OK, vtp_fold_window_until_v1(&cursor, bytes, sizeof(bytes), 0, 5000, &window_exhausted));
+    ASSERT_EQ(1, window_exhausted);
+    ASSERT_EQ(sizeof(bytes), cursor.byte_offset);
+
+    PASS();
+}
+
+TEST fold_window_until_with_invalid_input_yields_error(void) {
+    DECLARE_TEST
+    VTPStreamCursorV1 cursor;
+    VTPInstructionWord words[N_TEST_INSTRUCTIONS];
+    unsigned char bytes[4 * N_TEST_INSTRUCTIONS];
+    int window_exhausted;
+
+    PREPARE_TEST
+
+    memcpy(words, testdata_words, sizeof(words));
+    words[4] = 0xB0100315;
+    vtp_write_instruction_words(N_TEST_INSTRUCTIONS, words, bytes);
+    cursor.accumulator = &accumulator;
+    cursor.byte_offset = 0;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_window_until_v1(&cursor, bytes, 0, sizeof(bytes), 5000, &window_exhausted));
+    ASSERT_EQ(0, window_exhausted);
+    ASSERT_EQ(16, cursor.byte_offset);
+
+    PASS();
+}
+
+TEST fold_window_until_after_cursor_yields_error(void) {
+    DECLARE_TEST
+    VTPStreamCursorV1 cursor;
+    unsigned char bytes[4 * N_TEST_INSTRUCTIONS];
+    int window_exhausted;
+
+    PREPARE_TEST
+
+    vtp_write_instruction_words(N_TEST_INSTRUCTIONS, testdata_words, bytes);
+    cursor.accumulator = &accumulator;
+    cursor.byte_offset = 4;
+
+    /* The window skips the word at the cursor, so nothing can be folded */
+    window_exhausted = 1;
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_fold_window_until_v1(&cursor, bytes + 8, 8, sizeof(bytes) - 8, 5000, &window_exhausted));
+    ASSERT_EQ(0, window_exhausted);
+    ASSERT_EQ(4, cursor.byte_offset);
+    ASSERT_EQ(0, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST fold_words_at_matches_fold_words_until(void) {
+    DECLARE_TEST
+    VTPWordCursorV1 cursor;
+    const unsigned long times_ms[7] = { 0, 10, 50, 50, 2049, 2050, 5000 };
+    unsigned int row_amplitudes[7 * 3], row_frequencies[7 * 3];
+    size_t i, n_written;
+
+    PREPARE_TEST
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    cursor.words = testdata_words;
+    cursor.n_words = N_TEST_INSTRUCTIONS;
+    cursor.position = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_fold_words_at_v1(&accumulator, &cursor, times_ms, 7, row_amplitudes, row_frequencies, &n_written));
+    ASSERT_EQ(7, n_written);
+    ASSERT_EQ(N_TEST_INSTRUCTIONS, cursor.position);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+    ASSERT_MEM_EQ(&row_amplitudes[6 * 3], amplitudes, sizeof(amplitudes));
+    ASSERT_MEM_EQ(&row_frequencies[6 * 3], frequencies, sizeof(frequencies));
+
+    /* Each row must match folding from the start up until its time */
+    for (i=0; i < 7; i++) {
+        memset(amplitudes, 0, sizeof(amplitudes));
+        memset(frequencies, 0, sizeof(frequencies));
+        accumulator.milliseconds_elapsed = 0;
+        ASSERT_EQ(VTP_OK, vtp_fold_words_until_v1(&accumulator, testdata_words, N_TEST_INSTRUCTIONS, times_ms[i], NULL));
+        ASSERT_MEM_EQ(amplitudes, &row_amplitudes[i * 3], sizeof(amplitudes));
+        ASSERT_MEM_EQ(frequencies, &row_frequencies[i * 3], sizeof(frequencies));
+    }
+
+    PASS();
+}
+
+TEST fold_words_at_can_be_split_into_chunks(void) {
+    DECLARE_TEST
+    VTPWordCursorV1 cursor;
+    const unsigned long times_ms[6] = { 0, 10, 50, 2049, 2050, 5000 };
+    unsigned int row_amplitudes[6 * 3], row_frequencies[6 * 3];
+    unsigned int chunk_amplitudes[6 * 3], chunk_frequencies[6 * 3];
+    size_t n_written;
+
+    PREPARE_TEST
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    cursor.words = testdata_words;
+    cursor.n_words = N_TEST_INSTRUCTIONS;
+    cursor.position = 0;
+    ASSERT_EQ(VTP_OK, vtp_fold_words_at_v1(&accumulator, &cursor, times_ms, 6, row_amplitudes, row_frequencies, NULL));
+
+    /* The second chunk starts from an accumulator that has been folded up until its first time */
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.milliseconds_elapsed = 0;
+    ASSERT_EQ(VTP_OK, vtp_fold_words_until_v1(&accumulator, testdata_words, N_TEST_INSTRUCTIONS, times_ms[3], &cursor.position));
+    ASSERT_EQ(VTP_OK, vtp_fold_words_at_v1(&accumulator, &cursor, times_ms + 3, 3, chunk_amplitudes + 3 * 3, chunk_frequencies + 3 * 3, &n_written));
+    ASSERT_EQ(3, n_written);
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.milliseconds_elapsed = 0;
+    cursor.position = 0;
+    ASSERT_EQ(VTP_OK, vtp_fold_words_at_v1(&accumulator, &cursor, times_ms, 3, chunk_amplitudes, chunk_frequencies, &n_written));
+    ASSERT_EQ(3, n_written);
+
+    ASSERT_MEM_EQ(row_amplitudes, chunk_amplitudes, sizeof(row_amplitudes));
+    ASSERT_MEM_EQ(row_frequencies, chunk_frequencies, sizeof(row_frequencies));
+
+    PASS();
+}
+
+TEST fold_words_at_with_invalid_input_yields_error(void) {
+    DECLARE_TEST
+    VTPWordCursorV1 cursor;
+    VTPInstructionWord words[N_TEST_INSTRUCTIONS];
+    const unsigned long times_ms[3] = { 0, 50, 5000 };
+    unsigned int row_amplitudes[3 * 3], row_frequencies[3 * 3];
+    size_t n_written;
+
+    PREPARE_TEST
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    memcpy(words, testdata_words, sizeof(words));
+    words[4] = 0xB0100315;
+    cursor.words = words;
+    cursor.n_words = N_TEST_INSTRUCTIONS;
+    cursor.position = 0;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_words_at_v1(&accumulator, &cursor, times_ms, 3, row_amplitudes, row_frequencies, &n_written));
+    ASSERT_EQ(1, n_written);
+    ASSERT_EQ(4, cursor.position);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST broadcast_sets_all_channels(void) {
+    VTPAccumulatorV1 accumulator;
+    VTPInstructionV1 instruction;
+    unsigned int amplitudes[256], frequencies[256];
+    unsigned char n_channels[4] = { 1, 13, 16, 255 };
+    size_t i, j;
+
+    instruction.code = VTP_INST_SET_AMPLITUDE;
+    instruction.params.format_b.channel_select = 0;
+    instruction.params.format_b.time_offset = 0;
+    instruction.params.format_b.parameter_a = 1023;
+
+    for (i=0; i < 4; i++) {
+        memset(amplitudes, 0, sizeof(amplitudes));
+
+        accumulator.amplitudes = amplitudes;
+        accumulator.frequencies = frequencies;
+        accumulator.milliseconds_elapsed = 0;
+        accumulator.n_channels = n_channels[i];
+
+        ASSERT_EQ(VTP_OK, vtp_fold_single_v1(&accumulator, &instruction));
+
+        for (j=0; j < n_channels[i]; j++)
+            ASSERT_EQ(1023, amplitudes[j]);
+
+        ASSERT_EQ(0, amplitudes[n_channels[i]]);
+    }
+
+    PASS();
+}
+
+TEST narrow_fold_yields_expected_accumulation(void) {
+    DECLARE_NARROW_TEST
+
+    PREPARE_NARROW_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_fold_narrow_v1(&accumulator, instructions, N_TEST_INSTRUCTIONS));
+
+    ASSERT_EQ(234, channels[0].amplitude);
+    ASSERT_EQ(234, channels[1].amplitude);
+    ASSERT_EQ(234, channels[2].amplitude);
+    ASSERT_EQ(789, channels[0].frequency);
+    ASSERT_EQ(567, channels[1].frequency);
+    ASSERT_EQ(234, channels[2].frequency);
+
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST narrow_fold_until_stops_at_the_right_time(void) {
+    DECLARE_NARROW_TEST
+    size_t n_processed;
+
+    PREPARE_NARROW_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_fold_until_narrow_v1(&accumulator, instructions, N_TEST_INSTRUCTIONS, 50, &n_processed));
+    ASSERT_EQ(5, n_processed);
+    ASSERT_EQ(123, channels[0].amplitude);
+    ASSERT_EQ(789, channels[0].frequency);
+    ASSERT_EQ(456, channels[1].frequency);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_until_narrow_v1(&accumulator, instructions + 5, N_TEST_INSTRUCTIONS - 5, 2049, &n_processed));
+    ASSERT_EQ(0, n_processed);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST narrow_fold_with_invalid_input_yields_error(void) {
+    DECLARE_NARROW_TEST
+
+    PREPARE_NARROW_TEST
+
+    instructions[2].params.format_b.channel_select = 23;
+    instructions[4].code = 0xAB;
+
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, vtp_fold_narrow_v1(&accumulator, instructions, 3));
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_narrow_v1(&accumulator, instructions + 3, 2));
+
+    PASS();
+}
+
 GREATEST_SUITE(fold_suite) {
     RUN_TEST(fold_yields_expected_accumulation);
     RUN_TEST(fold_until_stops_at_the_right_time);
@@ -204,4 +611,18 @@ GREATEST_SUITE(fold_suite) {
     RUN_TEST(fold_with_invalid_instruction_code_yields_error);
     RUN_TEST(fold_with_no_instructions_does_nothing);
     RUN_TEST(fold_with_out_of_range_channel_yields_error);
+    RUN_TEST(fold_words_until_matches_fold_until);
+    RUN_TEST(fold_words_until_with_invalid_input_yields_error);
+    RUN_TEST(fold_words_and_bytes_yield_expected_accumulation);
+    RUN_TEST(fold_words_and_bytes_with_invalid_input_yield_error);
+    RUN_TEST(fold_window_until_continues_across_windows);
+    RUN_TEST(fold_window_until_with_invalid_input_yields_error);
+    RUN_TEST(fold_window_until_after_cursor_yields_error);
+    RUN_TEST(fold_words_at_matches_fold_words_until);
+    RUN_TEST(fold_words_at_can_be_split_into_chunks);
+    RUN_TEST(fold_words_at_with_invalid_input_yields_error);
+    RUN_TEST(broadcast_sets_all_channels);
+    RUN_TEST(narrow_fold_yields_expected_accumulation);
+    RUN_TEST(narrow_fold_until_stops_at_the_right_time);
+    RUN_TEST(narrow_fold_with_invalid_input_yields_error);
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/fold.h>
+#include <vtp/fold_fixed.h>
+
+
+#define N_FIXED_TEST_WORDS (8)
+
+VTP_DECLARE_FIXED_FOLD_V1(TestDisplay3, test_display3, 3)
+VTP_DEFINE_FIXED_FOLD_V1(TestDisplay3, test_display3, 3)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord fixed_test_words[N_FIXED_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+
+TEST fixed_fold_matches_generic_fold(void) {
+    TestDisplay3 fixed;
+    VTPAccumulatorV1 accumulator;
+    VTPInstructionV1 instructions[N_FIXED_TEST_WORDS];
+    unsigned int amplitudes[3], frequencies[3];
+
+    memset(&fixed, 0, sizeof(fixed));
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.n_channels = 3;
+    accumulator.amplitudes = amplitudes;
+    accumulator.frequencies = frequencies;
+    accumulator.milliseconds_elapsed = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_decode_instructions_v1(fixed_test_words, instructions, N_FIXED_TEST_WORDS));
+    ASSERT_EQ(VTP_OK, test_display3_fold_v1(&fixed, instructions, N_FIXED_TEST_WORDS));
+    ASSERT_EQ(VTP_OK, vtp_fold_v1(&accumulator, instructions, N_FIXED_TEST_WORDS));
+
+    ASSERT_MEM_EQ(amplitudes, fixed.amplitudes, sizeof(amplitudes));
+    ASSERT_MEM_EQ(frequencies, fixed.frequencies, sizeof(frequencies));
+    ASSERT_EQ(2050, fixed.milliseconds_elapsed);
+
+    memset(&fixed, 0, sizeof(fixed));
+    ASSERT_EQ(VTP_OK, test_display3_fold_words_v1(&fixed, fixed_test_words, N_FIXED_TEST_WORDS));
+    ASSERT_MEM_EQ(amplitudes, fixed.amplitudes, sizeof(amplitudes));
+    ASSERT_MEM_EQ(frequencies, fixed.frequencies, sizeof(frequencies));
+    ASSERT_EQ(2050, fixed.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST fixed_fold_until(void) {
+    TestDisplay3 fixed;
+    VTPInstructionV1 instructions[N_FIXED_TEST_WORDS];
+    size_t n_processed;
+
+    memset(&fixed, 0, sizeof(fixed));
+    ASSERT_EQ(VTP_OK, vtp_decode_instructions_v1(fixed_test_words, instructions, N_FIXED_TEST_WORDS));
+
+    ASSERT_EQ(VTP_OK, test_display3_fold_until_v1(&fixed, instructions, N_FIXED_TEST_WORDS, 49, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(345, fixed.frequencies[1]);
+
+    ASSERT_EQ(VTP_OK, test_display3_fold_words_until_v1(&fixed, fixed_test_words + 3, N_FIXED_TEST_WORDS - 3, 2049, &n_processed));
+    ASSERT_EQ(2, n_processed);
+    ASSERT_EQ(456, fixed.frequencies[1]);
+    ASSERT_EQ(789, fixed.frequencies[0]);
+    ASSERT_EQ(50, fixed.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST fixed_fold_reports_errors(void) {
+    TestDisplay3 fixed;
+    VTPInstructionWord words[3] = { 0x2000007b, 0x20400001, 0xB0100315 };
+    size_t n_processed;
+
+    memset(&fixed, 0, sizeof(fixed));
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, test_display3_fold_words_until_v1(&fixed, words, 3, 100, &n_processed));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, test_display3_fold_words_v1(&fixed, words + 2, 1));
+
+    PASS();
+}
+
+GREATEST_SUITE(fold_fixed_suite) {
+    RUN_TEST(fixed_fold_matches_generic_fold);
+    RUN_TEST(fixed_fold_until);
+    RUN_TEST(fixed_fold_reports_errors);
+}
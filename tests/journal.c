@@ -0,0 +1,200 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/journal.h>
+
+
+#define N_JOURNAL_TEST_WORDS (8)
+#define N_JOURNAL_TEST_CHANNELS (3)
+
+/* One spare slot, so that passing the end of the array doesn't trip GCC's -Wstringop-overread */
+#define DECLARE_JOURNAL_TEST \
+    VTPAccumulatorV1 accumulator; \
+    VTPJournalV1 journal; \
+    VTPJournalEntryV1 entries[4 * N_JOURNAL_TEST_WORDS + 1]; \
+    unsigned int amplitudes[N_JOURNAL_TEST_CHANNELS], frequencies[N_JOURNAL_TEST_CHANNELS];
+
+#define PREPARE_JOURNAL_TEST \
+    memset(amplitudes, 0, sizeof(amplitudes)); \
+    memset(frequencies, 0, sizeof(frequencies)); \
+    accumulator.n_channels = N_JOURNAL_TEST_CHANNELS; \
+    accumulator.amplitudes = amplitudes; \
+    accumulator.frequencies = frequencies; \
+    accumulator.milliseconds_elapsed = 0; \
+    vtp_journal_init_v1(&journal, entries, 4 * N_JOURNAL_TEST_WORDS);
+
+#define ASSERT_SAME_ACCUMULATION(expected, actual) \
+    ASSERT_MEM_EQ((expected).amplitudes, (actual).amplitudes, N_JOURNAL_TEST_CHANNELS * sizeof(unsigned int)); \
+    ASSERT_MEM_EQ((expected).frequencies, (actual).frequencies, N_JOURNAL_TEST_CHANNELS * sizeof(unsigned int)); \
+    ASSERT_EQ((expected).milliseconds_elapsed, (actual).milliseconds_elapsed);
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq +3ms ch* 100
+ */
+const VTPInstructionWord journal_test_words[N_JOURNAL_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10000c64
+};
+
+void fold_journal_reference(VTPAccumulatorV1* reference, unsigned long until_ms, size_t* n_processed);
+
+
+TEST unfold_until_matches_fold_until(void) {
+    DECLARE_JOURNAL_TEST
+    VTPAccumulatorV1 reference;
+    unsigned long targets[6] = { 0, 49, 50, 2049, 2050, 2053 };
+    size_t i, n_processed, n_undone, n_reference;
+
+    for (i=0; i < 6; i++) {
+        PREPARE_JOURNAL_TEST
+
+        ASSERT_EQ(VTP_OK, vtp_fold_words_until_journaled_v1(&accumulator, &journal, journal_test_words, N_JOURNAL_TEST_WORDS, 5000, &n_processed));
+        ASSERT_EQ(N_JOURNAL_TEST_WORDS, n_processed);
+
+        ASSERT_EQ(VTP_OK, vtp_unfold_until_v1(&accumulator, &journal, targets[i], &n_undone));
+        fold_journal_reference(&reference, targets[i], &n_reference);
+
+        ASSERT_EQ(N_JOURNAL_TEST_WORDS - n_reference, n_undone);
+        ASSERT_SAME_ACCUMULATION(reference, accumulator);
+
+        /* Folding forward again from where unfolding has moved the cursor to */
+        ASSERT_EQ(VTP_OK, vtp_fold_words_until_journaled_v1(&accumulator, &journal, journal_test_words + n_reference, n_undone, 5000, &n_processed));
+        fold_journal_reference(&reference, 5000, NULL);
+        ASSERT_SAME_ACCUMULATION(reference, accumulator);
+    }
+
+    PASS();
+}
+
+TEST unfold_restores_broadcasts_per_channel(void) {
+    DECLARE_JOURNAL_TEST
+    size_t n_processed, n_undone;
+
+    PREPARE_JOURNAL_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_fold_words_until_journaled_v1(&accumulator, &journal, journal_test_words, N_JOURNAL_TEST_WORDS - 1, 5000, &n_processed));
+
+    /* Broadcasts over equal channels take one entry, the last broadcast over differing frequencies one per channel */
+    ASSERT_EQ(N_JOURNAL_TEST_WORDS - 1, journal.n_entries);
+    ASSERT_EQ(VTP_OK, vtp_fold_words_until_journaled_v1(&accumulator, &journal, journal_test_words + N_JOURNAL_TEST_WORDS - 1, 1, 5000, &n_processed));
+    ASSERT_EQ(N_JOURNAL_TEST_WORDS - 1 + N_JOURNAL_TEST_CHANNELS, journal.n_entries);
+    ASSERT_EQ(100, accumulator.frequencies[0]);
+    ASSERT_EQ(100, accumulator.frequencies[1]);
+    ASSERT_EQ(2053, accumulator.milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_unfold_v1(&accumulator, &journal, 1, &n_undone));
+    ASSERT_EQ(1, n_undone);
+    ASSERT_EQ(N_JOURNAL_TEST_WORDS - 1, journal.n_entries);
+    ASSERT_EQ(789, accumulator.frequencies[0]);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(234, accumulator.frequencies[2]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_unfold_v1(&accumulator, &journal, N_JOURNAL_TEST_WORDS, &n_undone));
+    ASSERT_EQ(N_JOURNAL_TEST_WORDS - 1, n_undone);
+    ASSERT_EQ(0, journal.n_entries);
+    ASSERT_EQ(0, accumulator.amplitudes[0]);
+    ASSERT_EQ(0, accumulator.frequencies[1]);
+    ASSERT_EQ(0, accumulator.milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST full_journal_drops_oldest_words(void) {
+    DECLARE_JOURNAL_TEST
+    VTPAccumulatorV1 reference;
+    size_t n_processed, n_undone, n_reference;
+
+    PREPARE_JOURNAL_TEST
+
+    /* Room for the last broadcast and two more words */
+    vtp_journal_init_v1(&journal, entries, N_JOURNAL_TEST_CHANNELS + 2);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_words_until_journaled_v1(&accumulator, &journal, journal_test_words, N_JOURNAL_TEST_WORDS, 5000, &n_processed));
+    ASSERT_EQ(N_JOURNAL_TEST_CHANNELS + 2, journal.n_entries);
+
+    /* The journal holds the time instruction and the two broadcasts after it */
+    ASSERT_EQ(VTP_OK, vtp_unfold_until_v1(&accumulator, &journal, 2000, &n_undone));
+    ASSERT_EQ(3, n_undone);
+    fold_journal_reference(&reference, 2000, &n_reference);
+    ASSERT_EQ(N_JOURNAL_TEST_WORDS - 3, n_reference);
+    ASSERT_SAME_ACCUMULATION(reference, accumulator);
+
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_unfold_until_v1(&accumulator, &journal, 0, &n_undone));
+    ASSERT_EQ(0, n_undone);
+    ASSERT_SAME_ACCUMULATION(reference, accumulator);
+
+    PASS();
+}
+
+TEST journaled_fold_with_invalid_input_yields_error(void) {
+    DECLARE_JOURNAL_TEST
+    VTPInstructionWord words[N_JOURNAL_TEST_WORDS];
+    size_t n_processed;
+
+    PREPARE_JOURNAL_TEST
+
+    memcpy(words, journal_test_words, sizeof(words));
+    words[2] = 0x10A01559;
+    words[4] = 0xB0100315;
+
+    /* Like vtp_fold_words_until_v1, the time offset of a word with an out-of-range channel is still applied */
+    ASSERT_EQ(VTP_CHANNEL_OUT_OF_RANGE, vtp_fold_words_until_journaled_v1(&accumulator, &journal, words, N_JOURNAL_TEST_WORDS, 5000, &n_processed));
+    ASSERT_EQ(2, n_processed);
+    ASSERT_EQ(2, journal.n_entries);
+    ASSERT_EQ(5, accumulator.milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_fold_words_until_journaled_v1(&accumulator, &journal, words + 3, N_JOURNAL_TEST_WORDS - 3, 5000, &n_processed));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(3, journal.n_entries);
+
+    PASS();
+}
+
+GREATEST_SUITE(journal_suite) {
+    RUN_TEST(unfold_until_matches_fold_until);
+    RUN_TEST(unfold_restores_broadcasts_per_channel);
+    RUN_TEST(full_journal_drops_oldest_words);
+    RUN_TEST(journaled_fold_with_invalid_input_yields_error);
+}
+
+
+void fold_journal_reference(VTPAccumulatorV1* reference, unsigned long until_ms, size_t* n_processed) {
+    static unsigned int amplitudes[N_JOURNAL_TEST_CHANNELS], frequencies[N_JOURNAL_TEST_CHANNELS];
+
+    reference->n_channels = N_JOURNAL_TEST_CHANNELS;
+    reference->amplitudes = amplitudes;
+    reference->frequencies = frequencies;
+    memset(reference->amplitudes, 0, N_JOURNAL_TEST_CHANNELS * sizeof(unsigned int));
+    memset(reference->frequencies, 0, N_JOURNAL_TEST_CHANNELS * sizeof(unsigned int));
+    reference->milliseconds_elapsed = 0;
+
+    vtp_fold_words_until_v1(reference, journal_test_words, N_JOURNAL_TEST_WORDS, until_ms, n_processed);
+}
@@ -18,12 +18,36 @@
 
 GREATEST_MAIN_DEFS();
 
+GREATEST_SUITE_EXTERN(analyze_suite);
+GREATEST_SUITE_EXTERN(batch_suite);
+GREATEST_SUITE_EXTERN(cache_suite);
 GREATEST_SUITE_EXTERN(codec_suite);
+GREATEST_SUITE_EXTERN(edit_suite);
+GREATEST_SUITE_EXTERN(encode_suite);
 GREATEST_SUITE_EXTERN(fold_suite);
+GREATEST_SUITE_EXTERN(fold_fixed_suite);
+GREATEST_SUITE_EXTERN(journal_suite);
+GREATEST_SUITE_EXTERN(pool_suite);
+GREATEST_SUITE_EXTERN(reader_suite);
+GREATEST_SUITE_EXTERN(render_suite);
+GREATEST_SUITE_EXTERN(timing_wheel_suite);
+GREATEST_SUITE_EXTERN(transform_suite);
 
 int main(int argc, char ** argv) {
     GREATEST_MAIN_BEGIN();
+    RUN_SUITE(analyze_suite);
+    RUN_SUITE(batch_suite);
+    RUN_SUITE(cache_suite);
     RUN_SUITE(codec_suite);
+    RUN_SUITE(edit_suite);
+    RUN_SUITE(encode_suite);
     RUN_SUITE(fold_suite);
+    RUN_SUITE(fold_fixed_suite);
+    RUN_SUITE(journal_suite);
+    RUN_SUITE(pool_suite);
+    RUN_SUITE(reader_suite);
+    RUN_SUITE(render_suite);
+    RUN_SUITE(timing_wheel_suite);
+    RUN_SUITE(transform_suite);
     GREATEST_MAIN_END();
 }
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <vtp/pool.h>
+
+
+TEST arena_serves_aligned_allocations_until_exhausted(void) {
+    VTPArenaV1 arena;
+    VTPInstructionWord* words;
+    VTPInstructionV1* instructions;
+
+    ASSERT_EQ(VTP_OK, vtp_arena_init_v1(&arena, NULL, 3 * sizeof(VTPInstructionWord) + 4 * sizeof(VTPInstructionV1)));
+
+    words = vtp_arena_alloc_words_v1(&arena, 3);
+    instructions = vtp_arena_alloc_instructions_v1(&arena, 4);
+
+    ASSERT(words != NULL);
+    ASSERT(instructions != NULL);
+    ASSERT((unsigned char*)instructions >= (unsigned char*)(words + 3));
+    ASSERT_EQ(0, ((unsigned char*)instructions - arena.memory) % sizeof(VTPInstructionWord));
+
+    words[0] = 0x100000ea;
+    instructions[3].code = VTP_INST_SET_AMPLITUDE;
+
+    ASSERT_EQ(NULL, vtp_arena_alloc_words_v1(&arena, 1));
+    ASSERT_EQ(NULL, vtp_arena_alloc_instructions_v1(&arena, (size_t)-1));
+
+    vtp_arena_reset_v1(&arena);
+    ASSERT_EQ(words, vtp_arena_alloc_words_v1(&arena, 3));
+
+    vtp_arena_destroy_v1(&arena);
+
+    PASS();
+}
+
+TEST arena_can_use_caller_memory(void) {
+    VTPArenaV1 arena;
+    VTPInstructionWord memory[4];
+
+    ASSERT_EQ(VTP_OK, vtp_arena_init_v1(&arena, memory, sizeof(memory)));
+    ASSERT_EQ(memory, vtp_arena_alloc_words_v1(&arena, 4));
+    ASSERT_EQ(NULL, vtp_arena_alloc_words_v1(&arena, 1));
+
+    vtp_arena_destroy_v1(&arena);
+
+    PASS();
+}
+
+TEST pooled_accumulators_are_aligned_and_contiguous(void) {
+    VTPAccumulatorPoolV1 pool;
+    VTPAccumulatorV1* first;
+    VTPAccumulatorV1* second;
+
+    ASSERT_EQ(VTP_OK, vtp_accumulator_pool_init_v1(&pool, 2, 3));
+
+    first = vtp_accumulator_pool_acquire_v1(&pool);
+    second = vtp_accumulator_pool_acquire_v1(&pool);
+
+    ASSERT(first != NULL);
+    ASSERT(second != NULL);
+    ASSERT_EQ(3, first->n_channels);
+    ASSERT_EQ(first->amplitudes + 3, first->frequencies);
+    ASSERT_EQ(0, (size_t)first->amplitudes % VTP_CACHE_LINE_SIZE);
+    ASSERT_EQ(0, (size_t)second->amplitudes % VTP_CACHE_LINE_SIZE);
+    ASSERT_EQ((unsigned char*)first->amplitudes + VTP_CACHE_LINE_SIZE, (unsigned char*)second->amplitudes);
+
+    vtp_accumulator_pool_destroy_v1(&pool);
+
+    PASS();
+}
+
+TEST pooled_accumulators_are_handed_out_zeroed(void) {
+    VTPAccumulatorPoolV1 pool;
+    VTPAccumulatorV1* accumulator;
+
+    ASSERT_EQ(VTP_OK, vtp_accumulator_pool_init_v1(&pool, 1, 2));
+
+    accumulator = vtp_accumulator_pool_acquire_v1(&pool);
+    accumulator->amplitudes[1] = 123;
+    accumulator->frequencies[0] = 234;
+    accumulator->milliseconds_elapsed = 2050;
+
+    ASSERT_EQ(NULL, vtp_accumulator_pool_acquire_v1(&pool));
+
+    vtp_accumulator_pool_release_v1(&pool, accumulator);
+    accumulator = vtp_accumulator_pool_acquire_v1(&pool);
+
+    ASSERT_EQ(0, accumulator->amplitudes[1]);
+    ASSERT_EQ(0, accumulator->frequencies[0]);
+    ASSERT_EQ(0, accumulator->milliseconds_elapsed);
+
+    vtp_accumulator_pool_destroy_v1(&pool);
+
+    PASS();
+}
+
+TEST accumulator_pool_can_be_reset(void) {
+    VTPAccumulatorPoolV1 pool;
+    VTPAccumulatorV1* first;
+
+    ASSERT_EQ(VTP_OK, vtp_accumulator_pool_init_v1(&pool, 3, 8));
+
+    first = vtp_accumulator_pool_acquire_v1(&pool);
+    vtp_accumulator_pool_acquire_v1(&pool);
+    vtp_accumulator_pool_acquire_v1(&pool);
+    ASSERT_EQ(NULL, vtp_accumulator_pool_acquire_v1(&pool));
+
+    vtp_accumulator_pool_reset_v1(&pool);
+
+    ASSERT_EQ(3, pool.n_free);
+    ASSERT_EQ(first, vtp_accumulator_pool_acquire_v1(&pool));
+
+    vtp_accumulator_pool_destroy_v1(&pool);
+
+    PASS();
+}
+
+TEST arena_rejects_zero_capacity(void) {
+    VTPArenaV1 arena;
+
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_arena_init_v1(&arena, NULL, 0));
+
+    PASS();
+}
+
+TEST accumulator_pool_rejects_oversized_pools(void) {
+    VTPAccumulatorPoolV1 pool;
+
+    ASSERT_EQ(VTP_OUT_OF_MEMORY, vtp_accumulator_pool_init_v1(&pool, (size_t)-1 / 2, 8));
+    ASSERT_EQ(VTP_OUT_OF_MEMORY, vtp_accumulator_pool_init_v1(&pool, (size_t)-1, 0));
+
+    PASS();
+}
+
+TEST releasing_twice_is_ignored(void) {
+    VTPAccumulatorPoolV1 pool;
+    VTPAccumulatorV1* first;
+    VTPAccumulatorV1* second;
+    VTPAccumulatorV1 foreign;
+
+    ASSERT_EQ(VTP_OK, vtp_accumulator_pool_init_v1(&pool, 2, 2));
+
+    first = vtp_accumulator_pool_acquire_v1(&pool);
+    vtp_accumulator_pool_release_v1(&pool, first);
+    vtp_accumulator_pool_release_v1(&pool, first);
+    vtp_accumulator_pool_release_v1(&pool, &foreign);
+    ASSERT_EQ(2, pool.n_free);
+
+    first = vtp_accumulator_pool_acquire_v1(&pool);
+    second = vtp_accumulator_pool_acquire_v1(&pool);
+    ASSERT(first != second);
+    ASSERT_EQ(NULL, vtp_accumulator_pool_acquire_v1(&pool));
+
+    vtp_accumulator_pool_destroy_v1(&pool);
+
+    PASS();
+}
+
+GREATEST_SUITE(pool_suite) {
+    RUN_TEST(arena_serves_aligned_allocations_until_exhausted);
+    RUN_TEST(arena_can_use_caller_memory);
+    RUN_TEST(pooled_accumulators_are_aligned_and_contiguous);
+    RUN_TEST(pooled_accumulators_are_handed_out_zeroed);
+    RUN_TEST(accumulator_pool_can_be_reset);
+    RUN_TEST(arena_rejects_zero_capacity);
+    RUN_TEST(accumulator_pool_rejects_oversized_pools);
+    RUN_TEST(releasing_twice_is_ignored);
+}
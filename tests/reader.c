@@ -0,0 +1,231 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../vendor/greatest/greatest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vtp/codec.h>
+#include <vtp/reader.h>
+
+
+#define N_READER_TEST_WORDS (8)
+
+/* A source that hands out at most max_fetch bytes per fetch, like a socket that delivers data in small pieces */
+struct sTrickleSource {
+    const unsigned char* bytes;
+    size_t n_bytes;
+    size_t position;
+    size_t max_fetch;
+    int fail;
+};
+typedef struct sTrickleSource TrickleSource;
+
+VTPError fetch_from_file(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes);
+VTPError fetch_trickle(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes);
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord reader_test_words[N_READER_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+
+TEST reader_of_memory_folds_like_fold_until(void) {
+    VTPReaderV1 reader;
+    VTPAccumulatorV1 accumulator;
+    unsigned int amplitudes[3], frequencies[3];
+    unsigned char bytes[4 * N_READER_TEST_WORDS];
+    size_t n_processed;
+
+    vtp_write_instruction_words(N_READER_TEST_WORDS, reader_test_words, bytes);
+    vtp_reader_init_memory_v1(&reader, bytes, sizeof(bytes));
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.n_channels = 3;
+    accumulator.amplitudes = amplitudes;
+    accumulator.frequencies = frequencies;
+    accumulator.milliseconds_elapsed = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_fold_reader_until_v1(&accumulator, &reader, 50, &n_processed));
+    ASSERT_EQ(5, n_processed);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+    ASSERT_EQ(789, accumulator.frequencies[0]);
+    ASSERT_EQ(50, accumulator.milliseconds_elapsed);
+    ASSERT_EQ(0, vtp_reader_at_end_v1(&reader));
+
+    ASSERT_EQ(VTP_OK, vtp_fold_reader_until_v1(&accumulator, &reader, 5000, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(234, accumulator.amplitudes[1]);
+    ASSERT_EQ(567, accumulator.frequencies[1]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+    ASSERT_EQ(1, vtp_reader_at_end_v1(&reader));
+    ASSERT_EQ(N_READER_TEST_WORDS, reader.word_index);
+
+    PASS();
+}
+
+TEST reader_of_file_decodes_all_instructions(void) {
+    VTPReaderV1 reader;
+    VTPInstructionV1 expected[N_READER_TEST_WORDS + 1], instructions[N_READER_TEST_WORDS + 1];
+    unsigned char bytes[4 * N_READER_TEST_WORDS], buffer[4];
+    size_t i, n_decoded;
+    FILE* file;
+
+    vtp_write_instruction_words(N_READER_TEST_WORDS, reader_test_words, bytes);
+    ASSERT_EQ(VTP_OK, vtp_decode_instructions_v1(reader_test_words, expected, N_READER_TEST_WORDS));
+
+    file = tmpfile();
+    ASSERT(file != NULL);
+    ASSERT_EQ(sizeof(bytes), fwrite(bytes, 1, sizeof(bytes), file));
+    rewind(file);
+
+    /* The smallest possible buffer fetches a single instruction word at a time */
+    vtp_reader_init_v1(&reader, fetch_from_file, file, buffer, sizeof(buffer));
+
+    ASSERT_EQ(VTP_OK, vtp_read_instructions_v1(&reader, instructions, 3, &n_decoded));
+    ASSERT_EQ(3, n_decoded);
+    ASSERT_EQ(VTP_OK, vtp_read_instructions_v1(&reader, instructions + 3, N_READER_TEST_WORDS + 1 - 3, &n_decoded));
+    ASSERT_EQ(N_READER_TEST_WORDS - 3, n_decoded);
+    ASSERT_EQ(1, vtp_reader_at_end_v1(&reader));
+
+    fclose(file);
+
+    for (i=0; i < N_READER_TEST_WORDS; i++) {
+        ASSERT_EQ(expected[i].code, instructions[i].code);
+        ASSERT_EQ(vtp_get_time_offset_v1(expected + i), vtp_get_time_offset_v1(instructions + i));
+    }
+
+    PASS();
+}
+
+TEST reader_reassembles_words_split_across_fetches(void) {
+    VTPReaderV1 reader;
+    VTPAccumulatorV1 accumulator;
+    TrickleSource source;
+    unsigned int amplitudes[3], frequencies[3];
+    unsigned char bytes[4 * N_READER_TEST_WORDS], buffer[6];
+    size_t n_processed;
+
+    vtp_write_instruction_words(N_READER_TEST_WORDS, reader_test_words, bytes);
+    source.bytes = bytes;
+    source.n_bytes = sizeof(bytes);
+    source.position = 0;
+    source.max_fetch = 3;
+    source.fail = 0;
+    vtp_reader_init_v1(&reader, fetch_trickle, &source, buffer, sizeof(buffer));
+
+    memset(amplitudes, 0, sizeof(amplitudes));
+    memset(frequencies, 0, sizeof(frequencies));
+    accumulator.n_channels = 3;
+    accumulator.amplitudes = amplitudes;
+    accumulator.frequencies = frequencies;
+    accumulator.milliseconds_elapsed = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_fold_reader_until_v1(&accumulator, &reader, 50, &n_processed));
+    ASSERT_EQ(5, n_processed);
+    ASSERT_EQ(456, accumulator.frequencies[1]);
+
+    ASSERT_EQ(VTP_OK, vtp_fold_reader_until_v1(&accumulator, &reader, 5000, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(567, accumulator.frequencies[1]);
+    ASSERT_EQ(2050, accumulator.milliseconds_elapsed);
+    ASSERT_EQ(1, vtp_reader_at_end_v1(&reader));
+
+    PASS();
+}
+
+TEST reader_with_invalid_input_yields_error(void) {
+    VTPReaderV1 reader;
+    VTPInstructionV1 instructions[N_READER_TEST_WORDS + 1];
+    VTPInstructionWord words[N_READER_TEST_WORDS];
+    TrickleSource source;
+    unsigned char bytes[4 * N_READER_TEST_WORDS], buffer[8];
+    size_t n_decoded;
+
+    memcpy(words, reader_test_words, sizeof(words));
+    words[2] = 0xB0200159;
+    vtp_write_instruction_words(N_READER_TEST_WORDS, words, bytes);
+
+    /* An invalid instruction code stops decoding without consuming the word */
+    vtp_reader_init_memory_v1(&reader, bytes, sizeof(bytes));
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_read_instructions_v1(&reader, instructions, N_READER_TEST_WORDS, &n_decoded));
+    ASSERT_EQ(2, n_decoded);
+    ASSERT_EQ(2, reader.word_index);
+
+    /* A source that ends within an instruction word */
+    vtp_reader_init_memory_v1(&reader, bytes, 6);
+    ASSERT_EQ(VTP_READ_ERROR, vtp_read_instructions_v1(&reader, instructions, N_READER_TEST_WORDS, &n_decoded));
+    ASSERT_EQ(1, n_decoded);
+
+    /* Errors of the fetch callback are passed on */
+    source.bytes = bytes;
+    source.n_bytes = sizeof(bytes);
+    source.position = 0;
+    source.max_fetch = 8;
+    source.fail = 1;
+    vtp_reader_init_v1(&reader, fetch_trickle, &source, buffer, sizeof(buffer));
+    ASSERT_EQ(VTP_READ_ERROR, vtp_read_instructions_v1(&reader, instructions, N_READER_TEST_WORDS, &n_decoded));
+    ASSERT_EQ(2, n_decoded);
+
+    PASS();
+}
+
+GREATEST_SUITE(reader_suite) {
+    RUN_TEST(reader_of_memory_folds_like_fold_until);
+    RUN_TEST(reader_of_file_decodes_all_instructions);
+    RUN_TEST(reader_reassembles_words_split_across_fetches);
+    RUN_TEST(reader_with_invalid_input_yields_error);
+}
+
+
+VTPError fetch_from_file(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes) {
+    *n_bytes = fread(bytes, 1, max_bytes, (FILE*)source);
+    return ferror((FILE*)source) ? VTP_READ_ERROR : VTP_OK;
+}
+
+VTPError fetch_trickle(void* source, unsigned char bytes[], size_t max_bytes, size_t* n_bytes) {
+    TrickleSource* trickle = (TrickleSource*)source;
+
+    /* A failing source breaks down after its first fetch */
+    if (trickle->fail && trickle->position > 0)
+        return VTP_READ_ERROR;
+
+    *n_bytes = trickle->n_bytes - trickle->position;
+    if (*n_bytes > max_bytes)
+        *n_bytes = max_bytes;
+    if (*n_bytes > trickle->max_fetch)
+        *n_bytes = trickle->max_fetch;
+
+    memcpy(bytes, trickle->bytes + trickle->position, *n_bytes);
+    trickle->position += *n_bytes;
+
+    return VTP_OK;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/render.h>
+
+
+#define N_RENDER_CHANNELS (3)
+#define N_RENDER_TEST_WORDS (4)
+#define N_RENDER_FRAMES (12)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * amp ch1 1000
+ * freq ch* 200
+ * time +5ms
+ * amp ch1 0
+ */
+const VTPInstructionWord render_test_words[N_RENDER_TEST_WORDS] = {
+    0x201003e8, 0x100000c8, 0x00000005, 0x20100000
+};
+
+#define DECLARE_RENDER_TEST \
+    VTPRendererV1 renderer; \
+    VTPAccumulatorV1 accumulator; \
+    VTPWordCursorV1 cursor; \
+    VTPRampStateV1 amplitude_states[N_RENDER_CHANNELS], frequency_states[N_RENDER_CHANNELS]; \
+    unsigned int channels[2 * N_RENDER_CHANNELS]; \
+    unsigned int amplitudes[N_RENDER_FRAMES * N_RENDER_CHANNELS], frequencies[N_RENDER_FRAMES * N_RENDER_CHANNELS];
+
+#define PREPARE_RENDER_TEST(mode, ramp_ms) \
+    memset(channels, 0, sizeof(channels)); \
+    accumulator.n_channels = N_RENDER_CHANNELS; \
+    accumulator.amplitudes = channels; \
+    accumulator.frequencies = channels + N_RENDER_CHANNELS; \
+    accumulator.milliseconds_elapsed = 0; \
+    cursor.words = render_test_words; \
+    cursor.n_words = N_RENDER_TEST_WORDS; \
+    cursor.position = 0; \
+    vtp_render_init_v1(&renderer, &accumulator, mode, ramp_ms, 1, amplitude_states, frequency_states);
+
+
+TEST render_without_ramps_matches_accumulator(void) {
+    DECLARE_RENDER_TEST
+    size_t i;
+
+    PREPARE_RENDER_TEST(VTP_RAMP_NONE, 10)
+
+    ASSERT_EQ(VTP_OK, vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, N_RENDER_FRAMES, amplitudes, frequencies));
+    ASSERT_EQ(N_RENDER_TEST_WORDS, cursor.position);
+
+    for (i=0; i < N_RENDER_FRAMES; i++) {
+        ASSERT_EQ(i < 5 ? 1000 : 0, amplitudes[i * N_RENDER_CHANNELS]);
+        ASSERT_EQ(0, amplitudes[i * N_RENDER_CHANNELS + 1]);
+        ASSERT_EQ(200, frequencies[i * N_RENDER_CHANNELS + 2]);
+    }
+
+    PASS();
+}
+
+TEST render_linear_ramps(void) {
+    DECLARE_RENDER_TEST
+
+    PREPARE_RENDER_TEST(VTP_RAMP_LINEAR, 4)
+
+    ASSERT_EQ(VTP_OK, vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, N_RENDER_FRAMES, amplitudes, frequencies));
+
+    /* Up to 1000 within four frames, back down to 0 from the 5ms mark */
+    ASSERT_EQ(250, amplitudes[0 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(500, amplitudes[1 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(750, amplitudes[2 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(1000, amplitudes[3 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(1000, amplitudes[4 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(750, amplitudes[5 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(0, amplitudes[8 * N_RENDER_CHANNELS]);
+    ASSERT_EQ(0, amplitudes[11 * N_RENDER_CHANNELS]);
+
+    ASSERT_EQ(50, frequencies[0 * N_RENDER_CHANNELS + 1]);
+    ASSERT_EQ(200, frequencies[3 * N_RENDER_CHANNELS + 1]);
+    ASSERT_EQ(0, amplitudes[0 * N_RENDER_CHANNELS + 1]);
+
+    PASS();
+}
+
+TEST render_linear_ramps_retarget_from_current_value(void) {
+    DECLARE_RENDER_TEST
+
+    PREPARE_RENDER_TEST(VTP_RAMP_LINEAR, 4)
+
+    cursor.n_words = 0;
+    channels[0] = 800;
+    ASSERT_EQ(VTP_OK, vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, 1, amplitudes, frequencies));
+    ASSERT_EQ(200, amplitudes[0]);
+
+    /* Reversing mid-ramp starts a new ramp from the value currently output */
+    channels[0] = 0;
+    vtp_render_frame_v1(&renderer, &accumulator, amplitudes, frequencies);
+    ASSERT_EQ(150, amplitudes[0]);
+
+    PASS();
+}
+
+TEST render_exponential_ramps(void) {
+    DECLARE_RENDER_TEST
+    size_t i;
+
+    PREPARE_RENDER_TEST(VTP_RAMP_EXPONENTIAL, 3)
+
+    ASSERT_EQ(VTP_OK, vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, 5, amplitudes, frequencies));
+
+    /* Each frame covers a quarter of the remaining distance */
+    ASSERT_EQ(250, amplitudes[0]);
+    ASSERT_EQ(438, amplitudes[N_RENDER_CHANNELS]);
+
+    for (i=1; i < 5; i++)
+        ASSERT(amplitudes[i * N_RENDER_CHANNELS] > amplitudes[(i - 1) * N_RENDER_CHANNELS]);
+
+    accumulator.amplitudes[0] = 1000;
+    for (i=0; i < 100; i++)
+        vtp_render_frame_v1(&renderer, &accumulator, amplitudes, frequencies);
+
+    ASSERT_EQ(1000, amplitudes[0]);
+    ASSERT_EQ(1000l << 10, renderer.amplitudes[0].value);
+
+    PASS();
+}
+
+TEST render_starts_at_accumulator_state(void) {
+    DECLARE_RENDER_TEST
+
+    PREPARE_RENDER_TEST(VTP_RAMP_LINEAR, 10)
+
+    cursor.n_words = 0;
+    channels[0] = 500;
+    vtp_render_init_v1(&renderer, &accumulator, VTP_RAMP_LINEAR, 10, 1, amplitude_states, frequency_states);
+    ASSERT_EQ(VTP_OK, vtp_render_words_v1(&renderer, &accumulator, &cursor, 0, 1, amplitudes, frequencies));
+    ASSERT_EQ(500, amplitudes[0]);
+
+    PASS();
+}
+
+GREATEST_SUITE(render_suite) {
+    RUN_TEST(render_without_ramps_matches_accumulator);
+    RUN_TEST(render_linear_ramps);
+    RUN_TEST(render_linear_ramps_retarget_from_current_value);
+    RUN_TEST(render_exponential_ramps);
+    RUN_TEST(render_starts_at_accumulator_state);
+}
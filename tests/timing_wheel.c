@@ -0,0 +1,256 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/timing_wheel.h>
+
+
+#define N_WHEEL_STREAMS (4)
+#define N_WHEEL_CHANNELS (3)
+#define N_WHEEL_TEST_WORDS (8)
+#define N_WHEEL_LONG_WORDS (5)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord wheel_test_words[N_WHEEL_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * amp ch1 100
+ * time +70000ms
+ * amp +1023ms ch1 200
+ * time +268435455ms
+ * amp ch* 300
+ */
+const VTPInstructionWord wheel_long_words[N_WHEEL_LONG_WORDS] = {
+    0x20100064, 0x00011170, 0x201ffcc8, 0x0fffffff, 0x2000012c
+};
+
+#define DECLARE_WHEEL_TEST \
+    VTPTimingWheelV1 wheel; \
+    VTPAccumulatorV1 accumulators[N_WHEEL_STREAMS]; \
+    VTPWordCursorV1 cursors[N_WHEEL_STREAMS]; \
+    VTPError errors[N_WHEEL_STREAMS]; \
+    size_t links[N_WHEEL_STREAMS]; \
+    unsigned int channels[N_WHEEL_STREAMS][2 * N_WHEEL_CHANNELS]; \
+    size_t i;
+
+/* Stream 0 plays the whole pattern, stream 1 starts at the 50ms mark, stream 2 has nothing to play, stream 3 has long pauses */
+#define PREPARE_WHEEL_TEST \
+    memset(channels, 0, sizeof(channels)); \
+    for (i=0; i < N_WHEEL_STREAMS; i++) { \
+        accumulators[i].n_channels = N_WHEEL_CHANNELS; \
+        accumulators[i].amplitudes = channels[i]; \
+        accumulators[i].frequencies = channels[i] + N_WHEEL_CHANNELS; \
+        accumulators[i].milliseconds_elapsed = 0; \
+        cursors[i].words = wheel_test_words; \
+        cursors[i].n_words = N_WHEEL_TEST_WORDS; \
+        cursors[i].position = 0; \
+    } \
+    cursors[1].position = 3; \
+    cursors[2].position = N_WHEEL_TEST_WORDS; \
+    cursors[3].words = wheel_long_words; \
+    cursors[3].n_words = N_WHEEL_LONG_WORDS; \
+    vtp_timing_wheel_init_v1(&wheel, accumulators, cursors, errors, links, N_WHEEL_STREAMS, 0);
+
+VTPError fold_wheel_reference(VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, unsigned long until_ms);
+
+
+TEST timing_wheel_advances_due_streams(void) {
+    DECLARE_WHEEL_TEST
+    size_t n_processed;
+
+    PREPARE_WHEEL_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 0, &n_processed));
+    ASSERT_EQ(4, n_processed);
+    ASSERT_EQ(3, cursors[0].position);
+    ASSERT_EQ(3, cursors[1].position);
+    ASSERT_EQ(1, cursors[3].position);
+    ASSERT_EQ(123, accumulators[0].amplitudes[0]);
+    ASSERT_EQ(100, accumulators[3].amplitudes[0]);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 50, &n_processed));
+    ASSERT_EQ(4, n_processed);
+    ASSERT_EQ(456, accumulators[1].frequencies[1]);
+    ASSERT_EQ(50, accumulators[1].milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 2049, &n_processed));
+    ASSERT_EQ(0, n_processed);
+    ASSERT_EQ(2049, wheel.current_ms);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 2050, &n_processed));
+    ASSERT_EQ(6, n_processed);
+
+    for (i=0; i < 2; i++) {
+        ASSERT_EQ(N_WHEEL_TEST_WORDS, cursors[i].position);
+        ASSERT_EQ(2050, accumulators[i].milliseconds_elapsed);
+        ASSERT_EQ(234, accumulators[i].amplitudes[2]);
+    }
+
+    ASSERT_EQ(0, accumulators[2].milliseconds_elapsed);
+
+    PASS();
+}
+
+TEST timing_wheel_handles_long_pauses(void) {
+    DECLARE_WHEEL_TEST
+    size_t n_processed;
+
+    PREPARE_WHEEL_TEST
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 69999, NULL));
+    ASSERT_EQ(1, cursors[3].position);
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 71022, &n_processed));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(2, cursors[3].position);
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 71023, &n_processed));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(200, accumulators[3].amplitudes[0]);
+    ASSERT_EQ(71023, accumulators[3].milliseconds_elapsed);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 71023ul + 268435454ul, &n_processed));
+    ASSERT_EQ(0, n_processed);
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 71023ul + 268435455ul, &n_processed));
+    ASSERT_EQ(2, n_processed);
+    ASSERT_EQ(300, accumulators[3].amplitudes[2]);
+    ASSERT_EQ(N_WHEEL_LONG_WORDS, cursors[3].position);
+
+    PASS();
+}
+
+TEST timing_wheel_matches_individual_folds(void) {
+    DECLARE_WHEEL_TEST
+    VTPAccumulatorV1 references[N_WHEEL_STREAMS];
+    VTPWordCursorV1 reference_cursors[N_WHEEL_STREAMS];
+    unsigned int reference_channels[N_WHEEL_STREAMS][2 * N_WHEEL_CHANNELS];
+    unsigned long until_ms, step_ms;
+
+    PREPARE_WHEEL_TEST
+
+    memcpy(references, accumulators, sizeof(references));
+    memcpy(reference_cursors, cursors, sizeof(reference_cursors));
+    memset(reference_channels, 0, sizeof(reference_channels));
+
+    for (i=0; i < N_WHEEL_STREAMS; i++) {
+        references[i].amplitudes = reference_channels[i];
+        references[i].frequencies = reference_channels[i] + N_WHEEL_CHANNELS;
+    }
+
+    /* Uneven steps that grow quickly, so that every level of the wheel gets crossed */
+    for (until_ms = 0, step_ms = 1; until_ms < 300000000ul; until_ms += step_ms, step_ms = step_ms * 3 + 7) {
+        ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, until_ms, NULL));
+
+        for (i=0; i < N_WHEEL_STREAMS; i++) {
+            ASSERT_EQ(VTP_OK, fold_wheel_reference(references + i, reference_cursors + i, until_ms));
+            ASSERT_EQ(reference_cursors[i].position, cursors[i].position);
+            ASSERT_EQ(references[i].milliseconds_elapsed, accumulators[i].milliseconds_elapsed);
+            ASSERT_MEM_EQ(reference_channels[i], channels[i], sizeof(reference_channels[i]));
+        }
+    }
+
+    PASS();
+}
+
+TEST timing_wheel_reschedules_refilled_streams(void) {
+    DECLARE_WHEEL_TEST
+    size_t n_processed;
+
+    PREPARE_WHEEL_TEST
+
+    cursors[2].position = 0;
+    cursors[2].n_words = 3;
+    vtp_timing_wheel_init_v1(&wheel, accumulators, cursors, errors, links, N_WHEEL_STREAMS, 0);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 10, NULL));
+    ASSERT_EQ(3, cursors[2].position);
+
+    /* The stream ran dry - append more words and schedule it again */
+    cursors[2].n_words = N_WHEEL_TEST_WORDS;
+    vtp_timing_wheel_schedule_v1(&wheel, 2);
+    vtp_timing_wheel_schedule_v1(&wheel, 2);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 50, &n_processed));
+    ASSERT_EQ(6, n_processed);
+    ASSERT_EQ(5, cursors[2].position);
+    ASSERT_EQ(789, accumulators[2].frequencies[0]);
+
+    PASS();
+}
+
+TEST timing_wheel_stops_failing_streams_only(void) {
+    DECLARE_WHEEL_TEST
+    VTPInstructionWord invalid_words[N_WHEEL_TEST_WORDS];
+    size_t n_processed;
+
+    PREPARE_WHEEL_TEST
+
+    memcpy(invalid_words, wheel_test_words, sizeof(invalid_words));
+    invalid_words[4] = 0xB0100315;
+    cursors[0].words = invalid_words;
+    vtp_timing_wheel_init_v1(&wheel, accumulators, cursors, errors, links, N_WHEEL_STREAMS, 0);
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_timing_wheel_advance_v1(&wheel, 100, &n_processed));
+    ASSERT_EQ(7, n_processed);
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, errors[0]);
+    ASSERT_EQ(VTP_OK, errors[1]);
+    ASSERT_EQ(4, cursors[0].position);
+    ASSERT_EQ(5, cursors[1].position);
+
+    ASSERT_EQ(VTP_OK, vtp_timing_wheel_advance_v1(&wheel, 2050, &n_processed));
+    ASSERT_EQ(3, n_processed);
+    ASSERT_EQ(4, cursors[0].position);
+
+    PASS();
+}
+
+GREATEST_SUITE(timing_wheel_suite) {
+    RUN_TEST(timing_wheel_advances_due_streams);
+    RUN_TEST(timing_wheel_handles_long_pauses);
+    RUN_TEST(timing_wheel_matches_individual_folds);
+    RUN_TEST(timing_wheel_reschedules_refilled_streams);
+    RUN_TEST(timing_wheel_stops_failing_streams_only);
+}
+
+
+VTPError fold_wheel_reference(VTPAccumulatorV1* accumulator, VTPWordCursorV1* cursor, unsigned long until_ms) {
+    size_t n_processed;
+    VTPError err;
+
+    err = vtp_fold_words_until_v1(accumulator, cursor->words + cursor->position, cursor->n_words - cursor->position, until_ms, &n_processed);
+    cursor->position += n_processed;
+
+    return err;
+}
@@ -0,0 +1,105 @@
+# Copyright 2020 Lucas Hinderberger
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Checks the batch mode of vtp-assemble and vtp-disassemble with blocking I/O and each asynchronous I/O backend,
+# by converting local files to binary and back, including one that fails. Also checks that C headers with a
+# seek index for a long duration are rejected if the seek interval is too small.
+#
+# Usage: cmake -DASSEMBLE=<vtp-assemble> -DDISASSEMBLE=<vtp-disassemble> -DWORK_DIR=<directory> -P tools_batch.cmake
+
+set(N_FILES 40)
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach (i RANGE 1 ${N_FILES})
+    math(EXPR channel "${i} % 8 + 1")
+    file(WRITE ${WORK_DIR}/p${i}.vtpa "time +${i}ms\namp ch${channel} ${i}\nfreq +5ms ch* 100\n")
+endforeach()
+
+file(WRITE ${WORK_DIR}/bad.vtpa "amp ch1 5000\n")
+
+foreach (mode blocking threads io_uring auto)
+    if (mode STREQUAL "blocking")
+        set(async_args "")
+    else()
+        set(async_args -a ${mode})
+    endif()
+
+    set(dir ${WORK_DIR}/${mode})
+    file(MAKE_DIRECTORY ${dir})
+
+    set(assemble_manifest "")
+    set(disassemble_manifest "")
+    foreach (i RANGE 1 ${N_FILES})
+        string(APPEND assemble_manifest "${WORK_DIR}/p${i}.vtpa ${dir}/p${i}.vtp\n")
+        string(APPEND disassemble_manifest "${dir}/p${i}.vtp ${dir}/p${i}.vtpa\n")
+    endforeach()
+    string(APPEND assemble_manifest "${WORK_DIR}/bad.vtpa ${dir}/bad.vtp\n")
+
+    file(WRITE ${dir}/assemble.manifest ${assemble_manifest})
+    file(WRITE ${dir}/disassemble.manifest ${disassemble_manifest})
+
+    execute_process(COMMAND ${ASSEMBLE} -j 2 ${async_args} -m ${dir}/assemble.manifest RESULT_VARIABLE result ERROR_VARIABLE errors)
+
+    if (mode STREQUAL "io_uring" AND errors MATCHES "isn't available")
+        message(STATUS "Skipping io_uring, as it isn't available")
+        continue()
+    endif()
+
+    if (result EQUAL 0 OR NOT errors MATCHES "bad.vtpa: Parameter A out of range at line 1" OR NOT errors MATCHES "1 of 41 files failed")
+        message(FATAL_ERROR "${mode}: The failing file hasn't been reported (exit code ${result}):\n${errors}")
+    endif()
+
+    if (EXISTS ${dir}/bad.vtp)
+        message(FATAL_ERROR "${mode}: The output of the failing file hasn't been removed")
+    endif()
+
+    execute_process(COMMAND ${DISASSEMBLE} -j 2 ${async_args} -m ${dir}/disassemble.manifest RESULT_VARIABLE result ERROR_VARIABLE errors)
+
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${mode}: Disassembling failed (exit code ${result}):\n${errors}")
+    endif()
+
+    foreach (i RANGE 1 ${N_FILES})
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/p${i}.vtpa ${dir}/p${i}.vtpa RESULT_VARIABLE result)
+
+        if (NOT result EQUAL 0)
+            message(FATAL_ERROR "${mode}: p${i}.vtpa doesn't round-trip")
+        endif()
+    endforeach()
+
+    message(STATUS "${mode}: OK")
+endforeach()
+
+file(WRITE ${WORK_DIR}/long.vtpa "time +268435455ms\n")
+file(WRITE ${WORK_DIR}/long.manifest "${WORK_DIR}/long.vtpa ${WORK_DIR}/long_fine.h\n")
+execute_process(COMMAND ${ASSEMBLE} -H pat -i 1 -b ${WORK_DIR}/long.vtpa ${WORK_DIR}/long.h RESULT_VARIABLE result ERROR_VARIABLE errors)
+
+if (result EQUAL 0 OR NOT errors MATCHES "more than 65536 seek points")
+    message(FATAL_ERROR "A seek index for a long duration with a small interval hasn't been rejected (exit code ${result}):\n${errors}")
+endif()
+
+if (EXISTS ${WORK_DIR}/long.h)
+    message(FATAL_ERROR "The header with the rejected seek index hasn't been removed")
+endif()
+
+execute_process(COMMAND ${ASSEMBLE} -H pat -i 4096 -m ${WORK_DIR}/long.manifest RESULT_VARIABLE result ERROR_VARIABLE errors)
+file(READ ${WORK_DIR}/long_fine.h header)
+
+if (NOT result EQUAL 0 OR NOT header MATCHES "PAT_LONG_FINE_N_SEEK_POINTS \\(65536ul\\)")
+    message(FATAL_ERROR "A seek index for a long duration with a large interval hasn't been generated (exit code ${result}):\n${errors}")
+endif()
+
+message(STATUS "seek index limit: OK")
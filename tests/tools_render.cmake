@@ -0,0 +1,83 @@
+# Copyright 2020 Lucas Hinderberger
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Checks vtp-render's output formats, both for input that can be rewound and for input from a pipe,
+# and that batch mode renders the same frames.
+#
+# Usage: cmake -DASSEMBLE=<vtp-assemble> -DRENDER=<vtp-render> -DWORK_DIR=<directory> -P tools_render.cmake
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+file(WRITE ${WORK_DIR}/p.vtpa "freq ch* 234\namp ch* 123\nfreq ch2 345\nfreq +50ms ch2 456\nfreq ch1 789\ntime +200ms\namp ch* 234\nfreq ch2 567\n")
+execute_process(COMMAND ${ASSEMBLE} -o ${WORK_DIR}/p.vtp ${WORK_DIR}/p.vtpa RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Assembling failed")
+endif()
+
+set(expected_csv "time_ms,amp_ch1,amp_ch2,freq_ch1,freq_ch2\n0,123,123,234,345\n50,123,123,789,456\n100,123,123,789,456\n150,123,123,789,456\n200,123,123,789,456\n250,234,234,789,567\n")
+
+execute_process(COMMAND ${RENDER} -r 50 ${WORK_DIR}/p.vtp RESULT_VARIABLE result OUTPUT_VARIABLE csv)
+if (NOT result EQUAL 0 OR NOT csv STREQUAL expected_csv)
+    message(FATAL_ERROR "Unexpected CSV output (exit code ${result}):\n${csv}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${WORK_DIR}/p.vtp COMMAND ${RENDER} -r 50 -c 2 RESULT_VARIABLE result OUTPUT_VARIABLE csv)
+if (NOT result EQUAL 0 OR NOT csv STREQUAL expected_csv)
+    message(FATAL_ERROR "Unexpected CSV output from a pipe (exit code ${result}):\n${csv}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${WORK_DIR}/p.vtp COMMAND ${RENDER} -r 50 RESULT_VARIABLE result ERROR_VARIABLE errors)
+if (result EQUAL 0 OR NOT errors MATCHES "must be given with -c")
+    message(FATAL_ERROR "Missing channel count from a pipe hasn't been reported (exit code ${result}):\n${errors}")
+endif()
+
+# The NPY header is followed by the raw frames, whose shape is only known after rendering when reading from a pipe
+execute_process(COMMAND ${RENDER} -r 50 -f raw -o ${WORK_DIR}/p.raw ${WORK_DIR}/p.vtp)
+execute_process(COMMAND ${RENDER} -r 50 -f npy -o ${WORK_DIR}/p.npy ${WORK_DIR}/p.vtp)
+execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${WORK_DIR}/p.vtp COMMAND ${RENDER} -r 50 -c 2 -f npy -o ${WORK_DIR}/piped.npy)
+
+file(READ ${WORK_DIR}/p.raw raw HEX)
+file(READ ${WORK_DIR}/p.npy npy_header OFFSET 10 LIMIT 118)
+file(READ ${WORK_DIR}/p.npy npy_frames OFFSET 128 HEX)
+
+if (NOT raw MATCHES "^7b007b00ea0059017b007b001503c801")
+    message(FATAL_ERROR "Unexpected raw output: ${raw}")
+endif()
+
+if (NOT npy_header MATCHES "^{'descr': '<u2', 'fortran_order': False, 'shape': \\(6, 2, 2\\)" OR NOT npy_frames STREQUAL raw)
+    message(FATAL_ERROR "Unexpected NPY output: ${npy_header}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/p.npy ${WORK_DIR}/piped.npy RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "NPY output from a pipe differs")
+endif()
+
+foreach (i RANGE 1 8)
+    configure_file(${WORK_DIR}/p.vtp ${WORK_DIR}/b${i}.vtp COPYONLY)
+    list(APPEND batch_paths ${WORK_DIR}/b${i}.vtp ${WORK_DIR}/b${i}.raw)
+endforeach()
+
+execute_process(COMMAND ${RENDER} -r 50 -f raw -j 2 -b ${batch_paths} RESULT_VARIABLE result ERROR_VARIABLE errors)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Batch mode failed (exit code ${result}):\n${errors}")
+endif()
+
+foreach (i RANGE 1 8)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/p.raw ${WORK_DIR}/b${i}.raw RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "Batch mode rendered b${i}.raw differently")
+    endif()
+endforeach()
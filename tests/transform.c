@@ -0,0 +1,244 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../vendor/greatest/greatest.h"
+
+#include <string.h>
+#include <vtp/fold.h>
+#include <vtp/transform.h>
+
+
+#define N_TRANSFORM_TEST_WORDS (8)
+#define MAX_TRANSFORM_WORDS (16)
+
+/*
+ * Corresponding VTP Assembly Code:
+ *
+ * freq ch* 234
+ * amp ch* 123
+ * freq ch2 345
+ *
+ * freq +50ms ch2 456
+ * freq ch1 789
+ *
+ * time +2000ms
+ * amp ch* 234
+ * freq ch2 567
+ */
+const VTPInstructionWord transform_test_words[N_TRANSFORM_TEST_WORDS] = {
+    0x100000ea, 0x2000007b, 0x10200159, 0x1020c9c8,
+    0x10100315, 0x000007d0, 0x200000ea, 0x10200237
+};
+
+unsigned long transformed_duration(const VTPInstructionWord words[], size_t n_words);
+
+
+TEST transform_time_scale_in_place(void) {
+    VTPInstructionWord words[N_TRANSFORM_TEST_WORDS];
+    size_t n_processed, n_out;
+    unsigned long remainder = 0;
+
+    memcpy(words, transform_test_words, sizeof(words));
+
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(words, N_TRANSFORM_TEST_WORDS, 2, 3, &remainder, words, N_TRANSFORM_TEST_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(N_TRANSFORM_TEST_WORDS, n_out);
+
+    /* 50ms -> 33ms, carrying 1/3ms; 2000ms plus the carry -> 1333ms, carrying 2/3ms */
+    ASSERT_EQ(0x102085c8, words[3]);
+    ASSERT_EQ(0x00000535, words[5]);
+    ASSERT_EQ(0x100000ea, words[0]);
+    ASSERT_EQ(0x10200237, words[7]);
+    ASSERT_EQ(1366, transformed_duration(words, n_out));
+
+    PASS();
+}
+
+TEST transform_time_scale_inserts_time_instructions(void) {
+    VTPInstructionWord words[MAX_TRANSFORM_WORDS];
+    size_t n_processed, n_out;
+    unsigned long remainder = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(transform_test_words, N_TRANSFORM_TEST_WORDS, 30, 1, &remainder, words, MAX_TRANSFORM_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(N_TRANSFORM_TEST_WORDS + 1, n_out);
+
+    /* 1500ms don't fit into the time offset anymore */
+    ASSERT_EQ(0x000005dc, words[3]);
+    ASSERT_EQ(0x102001c8, words[4]);
+    ASSERT_EQ(0x0000ea60, words[6]);
+    ASSERT_EQ(61500, transformed_duration(words, n_out));
+
+    remainder = 0;
+    ASSERT_EQ(VTP_BUFFER_TOO_SMALL, vtp_transform_time_scale_v1(transform_test_words, N_TRANSFORM_TEST_WORDS, 30, 1, &remainder, words, N_TRANSFORM_TEST_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(N_TRANSFORM_TEST_WORDS, n_out);
+    ASSERT_EQ(N_TRANSFORM_TEST_WORDS - 1, n_processed);
+
+    PASS();
+}
+
+TEST transform_time_scale_can_be_resumed_after_full_buffer(void) {
+    VTPInstructionWord words[MAX_TRANSFORM_WORDS];
+    VTPInstructionWord resumed[MAX_TRANSFORM_WORDS];
+    size_t n_processed, n_out, n_step, n_total, n_words;
+    unsigned long remainder = 0;
+    VTPError err;
+
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(transform_test_words, N_TRANSFORM_TEST_WORDS, 2, 3, &remainder, words, MAX_TRANSFORM_WORDS, &n_processed, &n_words));
+
+    /* Out arrays of two words each, so that the remainder of 50ms -> 33ms has to be carried across calls */
+    remainder = 0;
+    n_processed = n_total = 0;
+    err = VTP_BUFFER_TOO_SMALL;
+
+    while (err == VTP_BUFFER_TOO_SMALL) {
+        err = vtp_transform_time_scale_v1(transform_test_words + n_processed, N_TRANSFORM_TEST_WORDS - n_processed, 2, 3, &remainder, resumed + n_total, 2, &n_step, &n_out);
+        n_processed += n_step;
+        n_total += n_out;
+    }
+
+    ASSERT_EQ(VTP_OK, err);
+    ASSERT_EQ(N_TRANSFORM_TEST_WORDS, n_processed);
+    ASSERT_EQ(n_words, n_total);
+    ASSERT_MEM_EQ(words, resumed, n_words * sizeof(VTPInstructionWord));
+
+    PASS();
+}
+
+TEST transform_time_scale_drops_empty_time_instructions(void) {
+    VTPInstructionWord words[3] = { 0x00000001, 0x00000001, 0x2000007b };
+    size_t n_processed, n_out;
+    unsigned long remainder = 0;
+
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(words, 3, 1, 2, &remainder, words, 3, &n_processed, &n_out));
+    ASSERT_EQ(2, n_out);
+    ASSERT_EQ(0x00000001, words[0]);
+    ASSERT_EQ(0x2000007b, words[1]);
+
+    PASS();
+}
+
+TEST transform_time_scale_rejects_times_out_of_range(void) {
+    VTPInstructionWord words[2 * MAX_TRANSFORM_WORDS];
+    const VTPInstructionWord longest_words[2] = { 0x2000007b, 0x0FFFFFFF };
+    size_t n_processed, n_out;
+    unsigned long remainder = 0;
+
+    /* 16 * 0x0FFFFFFF is the largest multiple that still fits into 32 bits */
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(longest_words, 2, 16, 1, &remainder, words, 2 * MAX_TRANSFORM_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(17, n_out);
+    ASSERT_EQ(0x0FFFFFFF, words[16]);
+
+    ASSERT_EQ(VTP_TIME_OUT_OF_RANGE, vtp_transform_time_scale_v1(longest_words, 2, 17, 1, &remainder, words, 2 * MAX_TRANSFORM_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(1, n_processed);
+    ASSERT_EQ(1, n_out);
+    ASSERT_EQ(0, remainder);
+
+    /* Remainders close to the denominator must carry without overflowing */
+    remainder = 0xFFFFFFFEul;
+    ASSERT_EQ(VTP_OK, vtp_transform_time_scale_v1(longest_words + 1, 1, 1, 0xFFFFFFFFul, &remainder, words, 2 * MAX_TRANSFORM_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(1, n_out);
+    ASSERT_EQ(0x00000001, words[0]);
+    ASSERT_EQ(0x0FFFFFFEul, remainder);
+
+    PASS();
+}
+
+TEST transform_time_scale_rejects_invalid_words(void) {
+    VTPInstructionWord words[MAX_TRANSFORM_WORDS];
+    VTPInstructionWord invalid_words[N_TRANSFORM_TEST_WORDS];
+    size_t n_processed, n_out;
+    unsigned long remainder = 0;
+
+    memcpy(invalid_words, transform_test_words, sizeof(invalid_words));
+    invalid_words[4] = 0xB0100315;
+
+    ASSERT_EQ(VTP_INVALID_INSTRUCTION_CODE, vtp_transform_time_scale_v1(invalid_words, N_TRANSFORM_TEST_WORDS, 1, 1, &remainder, words, MAX_TRANSFORM_WORDS, &n_processed, &n_out));
+    ASSERT_EQ(4, n_out);
+    ASSERT_EQ(4, n_processed);
+
+    PASS();
+}
+
+TEST transform_remap_channels(void) {
+    VTPInstructionWord words[N_TRANSFORM_TEST_WORDS];
+    unsigned char map[256];
+    size_t i;
+
+    memcpy(words, transform_test_words, sizeof(words));
+    for (i=0; i < 256; i++)
+        map[i] = (unsigned char)i;
+
+    map[1] = 2;
+    map[2] = 7;
+
+    vtp_transform_remap_channels_v1(words, N_TRANSFORM_TEST_WORDS, map);
+
+    ASSERT_EQ(0x100000ea, words[0]);
+    ASSERT_EQ(0x10700159, words[2]);
+    ASSERT_EQ(0x1070c9c8, words[3]);
+    ASSERT_EQ(0x10200315, words[4]);
+    ASSERT_EQ(0x000007d0, words[5]);
+
+    PASS();
+}
+
+TEST transform_gain(void) {
+    VTPInstructionWord words[N_TRANSFORM_TEST_WORDS];
+
+    memcpy(words, transform_test_words, sizeof(words));
+    vtp_transform_gain_v1(words, N_TRANSFORM_TEST_WORDS, VTP_GAIN_UNITY / 2);
+
+    ASSERT_EQ(0x2000003e, words[1]);
+    ASSERT_EQ(0x20000075, words[6]);
+    ASSERT_EQ(0x100000ea, words[0]);
+    ASSERT_EQ(0x000007d0, words[5]);
+
+    memcpy(words, transform_test_words, sizeof(words));
+    vtp_transform_gain_v1(words, N_TRANSFORM_TEST_WORDS, VTP_GAIN_UNITY * 8);
+
+    ASSERT_EQ(0x200003d8, words[1]);
+    ASSERT_EQ(0x200003ff, words[6]);
+    ASSERT_EQ(0x10200237, words[7]);
+
+    PASS();
+}
+
+GREATEST_SUITE(transform_suite) {
+    RUN_TEST(transform_time_scale_in_place);
+    RUN_TEST(transform_time_scale_inserts_time_instructions);
+    RUN_TEST(transform_time_scale_can_be_resumed_after_full_buffer);
+    RUN_TEST(transform_time_scale_drops_empty_time_instructions);
+    RUN_TEST(transform_time_scale_rejects_times_out_of_range);
+    RUN_TEST(transform_time_scale_rejects_invalid_words);
+    RUN_TEST(transform_remap_channels);
+    RUN_TEST(transform_gain);
+}
+
+
+unsigned long transformed_duration(const VTPInstructionWord words[], size_t n_words) {
+    VTPAccumulatorV1 accumulator;
+    unsigned int channels[2 * 3];
+
+    accumulator.n_channels = 3;
+    accumulator.amplitudes = channels;
+    accumulator.frequencies = channels + 3;
+    accumulator.milliseconds_elapsed = 0;
+
+    if (vtp_fold_words_v1(&accumulator, words, n_words) != VTP_OK)
+        return 0;
+
+    return accumulator.milliseconds_elapsed;
+}
@@ -0,0 +1,525 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(VTP_TOOLS_IO_URING)
+#define _GNU_SOURCE
+#elif defined(VTP_TOOLS_THREADS)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include "async_io.h"
+
+#ifdef VTP_TOOLS_THREADS
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef VTP_TOOLS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+/* The maximum number of bytes that a single read or write transfers, before the rest is requested again */
+#define MAX_TRANSFER_SIZE (1ul << 30u)
+
+/* The maximum number of I/O threads of the thread pool backend */
+#define MAX_IO_THREADS (16)
+
+#ifdef VTP_TOOLS_IO_URING
+/* The shared memory rings of an io_uring instance */
+struct sIoUring {
+    int fd;
+    unsigned int sq_entries;
+    unsigned int n_unsubmitted;
+
+    unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned int *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+typedef struct sIoUring IoUring;
+#endif
+
+struct sAsyncIO {
+    AsyncBackend backend;
+    pthread_mutex_t mutex;
+
+    /* Thread pool: Requests waiting for an I/O thread, and completed ones waiting for async_io_wait */
+    AsyncRequest *pending, *pending_tail, *completed;
+    pthread_cond_t pending_cond, completed_cond;
+    pthread_t threads[MAX_IO_THREADS];
+    unsigned int n_threads;
+    int stopping;
+
+#ifdef VTP_TOOLS_IO_URING
+    IoUring ring;
+#endif
+};
+
+int begin_request(AsyncRequest* request);
+void end_request(AsyncRequest* request);
+int transfer_blocking(AsyncRequest* request);
+
+int start_io_threads(AsyncIO* io, unsigned int n_threads);
+void* run_io_thread(void* io);
+
+#ifdef VTP_TOOLS_IO_URING
+int uring_setup(IoUring* ring, unsigned int n_entries);
+void uring_destroy(IoUring* ring);
+void uring_push(IoUring* ring, AsyncRequest* request, int transfer);
+int uring_enter(IoUring* ring, unsigned int min_complete);
+AsyncRequest* uring_wait(AsyncIO* io);
+#endif
+
+
+AsyncIO* async_io_create(AsyncBackend backend, unsigned int queue_depth) {
+    AsyncIO* io;
+
+    if (!(io = calloc(1, sizeof(AsyncIO))))
+        return NULL;
+
+    pthread_mutex_init(&io->mutex, NULL);
+    pthread_cond_init(&io->pending_cond, NULL);
+    pthread_cond_init(&io->completed_cond, NULL);
+
+#ifdef VTP_TOOLS_IO_URING
+    if (backend != ASYNC_BACKEND_THREADS && uring_setup(&io->ring, 2 * queue_depth) == 0) {
+        io->backend = ASYNC_BACKEND_IO_URING;
+        return io;
+    }
+#endif
+
+    if (backend != ASYNC_BACKEND_IO_URING && start_io_threads(io, queue_depth < MAX_IO_THREADS ? queue_depth : MAX_IO_THREADS) == 0) {
+        io->backend = ASYNC_BACKEND_THREADS;
+        return io;
+    }
+
+    async_io_destroy(io);
+    return NULL;
+}
+
+const char* async_io_backend_name(const AsyncIO* io) {
+    return io->backend == ASYNC_BACKEND_IO_URING ? "io_uring" : "threads";
+}
+
+void async_io_submit(AsyncIO* io, AsyncRequest* request) {
+    pthread_mutex_lock(&io->mutex);
+    request->next = NULL;
+
+#ifdef VTP_TOOLS_IO_URING
+    if (io->backend == ASYNC_BACKEND_IO_URING) {
+        /* Requests that need no transfer complete through a no-op, so that they wake up the waiting thread */
+        request->error = begin_request(request);
+        uring_push(&io->ring, request, !request->error && request->n_done < request->size);
+        uring_enter(&io->ring, 0);
+
+        pthread_mutex_unlock(&io->mutex);
+        return;
+    }
+#endif
+
+    if (io->pending_tail)
+        io->pending_tail->next = request;
+    else
+        io->pending = request;
+
+    io->pending_tail = request;
+    pthread_cond_signal(&io->pending_cond);
+    pthread_mutex_unlock(&io->mutex);
+}
+
+AsyncRequest* async_io_wait(AsyncIO* io) {
+    AsyncRequest* request;
+
+#ifdef VTP_TOOLS_IO_URING
+    if (io->backend == ASYNC_BACKEND_IO_URING)
+        return uring_wait(io);
+#endif
+
+    pthread_mutex_lock(&io->mutex);
+
+    while (!io->completed)
+        pthread_cond_wait(&io->completed_cond, &io->mutex);
+
+    request = io->completed;
+    io->completed = request->next;
+
+    pthread_mutex_unlock(&io->mutex);
+    return request;
+}
+
+void async_io_destroy(AsyncIO* io) {
+    unsigned int i;
+
+    pthread_mutex_lock(&io->mutex);
+    io->stopping = 1;
+    pthread_cond_broadcast(&io->pending_cond);
+    pthread_mutex_unlock(&io->mutex);
+
+    for (i=0; i < io->n_threads; i++)
+        pthread_join(io->threads[i], NULL);
+
+#ifdef VTP_TOOLS_IO_URING
+    if (io->backend == ASYNC_BACKEND_IO_URING)
+        uring_destroy(&io->ring);
+#endif
+
+    pthread_cond_destroy(&io->pending_cond);
+    pthread_cond_destroy(&io->completed_cond);
+    pthread_mutex_destroy(&io->mutex);
+    free(io);
+}
+
+
+int begin_request(AsyncRequest* request) {
+    struct stat status;
+
+    request->fd = -1;
+    request->n_done = 0;
+    request->error = 0;
+
+    switch (request->operation) {
+        case ASYNC_READ_FILE:
+            request->data = NULL;
+            request->size = 0;
+
+            if ((request->fd = open(request->path, O_RDONLY)) < 0)
+                return errno;
+
+            if (fstat(request->fd, &status) != 0)
+                return errno;
+
+            request->size = (size_t)status.st_size;
+
+            /* One spare byte, so that empty files get a buffer as well */
+            if (!(request->data = malloc(request->size + 1)))
+                return ENOMEM;
+
+            return 0;
+        case ASYNC_WRITE_FILE:
+            if ((request->fd = open(request->path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+                return errno;
+
+            return 0;
+        default:
+            request->size = 0;
+            return 0;
+    }
+}
+
+void end_request(AsyncRequest* request) {
+    if (request->fd >= 0 && close(request->fd) != 0 && !request->error)
+        request->error = errno;
+
+    request->fd = -1;
+
+    if (request->error && request->operation == ASYNC_READ_FILE) {
+        free(request->data);
+        request->data = NULL;
+    }
+}
+
+int transfer_blocking(AsyncRequest* request) {
+    long n;
+    size_t n_requested;
+
+    while (request->n_done < request->size) {
+        n_requested = request->size - request->n_done;
+        if (n_requested > MAX_TRANSFER_SIZE)
+            n_requested = MAX_TRANSFER_SIZE;
+
+        if (request->operation == ASYNC_READ_FILE)
+            n = read(request->fd, request->data + request->n_done, n_requested);
+        else
+            n = write(request->fd, request->data + request->n_done, n_requested);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno;
+        if (n == 0)
+            return EIO;
+
+        request->n_done += (size_t)n;
+    }
+
+    return 0;
+}
+
+
+int start_io_threads(AsyncIO* io, unsigned int n_threads) {
+    for (io->n_threads = 0; io->n_threads < n_threads; io->n_threads++) {
+        if (pthread_create(io->threads + io->n_threads, NULL, run_io_thread, io) != 0)
+            break;
+    }
+
+    return io->n_threads > 0 ? 0 : -1;
+}
+
+void* run_io_thread(void* context) {
+    AsyncIO* io = context;
+    AsyncRequest* request;
+    int err;
+
+    pthread_mutex_lock(&io->mutex);
+
+    for (;;) {
+        while (!io->pending && !io->stopping)
+            pthread_cond_wait(&io->pending_cond, &io->mutex);
+
+        if (!io->pending)
+            break;
+
+        request = io->pending;
+        io->pending = request->next;
+        if (!io->pending)
+            io->pending_tail = NULL;
+
+        pthread_mutex_unlock(&io->mutex);
+
+        if ((err = begin_request(request)) == 0)
+            err = transfer_blocking(request);
+
+        request->error = err;
+        end_request(request);
+
+        pthread_mutex_lock(&io->mutex);
+        request->next = io->completed;
+        io->completed = request;
+        pthread_cond_signal(&io->completed_cond);
+    }
+
+    pthread_mutex_unlock(&io->mutex);
+    return NULL;
+}
+
+
+#ifdef VTP_TOOLS_IO_URING
+int uring_setup(IoUring* ring, unsigned int n_entries) {
+    struct io_uring_params params;
+    char* sq_ring;
+    char* cq_ring;
+
+    memset(ring, 0, sizeof(IoUring));
+    memset(&params, 0, sizeof(params));
+
+    if ((ring->fd = (int)syscall(__NR_io_uring_setup, n_entries, &params)) < 0)
+        return -1;
+
+    /* Reads and writes at an offset (IORING_OP_READ / IORING_OP_WRITE) came with this feature in Linux 5.6 */
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sq_entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = 0;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->cq_ring_size ? mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING) : ring->sq_ring;
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        uring_destroy(ring);
+        return -1;
+    }
+
+    sq_ring = ring->sq_ring;
+    cq_ring = ring->cq_ring;
+
+    ring->sq_head = (unsigned int*)(sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*)(sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned int*)(cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*)(cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+
+    return 0;
+}
+
+void uring_destroy(IoUring* ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring_size && ring->cq_ring && ring->cq_ring != MAP_FAILED)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+
+    close(ring->fd);
+}
+
+/*
+ * Adds a submission queue entry for the next transfer of a request, or a no-op. Requires the mutex.
+ * The queue cannot overflow, as every request has at most one entry in flight and callers limit the number of requests.
+ */
+void uring_push(IoUring* ring, AsyncRequest* request, int transfer) {
+    unsigned int tail, index;
+    size_t n_requested;
+    struct io_uring_sqe* sqe;
+
+    tail = *ring->sq_tail;
+    index = tail & *ring->sq_mask;
+    sqe = ring->sqes + index;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->user_data = (unsigned long)request;
+
+    if (transfer) {
+        n_requested = request->size - request->n_done;
+        if (n_requested > MAX_TRANSFER_SIZE)
+            n_requested = MAX_TRANSFER_SIZE;
+
+        sqe->opcode = request->operation == ASYNC_READ_FILE ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = request->fd;
+        sqe->addr = (unsigned long)(request->data + request->n_done);
+        sqe->len = (unsigned int)n_requested;
+        sqe->off = request->n_done;
+    }
+    else {
+        sqe->opcode = IORING_OP_NOP;
+    }
+
+    ring->sq_array[index] = index;
+    STORE_RELEASE(ring->sq_tail, tail + 1);
+    ring->n_unsubmitted++;
+}
+
+/* Submits the pending entries and waits for min_complete completions. Submitting requires the mutex. */
+int uring_enter(IoUring* ring, unsigned int min_complete) {
+    long n_submitted;
+
+    do {
+        n_submitted = syscall(__NR_io_uring_enter, ring->fd, ring->n_unsubmitted, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (n_submitted < 0 && errno == EINTR);
+
+    if (n_submitted < 0)
+        return errno;
+
+    ring->n_unsubmitted -= (unsigned int)n_submitted;
+    return 0;
+}
+
+AsyncRequest* uring_wait(AsyncIO* io) {
+    IoUring* ring = &io->ring;
+    struct io_uring_cqe* cqe;
+    AsyncRequest* request;
+    unsigned int head;
+    int result;
+
+    for (;;) {
+        head = *ring->cq_head;
+
+        if (head == LOAD_ACQUIRE(ring->cq_tail)) {
+            /* Entries that couldn't be submitted before, e.g. because the completion queue was full, are retried here */
+            pthread_mutex_lock(&io->mutex);
+            if (ring->n_unsubmitted)
+                uring_enter(ring, 0);
+            pthread_mutex_unlock(&io->mutex);
+
+            if (head == LOAD_ACQUIRE(ring->cq_tail)) {
+                do {
+                    result = (int)syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+                } while (result < 0 && errno == EINTR);
+            }
+
+            continue;
+        }
+
+        cqe = ring->cqes + (head & *ring->cq_mask);
+        request = (AsyncRequest*)(unsigned long)cqe->user_data;
+        result = cqe->res;
+        STORE_RELEASE(ring->cq_head, head + 1);
+
+        /*
+         * The request has been written by the submitting thread while it held the mutex. The kernel orders this
+         * before the completion already, but taking the mutex makes that visible to tools like ThreadSanitizer, too.
+         */
+        pthread_mutex_lock(&io->mutex);
+
+        if (request->operation != ASYNC_NOTIFY && !request->error && request->n_done < request->size) {
+            if (result < 0)
+                request->error = -result;
+            else if (result == 0)
+                request->error = EIO;
+            else
+                request->n_done += (size_t)result;
+
+            /* Large files are transferred in several steps */
+            if (!request->error && request->n_done < request->size) {
+                uring_push(ring, request, 1);
+                uring_enter(ring, 0);
+                pthread_mutex_unlock(&io->mutex);
+                continue;
+            }
+        }
+
+        pthread_mutex_unlock(&io->mutex);
+
+        end_request(request);
+        return request;
+    }
+}
+#endif
+
+#else
+
+/* Without threads, there is no asynchronous I/O and callers fall back to blocking I/O */
+
+struct sAsyncIO {
+    AsyncBackend backend;
+};
+
+AsyncIO* async_io_create(AsyncBackend backend, unsigned int queue_depth) {
+    return NULL;
+}
+
+const char* async_io_backend_name(const AsyncIO* io) {
+    return "none";
+}
+
+void async_io_submit(AsyncIO* io, AsyncRequest* request) {
+}
+
+AsyncRequest* async_io_wait(AsyncIO* io) {
+    return NULL;
+}
+
+void async_io_destroy(AsyncIO* io) {
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBVTP_TOOLS_ASYNC_IO_H
+#define LIBVTP_TOOLS_ASYNC_IO_H
+
+#include <stddef.h>
+
+/**
+ * The implementations of asynchronous I/O
+ *
+ * io_uring requires Linux 5.6 or newer, the thread pool only POSIX threads. Both are only available
+ * if the tools have been built with threads (VTP_TOOLS_THREADS), io_uring additionally with VTP_TOOLS_IO_URING.
+ */
+enum eAsyncBackend {
+    /** Use io_uring if the kernel supports it, otherwise the thread pool */
+    ASYNC_BACKEND_AUTO,
+
+    /** Submit reads and writes to the kernel through an io_uring submission queue */
+    ASYNC_BACKEND_IO_URING,
+
+    /** Perform blocking reads and writes on a pool of I/O threads */
+    ASYNC_BACKEND_THREADS
+};
+typedef enum eAsyncBackend AsyncBackend;
+
+enum eAsyncOperation {
+    /** Reads a whole file into a newly allocated buffer */
+    ASYNC_READ_FILE,
+
+    /** Creates or truncates a file and writes a buffer to it */
+    ASYNC_WRITE_FILE,
+
+    /** Completes right away, which lets other threads wake up a thread that waits for completions */
+    ASYNC_NOTIFY
+};
+typedef enum eAsyncOperation AsyncOperation;
+
+/**
+ * A whole-file operation, which is owned by the I/O layer from its submission until async_io_wait returns it
+ */
+struct sAsyncRequest {
+    AsyncOperation operation;
+
+    /** The file to read or write */
+    const char* path;
+
+    /** The data to write, or after completion, the data that has been read. The latter is allocated with malloc and must be freed by the caller. */
+    unsigned char* data;
+
+    /** The size of data in bytes */
+    size_t size;
+
+    /** After completion, 0 on success, otherwise an errno value */
+    int error;
+
+    /** Free for use by the caller, e.g. to find the job that a completed request belongs to */
+    void* user;
+
+    /* Private to the I/O layer */
+    int fd;
+    size_t n_done;
+    struct sAsyncRequest* next;
+};
+typedef struct sAsyncRequest AsyncRequest;
+
+typedef struct sAsyncIO AsyncIO;
+
+/**
+ * Creates an asynchronous I/O context
+ *
+ * @param backend The implementation to use
+ * @param queue_depth The number of requests that the caller keeps in flight at most
+ * @return The context, or NULL if the backend isn't available
+ */
+AsyncIO* async_io_create(AsyncBackend backend, unsigned int queue_depth);
+
+/** Returns the name of the backend that a context uses */
+const char* async_io_backend_name(const AsyncIO* io);
+
+/**
+ * Starts a request. This can be called from any thread.
+ *
+ * Errors, e.g. a file that cannot be opened, are reported through the error field of the completed request.
+ */
+void async_io_submit(AsyncIO* io, AsyncRequest* request);
+
+/**
+ * Waits until a request has completed. Only a single thread may wait at a time.
+ *
+ * @return The completed request, in any order with respect to their submission
+ */
+AsyncRequest* async_io_wait(AsyncIO* io);
+
+/** Destroys a context. All submitted requests must have completed. */
+void async_io_destroy(AsyncIO* io);
+
+#endif
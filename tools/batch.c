@@ -0,0 +1,687 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef VTP_TOOLS_THREADS
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+#define MANIFEST_READ_SIZE (4096)
+
+/* The number of files that an asynchronous batch keeps in flight, from being read until having been written */
+#define ASYNC_QUEUE_DEPTH (64)
+
+struct sBatchJob {
+    const char* input_path;
+    const char* output_path;
+};
+typedef struct sBatchJob BatchJob;
+
+/* The state that is shared by all workers of a batch */
+struct sBatchRun {
+    const BatchJob* jobs;
+    size_t n_jobs;
+    size_t next_job;
+    size_t n_failed;
+    const char* input_mode;
+    const char* output_mode;
+    BatchConverter convert;
+    void* context;
+};
+typedef struct sBatchRun BatchRun;
+
+struct sBatchWorker {
+    BatchRun* run;
+    unsigned int index;
+};
+typedef struct sBatchWorker BatchWorker;
+
+#ifdef VTP_TOOLS_THREADS
+/* A file of an asynchronous batch, whose request moves on from reading to writing (or to a notification of failure) */
+struct sAsyncJob {
+    const BatchJob* job;
+    AsyncRequest request;
+    struct sAsyncJob* next;
+};
+typedef struct sAsyncJob AsyncJob;
+
+/* The files of an asynchronous batch that have been read and are waiting for a worker */
+struct sAsyncQueue {
+    BatchRun* run;
+    AsyncIO* io;
+    AsyncJob *ready, *ready_tail;
+    int done;
+    pthread_cond_t ready_cond;
+};
+typedef struct sAsyncQueue AsyncQueue;
+
+struct sAsyncWorker {
+    AsyncQueue* queue;
+    unsigned int index;
+};
+typedef struct sAsyncWorker AsyncWorker;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+int append_job(BatchJob** jobs, size_t* n_jobs, size_t* capacity, const char* input_path, const char* output_path);
+char* read_manifest(const char* path);
+int parse_manifest(char* manifest, const char* path, BatchJob** jobs, size_t* n_jobs, size_t* capacity);
+int run_job(BatchRun* run, const BatchJob* job, unsigned int worker);
+int take_job(BatchRun* run, size_t* index);
+void* run_worker(void* worker);
+void run_workers(BatchRun* run, unsigned int n_workers);
+
+#ifdef VTP_TOOLS_THREADS
+int run_workers_async(BatchRun* run, unsigned int n_workers, AsyncIO* io);
+void finish_async_job(BatchRun* run, AsyncJob* job);
+void* run_async_worker(void* worker);
+void convert_in_memory(BatchRun* run, AsyncJob* job, unsigned int worker);
+#endif
+
+
+int parse_batch_arg(int argc, char** args, int* i, BatchArgs* out) {
+    const char* arg = args[*i];
+    char* end;
+
+    if (!strcmp(arg, "-b")) {
+        out->enabled = 1;
+        return 1;
+    }
+
+    if (strcmp(arg, "-a") && strcmp(arg, "-m") && strcmp(arg, "-j"))
+        return 0;
+
+    if (*i + 1 == argc) {
+        fprintf(stderr, "Option without corresponding parameter: %s\n", arg);
+        exit(1);
+    }
+
+    (*i)++;
+
+    if (!strcmp(arg, "-a")) {
+        out->async = 1;
+
+        if (!strcmp(args[*i], "auto"))
+            out->async_backend = ASYNC_BACKEND_AUTO;
+        else if (!strcmp(args[*i], "io_uring"))
+            out->async_backend = ASYNC_BACKEND_IO_URING;
+        else if (!strcmp(args[*i], "threads"))
+            out->async_backend = ASYNC_BACKEND_THREADS;
+        else {
+            fprintf(stderr, "Unknown asynchronous I/O backend: %s\n", args[*i]);
+            exit(1);
+        }
+    }
+    else if (!strcmp(arg, "-m")) {
+        if (out->manifest_path) {
+            fprintf(stderr, "Duplicate manifest file specified: %s\n", args[*i]);
+            exit(1);
+        }
+
+        out->enabled = 1;
+        out->manifest_path = args[*i];
+    }
+    else {
+        out->n_workers = (unsigned int)strtoul(args[*i], &end, 10);
+
+        if (*end || out->n_workers == 0) {
+            fprintf(stderr, "Invalid number of workers: %s\n", args[*i]);
+            exit(1);
+        }
+    }
+
+    return 1;
+}
+
+void print_batch_usage(const char* argument_format) {
+    fprintf(stderr, argument_format, "-b", "Batch mode: Convert each pair of INPUT_FILENAME OUTPUT_FILENAME arguments, continuing past failed files");
+    fprintf(stderr, argument_format, "-m MANIFEST", "Batch mode: Convert each pair of input and output file names, separated by whitespace, on the lines of MANIFEST");
+#ifdef VTP_TOOLS_THREADS
+    fprintf(stderr, argument_format, "-j N", "Batch mode: The number of files that are converted in parallel (default: number of CPUs)");
+#else
+    fprintf(stderr, argument_format, "-j N", "Batch mode: Ignored, as this build doesn't support threads");
+#endif
+    fprintf(stderr, argument_format, "-a BACKEND", "Batch mode: Read and write files asynchronously while converting others, using io_uring, threads or auto (falls back to blocking I/O)");
+    fprintf(stderr, argument_format, "", "Each file is held in memory as a whole while it is in flight");
+}
+
+unsigned int batch_n_workers(const BatchArgs* args) {
+#ifdef VTP_TOOLS_THREADS
+    long n_cpus;
+
+    if (args->n_workers)
+        return args->n_workers;
+
+    n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return n_cpus > 0 ? (unsigned int)n_cpus : 1;
+#else
+    return 1;
+#endif
+}
+
+int run_batch(const BatchArgs* args, char** paths, size_t n_paths, const char* input_mode, const char* output_mode, BatchConverter convert, void* context) {
+    BatchJob* jobs;
+    BatchRun run;
+    AsyncIO* io;
+    size_t i, n_jobs, capacity;
+    unsigned int n_workers;
+    char* manifest;
+    int failed;
+
+    jobs = NULL;
+    n_jobs = 0;
+    capacity = 0;
+    manifest = NULL;
+    failed = 0;
+
+    if (args->manifest_path) {
+        manifest = read_manifest(args->manifest_path);
+        failed = !manifest || parse_manifest(manifest, args->manifest_path, &jobs, &n_jobs, &capacity);
+    }
+
+    for (i=0; !failed && i + 1 < n_paths; i += 2)
+        failed = append_job(&jobs, &n_jobs, &capacity, paths[i], paths[i+1]);
+
+    if (!failed) {
+        memset(&run, 0, sizeof(run));
+        run.jobs = jobs;
+        run.n_jobs = n_jobs;
+        run.input_mode = input_mode;
+        run.output_mode = output_mode;
+        run.convert = convert;
+        run.context = context;
+
+        n_workers = batch_n_workers(args);
+        if (n_workers > n_jobs)
+            n_workers = n_jobs ? (unsigned int)n_jobs : 1;
+
+        io = args->async && n_jobs ? async_io_create(args->async_backend, ASYNC_QUEUE_DEPTH) : NULL;
+
+        if (args->async && n_jobs && !io && args->async_backend != ASYNC_BACKEND_AUTO) {
+            fputs("The requested asynchronous I/O backend isn't available\n", stderr);
+            failed = 1;
+        }
+#ifdef VTP_TOOLS_THREADS
+        else if (io) {
+            failed = run_workers_async(&run, n_workers, io);
+            async_io_destroy(io);
+        }
+#endif
+        else {
+            run_workers(&run, n_workers);
+        }
+
+        if (run.n_failed > 0) {
+            fprintf(stderr, "%lu of %lu files failed\n", (unsigned long)run.n_failed, (unsigned long)n_jobs);
+            failed = 1;
+        }
+    }
+
+    free(jobs);
+    free(manifest);
+
+    return failed;
+}
+
+void begin_error_report(const char* input_name) {
+#ifdef VTP_TOOLS_THREADS
+    pthread_mutex_lock(&report_mutex);
+#endif
+
+    if (input_name)
+        fprintf(stderr, "%s: ", input_name);
+}
+
+void end_error_report(void) {
+#ifdef VTP_TOOLS_THREADS
+    pthread_mutex_unlock(&report_mutex);
+#endif
+}
+
+
+int append_job(BatchJob** jobs, size_t* n_jobs, size_t* capacity, const char* input_path, const char* output_path) {
+    BatchJob* grown;
+
+    if (*n_jobs == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 64;
+        grown = realloc(*jobs, *capacity * sizeof(BatchJob));
+
+        if (!grown) {
+            fputs("Out of memory\n", stderr);
+            return 1;
+        }
+
+        *jobs = grown;
+    }
+
+    (*jobs)[*n_jobs].input_path = input_path;
+    (*jobs)[*n_jobs].output_path = output_path;
+    (*n_jobs)++;
+
+    return 0;
+}
+
+char* read_manifest(const char* path) {
+    FILE* f;
+    char *text, *grown;
+    size_t length, n_read;
+
+    if (!(f = fopen(path, "r"))) {
+        fprintf(stderr, "Could not open manifest file: %s\n", path);
+        return NULL;
+    }
+
+    text = NULL;
+    length = 0;
+
+    do {
+        if (!(grown = realloc(text, length + MANIFEST_READ_SIZE + 1))) {
+            fputs("Out of memory\n", stderr);
+            free(text);
+            fclose(f);
+            return NULL;
+        }
+
+        text = grown;
+        n_read = fread(text + length, 1, MANIFEST_READ_SIZE, f);
+        length += n_read;
+    } while (n_read == MANIFEST_READ_SIZE);
+
+    text[length] = 0;
+
+    if (ferror(f)) {
+        fprintf(stderr, "I/O error reading manifest file: %s\n", path);
+        free(text);
+        text = NULL;
+    }
+
+    fclose(f);
+    return text;
+}
+
+int parse_manifest(char* manifest, const char* path, BatchJob** jobs, size_t* n_jobs, size_t* capacity) {
+    char *line, *next_line, *fields[3];
+    unsigned long line_number;
+    int n_fields;
+
+    line_number = 0;
+
+    for (line = manifest; line; line = next_line) {
+        line_number++;
+
+        if ((next_line = strchr(line, '\n')))
+            *next_line++ = 0;
+
+        /* Split the line into at most three fields in place, the third one only serving to detect excess fields */
+        for (n_fields = 0; n_fields < 3; n_fields++) {
+            while (isspace((unsigned char)*line))
+                line++;
+
+            if (!*line || *line == '#')
+                break;
+
+            fields[n_fields] = line;
+
+            while (*line && !isspace((unsigned char)*line))
+                line++;
+
+            if (*line)
+                *line++ = 0;
+        }
+
+        if (n_fields == 0)
+            continue;
+
+        if (n_fields != 2) {
+            fprintf(stderr, "%s:%lu: Expected an input and an output file name\n", path, line_number);
+            return 1;
+        }
+
+        if (append_job(jobs, n_jobs, capacity, fields[0], fields[1]))
+            return 1;
+    }
+
+    return 0;
+}
+
+int run_job(BatchRun* run, const BatchJob* job, unsigned int worker) {
+    FILE *input, *output;
+    int failed;
+
+    if (!(input = fopen(job->input_path, run->input_mode))) {
+        begin_error_report(job->input_path);
+        fputs("Could not open input file\n", stderr);
+        end_error_report();
+        return 1;
+    }
+
+    if (!(output = fopen(job->output_path, run->output_mode))) {
+        begin_error_report(job->input_path);
+        fprintf(stderr, "Could not open output file: %s\n", job->output_path);
+        end_error_report();
+        fclose(input);
+        return 1;
+    }
+
+    failed = run->convert(input, output, job->output_path, job->input_path, worker, run->context);
+
+    if (fclose(output) && !failed) {
+        begin_error_report(job->input_path);
+        fprintf(stderr, "I/O error writing to output file: %s\n", job->output_path);
+        end_error_report();
+        failed = 1;
+    }
+
+    fclose(input);
+
+    /* Don't leave partial output behind, which a build might mistake for being up to date */
+    if (failed)
+        remove(job->output_path);
+
+    return failed;
+}
+
+int take_job(BatchRun* run, size_t* index) {
+    int taken;
+
+#ifdef VTP_TOOLS_THREADS
+    pthread_mutex_lock(&queue_mutex);
+#endif
+
+    taken = run->next_job < run->n_jobs;
+    if (taken)
+        *index = run->next_job++;
+
+#ifdef VTP_TOOLS_THREADS
+    pthread_mutex_unlock(&queue_mutex);
+#endif
+
+    return taken;
+}
+
+void* run_worker(void* worker) {
+    BatchWorker* self = worker;
+    BatchRun* run = self->run;
+    size_t index;
+
+    while (take_job(run, &index)) {
+        if (run_job(run, run->jobs + index, self->index)) {
+#ifdef VTP_TOOLS_THREADS
+            pthread_mutex_lock(&queue_mutex);
+#endif
+            run->n_failed++;
+#ifdef VTP_TOOLS_THREADS
+            pthread_mutex_unlock(&queue_mutex);
+#endif
+        }
+    }
+
+    return NULL;
+}
+
+void run_workers(BatchRun* run, unsigned int n_workers) {
+    BatchWorker first_worker;
+#ifdef VTP_TOOLS_THREADS
+    BatchWorker* workers;
+    pthread_t* threads;
+    unsigned int i, n_started;
+
+    workers = malloc(n_workers * sizeof(BatchWorker));
+    threads = malloc(n_workers * sizeof(pthread_t));
+    n_started = 0;
+
+    /* The calling thread is worker 0, so that a failure to start threads only costs parallelism */
+    if (workers && threads) {
+        for (i=1; i < n_workers; i++) {
+            workers[i].run = run;
+            workers[i].index = i;
+
+            if (pthread_create(threads + i, NULL, run_worker, workers + i) != 0)
+                break;
+
+            n_started = i;
+        }
+    }
+#endif
+
+    first_worker.run = run;
+    first_worker.index = 0;
+    run_worker(&first_worker);
+
+#ifdef VTP_TOOLS_THREADS
+    for (i=1; i <= n_started; i++)
+        pthread_join(threads[i], NULL);
+
+    free(workers);
+    free(threads);
+#endif
+}
+
+
+#ifdef VTP_TOOLS_THREADS
+int run_workers_async(BatchRun* run, unsigned int n_workers, AsyncIO* io) {
+    AsyncQueue queue;
+    AsyncWorker* workers;
+    AsyncJob* jobs;
+    AsyncRequest* completed;
+    AsyncJob* job;
+    pthread_t* threads;
+    size_t n_finished, n_in_flight;
+    unsigned int i, n_started;
+
+    jobs = calloc(run->n_jobs, sizeof(AsyncJob));
+    workers = malloc(n_workers * sizeof(AsyncWorker));
+    threads = malloc(n_workers * sizeof(pthread_t));
+
+    if (!jobs || !workers || !threads) {
+        fputs("Out of memory\n", stderr);
+        free(jobs);
+        free(workers);
+        free(threads);
+        return 1;
+    }
+
+    memset(&queue, 0, sizeof(queue));
+    queue.run = run;
+    queue.io = io;
+    pthread_cond_init(&queue.ready_cond, NULL);
+
+    for (n_started = 0; n_started < n_workers; n_started++) {
+        workers[n_started].queue = &queue;
+        workers[n_started].index = n_started;
+
+        if (pthread_create(threads + n_started, NULL, run_async_worker, workers + n_started) != 0)
+            break;
+    }
+
+    n_finished = 0;
+    n_in_flight = 0;
+
+    /* This thread only drives the I/O, keeping up to ASYNC_QUEUE_DEPTH files in flight */
+    while (n_started > 0 && n_finished < run->n_jobs) {
+        while (run->next_job < run->n_jobs && n_in_flight < ASYNC_QUEUE_DEPTH) {
+            job = jobs + run->next_job;
+            job->job = run->jobs + run->next_job;
+            job->request.operation = ASYNC_READ_FILE;
+            job->request.path = job->job->input_path;
+            job->request.user = job;
+
+            async_io_submit(io, &job->request);
+            run->next_job++;
+            n_in_flight++;
+        }
+
+        completed = async_io_wait(io);
+        job = completed->user;
+
+        if (completed->operation == ASYNC_READ_FILE && !completed->error) {
+            pthread_mutex_lock(&queue_mutex);
+
+            if (queue.ready_tail)
+                queue.ready_tail->next = job;
+            else
+                queue.ready = job;
+
+            queue.ready_tail = job;
+            job->next = NULL;
+
+            pthread_cond_signal(&queue.ready_cond);
+            pthread_mutex_unlock(&queue_mutex);
+            continue;
+        }
+
+        finish_async_job(run, job);
+        n_finished++;
+        n_in_flight--;
+    }
+
+    pthread_mutex_lock(&queue_mutex);
+    queue.done = 1;
+    pthread_cond_broadcast(&queue.ready_cond);
+    pthread_mutex_unlock(&queue_mutex);
+
+    for (i=0; i < n_started; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&queue.ready_cond);
+    free(jobs);
+    free(workers);
+    free(threads);
+
+    if (n_started == 0) {
+        fputs("Could not start worker threads\n", stderr);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Reports the outcome of a file whose last request has completed */
+void finish_async_job(BatchRun* run, AsyncJob* job) {
+    AsyncRequest* request = &job->request;
+
+    switch (request->operation) {
+        case ASYNC_READ_FILE:
+            begin_error_report(job->job->input_path);
+            fprintf(stderr, "Could not read input file: %s\n", strerror(request->error));
+            end_error_report();
+            run->n_failed++;
+            break;
+        case ASYNC_WRITE_FILE:
+            free(request->data);
+
+            if (request->error) {
+                begin_error_report(job->job->input_path);
+                fprintf(stderr, "Could not write output file: %s: %s\n", job->job->output_path, strerror(request->error));
+                end_error_report();
+                remove(job->job->output_path);
+                run->n_failed++;
+            }
+            break;
+        case ASYNC_NOTIFY:
+            /* The conversion has failed and has been reported already */
+            run->n_failed++;
+            break;
+    }
+}
+
+void* run_async_worker(void* worker) {
+    AsyncWorker* self = worker;
+    AsyncQueue* queue = self->queue;
+    AsyncJob* job;
+
+    for (;;) {
+        pthread_mutex_lock(&queue_mutex);
+
+        while (!queue->ready && !queue->done)
+            pthread_cond_wait(&queue->ready_cond, &queue_mutex);
+
+        if (!(job = queue->ready)) {
+            pthread_mutex_unlock(&queue_mutex);
+            return NULL;
+        }
+
+        queue->ready = job->next;
+        if (!queue->ready)
+            queue->ready_tail = NULL;
+
+        pthread_mutex_unlock(&queue_mutex);
+
+        convert_in_memory(queue->run, job, self->index);
+        async_io_submit(queue->io, &job->request);
+    }
+}
+
+/* Converts a file that has been read into memory, and turns its request into the write of the result */
+void convert_in_memory(BatchRun* run, AsyncJob* job, unsigned int worker) {
+    AsyncRequest* request = &job->request;
+    FILE *input, *output;
+    char* output_data;
+    size_t output_size;
+    int failed;
+
+    output_data = NULL;
+    output_size = 0;
+
+    input = fmemopen(request->data, request->size, "rb");
+    output = open_memstream(&output_data, &output_size);
+
+    if (input && output) {
+        failed = run->convert(input, output, job->job->output_path, job->job->input_path, worker, run->context);
+    }
+    else {
+        begin_error_report(job->job->input_path);
+        fprintf(stderr, "Could not create memory streams: %s\n", strerror(errno));
+        end_error_report();
+        failed = 1;
+    }
+
+    if (input)
+        fclose(input);
+    if (output && fclose(output) && !failed) {
+        begin_error_report(job->job->input_path);
+        fputs("Out of memory\n", stderr);
+        end_error_report();
+        failed = 1;
+    }
+
+    free(request->data);
+
+    if (failed) {
+        free(output_data);
+        remove(job->job->output_path);
+
+        request->operation = ASYNC_NOTIFY;
+        request->data = NULL;
+        request->size = 0;
+        return;
+    }
+
+    request->operation = ASYNC_WRITE_FILE;
+    request->path = job->job->output_path;
+    request->data = (unsigned char*)output_data;
+    request->size = output_size;
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBVTP_TOOLS_BATCH_H
+#define LIBVTP_TOOLS_BATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "async_io.h"
+
+/**
+ * Converts a single file of a batch
+ *
+ * @param input The file to read from
+ * @param output The file to write to
+ * @param output_name The name of the output file. NULL outside of batch mode.
+ * @param input_name The name of the input file, to prefix error messages with. NULL outside of batch mode.
+ * @param worker The index of the calling worker, for selecting buffers that are reused between files
+ * @param context The context that has been passed to run_batch
+ * @return 0 on success, otherwise 1, after having reported the error using begin_error_report / end_error_report
+ */
+typedef int (*BatchConverter)(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context);
+
+/** The batch related command line arguments of a tool */
+struct sBatchArgs {
+    /** Whether batch mode has been requested, using -b or -m */
+    int enabled;
+
+    /** The manifest file to read input / output pairs from, or NULL */
+    const char* manifest_path;
+
+    /** The number of workers given by -j, or 0 for the default */
+    unsigned int n_workers;
+
+    /** Whether files are read and written asynchronously, as requested by -a */
+    int async;
+
+    /** The asynchronous I/O implementation given by -a */
+    AsyncBackend async_backend;
+};
+typedef struct sBatchArgs BatchArgs;
+
+/**
+ * Parses the batch related argument at args[*i], if there is one
+ *
+ * @return 1 if the argument has been consumed (along with its parameter, in which case *i is advanced), otherwise 0
+ */
+int parse_batch_arg(int argc, char** args, int* i, BatchArgs* out);
+
+/** Prints the usage of the batch related arguments, in the format of the tools' help */
+void print_batch_usage(const char* argument_format);
+
+/** Returns the number of workers that a batch will be run with */
+unsigned int batch_n_workers(const BatchArgs* args);
+
+/**
+ * Converts every input / output pair given in the manifest and in paths, continuing past failed files
+ *
+ * Failed files are reported on stderr, prefixed by their input file name, and their output file is removed.
+ * With asynchronous I/O, whole files are read ahead and written behind while the workers convert them in memory.
+ *
+ * @param args The parsed batch arguments
+ * @param paths Additional input / output paths, alternating
+ * @param n_paths The number of entries in paths. Must be even.
+ * @param input_mode The fopen mode for input files
+ * @param output_mode The fopen mode for output files
+ * @param convert The function that converts a single file
+ * @param context Passed on to convert
+ * @return The exit code for the tool: 0 if all files have been converted, otherwise 1
+ */
+int run_batch(const BatchArgs* args, char** paths, size_t n_paths, const char* input_mode, const char* output_mode, BatchConverter convert, void* context);
+
+/**
+ * Starts an error message on stderr, keeping it from being interleaved with those of other workers
+ *
+ * @param input_name The name of the file that the error refers to, which is printed as a prefix. May be NULL.
+ */
+void begin_error_report(const char* input_name);
+
+/** Ends an error message started by begin_error_report */
+void end_error_report(void);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef VTP_TOOLS_MMAP
+#define _POSIX_C_SOURCE 200112L
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_stream.h"
+
+/* The size of a window. Being a multiple of any page size, it keeps windows aligned to pages and to instruction words. */
+#define WINDOW_SIZE (16ul << 20)
+
+
+#ifdef VTP_TOOLS_MMAP
+
+int mapped_stream_open(MappedStream* stream, FILE* file) {
+    struct stat file_stat;
+
+    stream->window = NULL;
+    stream->window_offset = 0;
+    stream->window_size = 0;
+    stream->fd = fileno(file);
+
+    /* Memory streams don't have a file descriptor */
+    if (stream->fd < 0 || fstat(stream->fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+        return 1;
+
+    stream->file_size = (unsigned long)file_stat.st_size;
+    posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return 0;
+}
+
+int mapped_stream_seek(MappedStream* stream, unsigned long offset) {
+    unsigned long window_offset;
+    size_t window_size;
+    void* window;
+
+    mapped_stream_close(stream);
+
+    window_offset = offset - offset % WINDOW_SIZE;
+    stream->window_offset = window_offset;
+
+    if (window_offset >= stream->file_size)
+        return 0;
+
+    window_size = stream->file_size - window_offset < WINDOW_SIZE ? (size_t)(stream->file_size - window_offset) : WINDOW_SIZE;
+    window = mmap(NULL, window_size, PROT_READ, MAP_PRIVATE, stream->fd, (off_t)window_offset);
+
+    if (window == MAP_FAILED)
+        return 1;
+
+    /* Pages of this window are read in order, while the next window can already be read from disk */
+    posix_madvise(window, window_size, POSIX_MADV_SEQUENTIAL);
+    if (window_offset + window_size < stream->file_size)
+        posix_fadvise(stream->fd, (off_t)(window_offset + window_size), WINDOW_SIZE, POSIX_FADV_WILLNEED);
+
+    stream->window = window;
+    stream->window_size = window_size;
+
+    return 0;
+}
+
+void mapped_stream_close(MappedStream* stream) {
+    if (stream->window)
+        munmap((void*)stream->window, stream->window_size);
+
+    stream->window = NULL;
+    stream->window_size = 0;
+}
+
+#else
+
+int mapped_stream_open(MappedStream* stream, FILE* file) {
+    return 1;
+}
+
+int mapped_stream_seek(MappedStream* stream, unsigned long offset) {
+    return 1;
+}
+
+void mapped_stream_close(MappedStream* stream) {
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBVTP_TOOLS_MAPPED_STREAM_H
+#define LIBVTP_TOOLS_MAPPED_STREAM_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * A file that is memory mapped one fixed-size window at a time, for folding it with vtp_fold_window_until_v1
+ *
+ * Only one window is mapped at any time, so files of any size can be processed with constant memory.
+ * The kernel is told that windows are read sequentially, and to read ahead the window after the current one.
+ * Memory mapping is only available if the tools have been built with VTP_TOOLS_MMAP.
+ */
+struct sMappedStream {
+    /** The currently mapped bytes, starting at window_offset within the file */
+    const unsigned char* window;
+
+    /** The offset of the window within the file, in bytes */
+    unsigned long window_offset;
+
+    /** The number of bytes in the window. 0 once the window is past the end of the file. */
+    size_t window_size;
+
+    /* Private */
+    int fd;
+    unsigned long file_size;
+};
+typedef struct sMappedStream MappedStream;
+
+/**
+ * Prepares mapping a file, without mapping any window yet
+ *
+ * @return 0 on success, otherwise 1 if the file can't be mapped, e.g. because it isn't a regular file. Nothing is reported in that case, so that the caller can fall back to reading the file.
+ */
+int mapped_stream_open(MappedStream* stream, FILE* file);
+
+/**
+ * Maps the window that contains the given offset, unmapping the previous one
+ *
+ * @return 0 on success, otherwise 1 with errno set
+ */
+int mapped_stream_seek(MappedStream* stream, unsigned long offset);
+
+/** Unmaps the current window. The file itself is left open. */
+void mapped_stream_close(MappedStream* stream);
+
+#endif
@@ -18,15 +18,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vtp/analyze.h>
 #include <vtp/codec.h>
+#include "batch.h"
 
 #define LINE_BUFFER_SIZE (128)
+#define MAX_SEEK_POINTS (65536ul)
 #define NEXT_CHAR(parser) (parser->input[0])
 #define TOKEN_BUFFER_SIZE (16)
 
 enum eOutputMode {
     OUTPUT_MODE_DEFAULT = 0,
-    OUTPUT_MODE_C_ARRAY
+    OUTPUT_MODE_C_ARRAY,
+    OUTPUT_MODE_C_HEADER
 };
 typedef enum eOutputMode OutputMode;
 
@@ -34,9 +38,29 @@ struct sAssemblerArgs {
     FILE* input;
     FILE* output;
     OutputMode output_mode;
+    const char* header_name;
+    unsigned long seek_interval_ms;
+    BatchArgs batch;
+    char** batch_paths;
+    size_t n_batch_paths;
 };
 typedef struct sAssemblerArgs AssemblerArgs;
 
+/* The instruction words of the whole pattern, which C headers need for their metadata */
+struct sWordBuffer {
+    VTPInstructionWord* words;
+    size_t n_words;
+    size_t capacity;
+};
+typedef struct sWordBuffer WordBuffer;
+
+/* The state shared by all files that are assembled, with a word buffer per worker */
+struct sAssemblerContext {
+    const AssemblerArgs* args;
+    WordBuffer* buffers;
+};
+typedef struct sAssemblerContext AssemblerContext;
+
 enum eCharacterClass {
     CHAR_CLASS_ALPHA,
     CHAR_CLASS_COMMENT_DASH,
@@ -108,9 +132,17 @@ ParserError parse_empty_line(Parser* parser);
 ParserError parse_line_end(Parser* parser);
 
 void read_command_line_args(int argc, char** args, AssemblerArgs* out);
+int is_identifier(const char* name);
+
+int assemble_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context);
+int append_word(WordBuffer* buffer, VTPInstructionWord word, const char* input_name);
+char* batch_header_name(const char* prefix, const char* output_name);
+int write_c_header(FILE* f, const char* name, unsigned long seek_interval_ms, const VTPInstructionWord words[], size_t n_words, const char* input_name);
+void write_macro_name(FILE* f, const char* name, const char* suffix);
 
 
-void print_parser_error(ParserError error, unsigned int line, unsigned int column) {
+void print_parser_error(ParserError error, unsigned int line, unsigned int column, const char* input_name) {
+    begin_error_report(input_name);
     fprintf(stderr, "Error at (%u,%u): ", line, column);
 
     switch (error) {
@@ -132,44 +164,55 @@ void print_parser_error(ParserError error, unsigned int line, unsigned int colum
     }
 
     fputc('\n', stderr);
+    end_error_report();
 }
 
-int validate_instruction(const VTPInstructionV1* instruction, unsigned int line) {
+void print_line_error(const char* message, unsigned int line, const char* input_name) {
+    begin_error_report(input_name);
+    fprintf(stderr, "%s at line %u\n", message, line);
+    end_error_report();
+}
+
+int validate_instruction(const VTPInstructionV1* instruction, unsigned int line, const char* input_name) {
     switch (instruction->code) {
         case VTP_INST_INCREMENT_TIME:
             if (instruction->params.format_a.parameter_a > 0xFFFFFFF) {
-                fprintf(stderr, "Parameter A out of range at line %d\n", line);
+                print_line_error("Parameter A out of range", line, input_name);
                 return 0;
             }
             break;
         case VTP_INST_SET_FREQUENCY:
         case VTP_INST_SET_AMPLITUDE:
             if (instruction->params.format_b.parameter_a >= 1024) {
-                fprintf(stderr, "Parameter A out of range at line %d\n", line);
+                print_line_error("Parameter A out of range", line, input_name);
                 return 0;
             }
             if (instruction->params.format_b.time_offset >= 1024) {
-                fprintf(stderr, "Time offset out of range at line %d\n", line);
+                print_line_error("Time offset out of range", line, input_name);
                 return 0;
             }
             break;
         default:
-            fprintf(stderr, "Unknown instruction at line %d\n", line);
+            print_line_error("Unknown instruction", line, input_name);
             return 0;
     }
 
     return 1;
 }
 
-void write_instruction_binary(FILE* f, VTPInstructionWord instruction) {
+int write_instruction_binary(FILE* f, VTPInstructionWord instruction, const char* input_name) {
     unsigned char buffer[4];
 
     vtp_write_instruction_words(1, &instruction, buffer);
 
     if (fwrite(buffer, 1, 4, f) != 4) {
+        begin_error_report(input_name);
         fputs("I/O error writing to output file\n", stderr);
-        exit(1);
+        end_error_report();
+        return 0;
     }
+
+    return 1;
 }
 
 void write_instruction_hex(FILE* f, VTPInstructionWord instruction, int first) {
@@ -178,9 +221,200 @@ void write_instruction_hex(FILE* f, VTPInstructionWord instruction, int first) {
     fprintf(f, "0x%08lx", instruction);
 }
 
+int append_word(WordBuffer* buffer, VTPInstructionWord word, const char* input_name) {
+    VTPInstructionWord* grown;
+
+    if (buffer->n_words == buffer->capacity) {
+        grown = realloc(buffer->words, (buffer->capacity ? 2 * buffer->capacity : 1024) * sizeof(VTPInstructionWord));
+
+        if (!grown) {
+            begin_error_report(input_name);
+            fputs("Out of memory\n", stderr);
+            end_error_report();
+            return 0;
+        }
+
+        buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 1024;
+        buffer->words = grown;
+    }
+
+    buffer->words[buffer->n_words++] = word;
+    return 1;
+}
+
+char* batch_header_name(const char* prefix, const char* output_name) {
+    const char *stem, *c;
+    char *name, *next;
+
+    /* Each header of a batch needs its own name, which is derived from the output file name without directory and extension */
+    stem = output_name;
+    for (c = output_name; *c; c++) {
+        if (*c == '/' || *c == '\\')
+            stem = c + 1;
+    }
+
+    if (!(name = malloc(strlen(prefix) + strlen(stem) + 2)))
+        return NULL;
+
+    strcpy(name, prefix);
+    next = name + strlen(prefix);
+    *next++ = '_';
+
+    for (c = stem; *c && *c != '.'; c++)
+        *next++ = isalnum((unsigned char)*c) ? *c : '_';
+
+    *next = 0;
+    return name;
+}
+
+void write_macro_name(FILE* f, const char* name, const char* suffix) {
+    for (; *name; name++)
+        fputc(toupper((unsigned char)*name), f);
+
+    fputs(suffix, f);
+}
+
+int write_c_header(FILE* f, const char* name, unsigned long seek_interval_ms, const VTPInstructionWord words[], size_t n_words, const char* input_name) {
+    size_t i, n_seek_points;
+    VTPPatternSummaryV1 summary;
+    VTPSeekPointV1* seek_points;
+
+    if (n_words == 0) {
+        begin_error_report(input_name);
+        fputs("Cannot generate a C header for an empty pattern\n", stderr);
+        end_error_report();
+        return 0;
+    }
+
+    memset(&summary, 0, sizeof(summary));
+    if (vtp_analyze_words_v1(words, n_words, VTP_MAX_CHANNELS, &summary) != VTP_OK) {
+        begin_error_report(input_name);
+        fputs("Unexpected error analyzing the pattern\n", stderr);
+        end_error_report();
+        return 0;
+    }
+
+    /* The seek index is built before anything is written, so that a failure doesn't leave a partial header behind */
+    n_seek_points = 0;
+    seek_points = NULL;
+
+    if (seek_interval_ms) {
+        if (summary.duration_ms / seek_interval_ms >= MAX_SEEK_POINTS) {
+            begin_error_report(input_name);
+            fprintf(stderr, "A seek interval of %lums yields more than %lu seek points for a duration of %lums\n", seek_interval_ms, MAX_SEEK_POINTS, summary.duration_ms);
+            end_error_report();
+            return 0;
+        }
+
+        n_seek_points = summary.duration_ms / seek_interval_ms + 1;
+
+        if (n_seek_points > ((size_t)-1) / sizeof(VTPSeekPointV1) || !(seek_points = malloc(n_seek_points * sizeof(VTPSeekPointV1)))) {
+            begin_error_report(input_name);
+            fputs("Out of memory\n", stderr);
+            end_error_report();
+            return 0;
+        }
+
+        vtp_build_seek_index_v1(words, n_words, seek_interval_ms, seek_points, n_seek_points);
+    }
+
+    fputs("/* Generated by vtp-assemble, do not edit */\n\n", f);
+
+    fputs("#ifndef ", f);
+    write_macro_name(f, name, "_VTP_H\n");
+    fputs("#define ", f);
+    write_macro_name(f, name, "_VTP_H\n\n");
+
+    fputs(seek_interval_ms ? "#include <vtp/analyze.h>\n" : "#include <vtp/instruction_types.h>\n", f);
+    fputc('\n', f);
+
+    fputs("#define ", f);
+    write_macro_name(f, name, "_N_INSTRUCTIONS");
+    fprintf(f, " (%luul)\n", (unsigned long)n_words);
+
+    fputs("#define ", f);
+    write_macro_name(f, name, "_DURATION_MS");
+    fprintf(f, " (%luul)\n", summary.duration_ms);
+
+    fputs("#define ", f);
+    write_macro_name(f, name, "_MAX_CHANNEL");
+    fprintf(f, " (%u)\n", summary.max_channel);
+
+    fprintf(f, "\nstatic const VTPInstructionWord %s_words[", name);
+    write_macro_name(f, name, "_N_INSTRUCTIONS");
+    fputs("] = {", f);
+
+    for (i=0; i < n_words; i++) {
+        fputs(i % 8 == 0 ? "\n    " : " ", f);
+        fprintf(f, "0x%08lx%s", words[i], i + 1 < n_words ? "," : "");
+    }
+
+    fputs("\n};\n", f);
+
+    if (seek_interval_ms) {
+        fputs("\n#define ", f);
+        write_macro_name(f, name, "_SEEK_INTERVAL_MS");
+        fprintf(f, " (%luul)\n", seek_interval_ms);
+
+        fputs("#define ", f);
+        write_macro_name(f, name, "_N_SEEK_POINTS");
+        fprintf(f, " (%luul)\n", (unsigned long)n_seek_points);
+
+        fprintf(f, "\nstatic const VTPSeekPointV1 %s_seek_index[", name);
+        write_macro_name(f, name, "_N_SEEK_POINTS");
+        fputs("] = {", f);
+
+        for (i=0; i < n_seek_points; i++) {
+            fputs(i % 4 == 0 ? "\n    " : " ", f);
+            fprintf(f, "{ %luul, %lu }%s", seek_points[i].milliseconds, (unsigned long)seek_points[i].instruction_index, i + 1 < n_seek_points ? "," : "");
+        }
+
+        fputs("\n};\n", f);
+        free(seek_points);
+    }
+
+    fputs("\n#endif\n", f);
+
+    return 1;
+}
+
 int main(int argc, char** args) {
     AssemblerArgs parsed_args;
+    AssemblerContext context;
+    unsigned int i, n_workers;
+    int result;
+
+    read_command_line_args(argc, args, &parsed_args);
+
+    n_workers = parsed_args.batch.enabled ? batch_n_workers(&parsed_args.batch) : 1;
+
+    context.args = &parsed_args;
+    context.buffers = calloc(n_workers, sizeof(WordBuffer));
+
+    if (!context.buffers) {
+        fputs("Out of memory\n", stderr);
+        return 1;
+    }
+
+    if (parsed_args.batch.enabled)
+        result = run_batch(&parsed_args.batch, parsed_args.batch_paths, parsed_args.n_batch_paths, "r", "wb", assemble_file, &context);
+    else
+        result = assemble_file(parsed_args.input, parsed_args.output, NULL, NULL, 0, &context);
+
+    for (i=0; i < n_workers; i++)
+        free(context.buffers[i].words);
+
+    free(context.buffers);
+    free(parsed_args.batch_paths);
+
+    return result;
+}
+
+int assemble_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context) {
+    const AssemblerArgs* args = ((AssemblerContext*)context)->args;
+    WordBuffer* buffer = ((AssemblerContext*)context)->buffers + worker;
     char line_buffer[LINE_BUFFER_SIZE];
+    char* header_name;
     int n_instructions, instructions_valid;
     Parser parser;
     ParserError err;
@@ -189,27 +423,26 @@ int main(int argc, char** args) {
     VTPInstructionV1 instruction;
     VTPInstructionWord instruction_word;
 
-    read_command_line_args(argc, args, &parsed_args);
-
     instructions_valid = 1;
     line = 0;
     n_instructions = 0;
+    buffer->n_words = 0;
 
-    while (fgets(line_buffer, LINE_BUFFER_SIZE, parsed_args.input)) {
+    while (fgets(line_buffer, LINE_BUFFER_SIZE, input)) {
         line++;
         parser.input = line_buffer;
 
         if ((err = next_token(&parser)) != PARSER_OK && err != PARSER_EOF) {
-            print_parser_error(err, line, parser.input - line_buffer);
-            exit(1);
+            print_parser_error(err, line, parser.input - line_buffer, input_name);
+            return 1;
         }
 
         if (err == PARSER_EOF)
             continue;
 
         if ((err = parse_instruction_v1(&parser, &instruction)) != PARSER_OK && err != PARSER_EOF) {
-            print_parser_error(err, line, parser.input - line_buffer);
-            exit(1);
+            print_parser_error(err, line, parser.input - line_buffer, input_name);
+            return 1;
         }
 
         if (err == PARSER_EOF)
@@ -217,26 +450,56 @@ int main(int argc, char** args) {
 
         n_instructions++;
 
-        if (!validate_instruction(&instruction, line))
+        if (!validate_instruction(&instruction, line, input_name))
             instructions_valid = 0;
 
         if (instructions_valid) {
             if ((vtp_err = vtp_encode_instruction_v1(&instruction, &instruction_word)) != VTP_OK) {
-                fprintf(stderr, "Unexpected VTP error: %d", vtp_err);
-                exit(1);
+                begin_error_report(input_name);
+                fprintf(stderr, "Unexpected VTP error: %d\n", vtp_err);
+                end_error_report();
+                return 1;
             }
 
-            switch (parsed_args.output_mode) {
+            switch (args->output_mode) {
                 case OUTPUT_MODE_DEFAULT:
-                    write_instruction_binary(parsed_args.output, instruction_word);
+                    if (!write_instruction_binary(output, instruction_word, input_name))
+                        return 1;
                     break;
                 case OUTPUT_MODE_C_ARRAY:
-                    write_instruction_hex(parsed_args.output, instruction_word, n_instructions == 1);
+                    write_instruction_hex(output, instruction_word, n_instructions == 1);
+                    break;
+                case OUTPUT_MODE_C_HEADER:
+                    if (!append_word(buffer, instruction_word, input_name))
+                        return 1;
                     break;
             }
         }
     }
 
+    if (instructions_valid && args->output_mode == OUTPUT_MODE_C_HEADER) {
+        header_name = output_name ? batch_header_name(args->header_name, output_name) : NULL;
+
+        if (output_name && !header_name) {
+            begin_error_report(input_name);
+            fputs("Out of memory\n", stderr);
+            end_error_report();
+            return 1;
+        }
+
+        if (!write_c_header(output, header_name ? header_name : args->header_name, args->seek_interval_ms, buffer->words, buffer->n_words, input_name))
+            instructions_valid = 0;
+
+        free(header_name);
+    }
+
+    if (ferror(output)) {
+        begin_error_report(input_name);
+        fputs("I/O error writing to output file\n", stderr);
+        end_error_report();
+        return 1;
+    }
+
     if (instructions_valid)
         return 0;
     else
@@ -578,8 +841,17 @@ ParserError parse_line_end(Parser* parser) {
 void read_command_line_args(int argc, char** args, AssemblerArgs* out) {
     int i;
     static const char* ARGUMENT_FORMAT = "%20s %s\n";
+    const char* output_path;
 
     memset(out, 0, sizeof(AssemblerArgs));
+    output_path = NULL;
+
+    /* Input file names are collected first, as they are pairs of input and output file names in batch mode */
+    out->batch_paths = malloc(argc * sizeof(char*));
+    if (!out->batch_paths) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
 
     for (i=1; i < argc; i++) {
         char* arg = args[i];
@@ -592,7 +864,31 @@ void read_command_line_args(int argc, char** args, AssemblerArgs* out) {
 
             out->output_mode = OUTPUT_MODE_C_ARRAY;
         }
-        else if (!strcmp(arg, "-o")) {
+        else if (!strcmp(arg, "-H")) {
+            if (i+1 == argc) {
+                fprintf(stderr, "Option without corresponding parameter: %s\n", arg);
+                exit(1);
+            }
+
+            if (out->output_mode) {
+                fprintf(stderr, "Duplicate output mode specified: %s\n", arg);
+                exit(1);
+            }
+
+            i++;
+            arg = args[i];
+
+            if (!is_identifier(arg)) {
+                fprintf(stderr, "Not a valid C identifier: %s\n", arg);
+                exit(1);
+            }
+
+            out->output_mode = OUTPUT_MODE_C_HEADER;
+            out->header_name = arg;
+        }
+        else if (!strcmp(arg, "-i")) {
+            char* end;
+
             if (i+1 == argc) {
                 fprintf(stderr, "Option without corresponding parameter: %s\n", arg);
                 exit(1);
@@ -601,22 +897,34 @@ void read_command_line_args(int argc, char** args, AssemblerArgs* out) {
             i++;
             arg = args[i];
 
-            if (out->output) {
-                fprintf(stderr, "Duplicate output file specified: %s\n", arg);
+            out->seek_interval_ms = strtoul(arg, &end, 10);
+
+            if (*end || out->seek_interval_ms == 0) {
+                fprintf(stderr, "Invalid seek interval: %s\n", arg);
+                exit(1);
+            }
+        }
+        else if (!strcmp(arg, "-o")) {
+            if (i+1 == argc) {
+                fprintf(stderr, "Option without corresponding parameter: %s\n", arg);
                 exit(1);
             }
 
-            out->output = fopen(arg, "wb");
+            i++;
+            arg = args[i];
 
-            if (!out->output) {
-                fprintf(stderr, "Could not open output file: %s\n", arg);
+            if (output_path) {
+                fprintf(stderr, "Duplicate output file specified: %s\n", arg);
                 exit(1);
             }
+
+            output_path = arg;
         }
         else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
             fputs("Usage:\n\n", stderr);
 
-            fputs("vtp-assemble [-o OUTPUT_FILENAME] [INPUT_FILENAME]\n\n", stderr);
+            fputs("vtp-assemble [-c | -H NAME [-i INTERVAL_MS]] [-o OUTPUT_FILENAME] [INPUT_FILENAME]\n", stderr);
+            fputs("vtp-assemble [-c | -H NAME [-i INTERVAL_MS]] [-j N] [-m MANIFEST] -b [INPUT_FILENAME OUTPUT_FILENAME]...\n\n", stderr);
 
             fputs("This program assembles VTP Assembly Code in its corresponding binary representation.\n", stderr);
             fputs("By default, it reads from stdin and writes to stdout, but you can override this using\n", stderr);
@@ -624,22 +932,57 @@ void read_command_line_args(int argc, char** args, AssemblerArgs* out) {
 
             fprintf(stderr, ARGUMENT_FORMAT, "INPUT_FILENAME", "The file from which the VTP Assembly Code shall be read (default: stdin)");
             fprintf(stderr, ARGUMENT_FORMAT, "-c", "Output comma-separated C-style hexadecimal numbers instead of binary");
+            fprintf(stderr, ARGUMENT_FORMAT, "-H NAME", "Output a C header that defines the array NAME_words, along with the instruction count, duration and highest channel. In batch mode, NAME is followed by _ and the output file name.");
+            fprintf(stderr, ARGUMENT_FORMAT, "-i INTERVAL_MS", "With -H, also output a seek index with a seek point every INTERVAL_MS milliseconds, at most 65536 of them");
             fprintf(stderr, ARGUMENT_FORMAT, "-o OUTPUT_FILENAME", "The file to which the VTP Binary Code shall be written (default: stdout)");
+            print_batch_usage(ARGUMENT_FORMAT);
 
             exit(0);
         }
-        else {
-            if (out->input) {
-                fprintf(stderr, "Duplicate input file specified: %s\n", arg);
-                exit(1);
-            }
+        else if (!parse_batch_arg(argc, args, &i, &out->batch)) {
+            out->batch_paths[out->n_batch_paths++] = arg;
+        }
+    }
 
-            out->input = fopen(arg, "r");
+    if (out->seek_interval_ms && out->output_mode != OUTPUT_MODE_C_HEADER) {
+        fputs("A seek interval can only be specified along with -H\n", stderr);
+        exit(1);
+    }
 
-            if (!out->input) {
-                fprintf(stderr, "Could not open input file: %s\n", arg);
-                exit(1);
-            }
+    if (out->batch.enabled) {
+        if (output_path) {
+            fputs("In batch mode, output files are given along with their input files instead of with -o\n", stderr);
+            exit(1);
+        }
+
+        if (out->n_batch_paths % 2 != 0) {
+            fprintf(stderr, "Input file without output file: %s\n", out->batch_paths[out->n_batch_paths - 1]);
+            exit(1);
+        }
+
+        return;
+    }
+
+    if (out->n_batch_paths > 1) {
+        fprintf(stderr, "Duplicate input file specified: %s\n", out->batch_paths[1]);
+        exit(1);
+    }
+
+    if (out->n_batch_paths == 1) {
+        out->input = fopen(out->batch_paths[0], "r");
+
+        if (!out->input) {
+            fprintf(stderr, "Could not open input file: %s\n", out->batch_paths[0]);
+            exit(1);
+        }
+    }
+
+    if (output_path) {
+        out->output = fopen(output_path, "wb");
+
+        if (!out->output) {
+            fprintf(stderr, "Could not open output file: %s\n", output_path);
+            exit(1);
         }
     }
 
@@ -648,3 +991,15 @@ void read_command_line_args(int argc, char** args, AssemblerArgs* out) {
     if (!out->output)
         out->output = stdout;
 }
+
+int is_identifier(const char* name) {
+    if (!isalpha((unsigned char)*name) && *name != '_')
+        return 0;
+
+    for (name++; *name; name++) {
+        if (!isalnum((unsigned char)*name) && *name != '_')
+            return 0;
+    }
+
+    return 1;
+}
@@ -18,17 +18,41 @@
 #include <stdlib.h>
 #include <string.h>
 #include <vtp/codec.h>
+#include "batch.h"
+
+/* The number of instruction words that are read and decoded at once */
+#define CHUNK_N_WORDS (1024)
 
 struct sDisassemblerArgs {
     FILE* input;
     FILE* output;
+    int keep_going;
+    BatchArgs batch;
+    char** batch_paths;
+    size_t n_batch_paths;
 };
 typedef struct sDisassemblerArgs DisassemblerArgs;
 
+/* The buffers of a worker, which are reused for every file it disassembles */
+struct sDisassemblerBuffers {
+    unsigned char bytes[CHUNK_N_WORDS * 4];
+    VTPInstructionWord words[CHUNK_N_WORDS];
+    VTPInstructionV1 instructions[CHUNK_N_WORDS];
+    VTPDecodeIssueV1 issues[CHUNK_N_WORDS];
+};
+typedef struct sDisassemblerBuffers DisassemblerBuffers;
+
+/* The state shared by all files that are disassembled, with buffers per worker */
+struct sDisassemblerContext {
+    const DisassemblerArgs* args;
+    DisassemblerBuffers* buffers;
+};
+typedef struct sDisassemblerContext DisassemblerContext;
+
 void read_command_line_args(int argc, char** args, DisassemblerArgs* out);
-VTPInstructionWord read_instruction_word(FILE* input);
-void read_instruction(FILE* input, VTPInstructionV1* instruction_out, unsigned int n_instructions);
-void print_vtp_error(VTPError error, unsigned int n_instructions);
+int disassemble_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context);
+int write_chunk_assembly(FILE* output, const DisassemblerArgs* args, DisassemblerBuffers* buffers, size_t n_words, unsigned long first_index, const char* input_name, unsigned long* n_invalid);
+void print_vtp_error(VTPError error, unsigned long n_instructions, const char* input_name);
 void write_instruction_assembly(FILE* output, const VTPInstructionV1* instruction);
 void write_parameters_format_a(FILE* output, const VTPInstructionParamsA* params);
 void write_parameters_format_b(FILE* output, const VTPInstructionParamsB* params);
@@ -37,25 +61,104 @@ void write_time_offset(FILE* output, unsigned long offset);
 
 int main(int argc, char** args) {
     DisassemblerArgs parsed_args;
-    VTPInstructionV1 instruction;
-    unsigned int n_instructions;
+    DisassemblerContext context;
+    int result;
 
     read_command_line_args(argc, args, &parsed_args);
 
-    n_instructions = 0;
-    while (!feof(parsed_args.input)) {
-        n_instructions++;
+    context.args = &parsed_args;
+    context.buffers = malloc((parsed_args.batch.enabled ? batch_n_workers(&parsed_args.batch) : 1) * sizeof(DisassemblerBuffers));
+
+    if (!context.buffers) {
+        fputs("Out of memory\n", stderr);
+        return 1;
+    }
+
+    if (parsed_args.batch.enabled)
+        result = run_batch(&parsed_args.batch, parsed_args.batch_paths, parsed_args.n_batch_paths, "rb", "w", disassemble_file, &context);
+    else
+        result = disassemble_file(parsed_args.input, parsed_args.output, NULL, NULL, 0, &context);
+
+    free(context.buffers);
+    free(parsed_args.batch_paths);
+
+    return result;
+}
+
+
+int disassemble_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context) {
+    const DisassemblerArgs* args = ((DisassemblerContext*)context)->args;
+    DisassemblerBuffers* buffers = ((DisassemblerContext*)context)->buffers + worker;
+    size_t n_bytes, n_words;
+    unsigned long first_index, n_invalid;
+
+    first_index = 0;
+    n_invalid = 0;
+
+    while ((n_bytes = fread(buffers->bytes, 1, sizeof(buffers->bytes), input)) > 0) {
+        n_words = n_bytes / 4;
 
-        read_instruction(parsed_args.input, &instruction, n_instructions);
-        write_instruction_assembly(parsed_args.output, &instruction);
+        vtp_read_instruction_words(n_words, buffers->bytes, buffers->words);
+        if (write_chunk_assembly(output, args, buffers, n_words, first_index, input_name, &n_invalid))
+            return 1;
+        first_index += n_words;
+
+        if (n_bytes % 4 != 0) {
+            begin_error_report(input_name);
+            fputs("Unexpected EOF\n", stderr);
+            end_error_report();
+            return 1;
+        }
+    }
+
+    if (ferror(input) || ferror(output)) {
+        begin_error_report(input_name);
+        fputs(ferror(input) ? "I/O error reading input file\n" : "I/O error writing to output file\n", stderr);
+        end_error_report();
+        return 1;
+    }
+
+    if (n_invalid > 0) {
+        begin_error_report(input_name);
+        fprintf(stderr, "%lu invalid instruction words\n", n_invalid);
+        end_error_report();
+        return 1;
     }
 
     return 0;
 }
 
+int write_chunk_assembly(FILE* output, const DisassemblerArgs* args, DisassemblerBuffers* buffers, size_t n_words, unsigned long first_index, const char* input_name, unsigned long* n_invalid) {
+    size_t i, n_instructions, n_issues, next_instruction, next_issue;
+
+    vtp_decode_instructions_lenient_v1(buffers->words, n_words, VTP_RECOVERY_SKIP, NULL, buffers->instructions, &n_instructions, buffers->issues, CHUNK_N_WORDS, &n_issues);
+
+    next_instruction = 0;
+    next_issue = 0;
+
+    for (i=0; i < n_words; i++) {
+        if (next_issue < n_issues && buffers->issues[next_issue].index == i) {
+            print_vtp_error(buffers->issues[next_issue].error, first_index + i + 1, input_name);
+            if (!args->keep_going)
+                return 1;
+
+            /* Keep the output valid assembly, while still showing where the invalid word was */
+            fprintf(output, "-- invalid instruction word 0x%08lX\n", buffers->words[i]);
+            next_issue++;
+        }
+        else {
+            write_instruction_assembly(output, buffers->instructions + next_instruction);
+            next_instruction++;
+        }
+    }
+
+    *n_invalid += n_issues;
+    return 0;
+}
 
-void print_vtp_error(VTPError error, unsigned int n_instructions) {
-    fprintf(stderr, "Error at instruction #%u: ", n_instructions);
+void print_vtp_error(VTPError error, unsigned long n_instructions, const char* input_name) {
+    begin_error_report(input_name);
+    fprintf(stderr, "Error at instruction #%lu: ", n_instructions);
 
     switch (error) {
         case VTP_INVALID_INSTRUCTION_CODE:
@@ -67,13 +170,23 @@ void print_vtp_error(VTPError error, unsigned int n_instructions) {
     }
 
     fputc('\n', stderr);
+    end_error_report();
 }
 
 void read_command_line_args(int argc, char** args, DisassemblerArgs* out) {
     int i;
     static const char* ARGUMENT_FORMAT = "%20s %s\n";
+    const char* output_path;
 
     memset(out, 0, sizeof(DisassemblerArgs));
+    output_path = NULL;
+
+    /* Input file names are collected first, as they are pairs of input and output file names in batch mode */
+    out->batch_paths = malloc(argc * sizeof(char*));
+    if (!out->batch_paths) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
 
     for (i=1; i < argc; i++) {
         char* arg = args[i];
@@ -87,22 +200,21 @@ void read_command_line_args(int argc, char** args, DisassemblerArgs* out) {
             i++;
             arg = args[i];
 
-            if (out->output) {
+            if (output_path) {
                 fprintf(stderr, "Duplicate output file specified: %s\n", arg);
                 exit(1);
             }
 
-            out->output = fopen(arg, "w");
-
-            if (!out->output) {
-                fprintf(stderr, "Could not open output file: %s\n", arg);
-                exit(1);
-            }
+            output_path = arg;
+        }
+        else if (!strcmp(arg, "-k")) {
+            out->keep_going = 1;
         }
         else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
             fputs("Usage:\n\n", stderr);
 
-            fputs("vtp-disassemble [-o OUTPUT_FILENAME] [INPUT_FILENAME]\n\n", stderr);
+            fputs("vtp-disassemble [-k] [-o OUTPUT_FILENAME] [INPUT_FILENAME]\n", stderr);
+            fputs("vtp-disassemble [-k] [-j N] [-m MANIFEST] -b [INPUT_FILENAME OUTPUT_FILENAME]...\n\n", stderr);
 
             fputs("This program disassembles VTP Binary Code in its corresponding assembly representation.\n", stderr);
             fputs("By default, it reads from stdin and writes to stdout, but you can override this using\n", stderr);
@@ -110,52 +222,57 @@ void read_command_line_args(int argc, char** args, DisassemblerArgs* out) {
 
             fprintf(stderr, ARGUMENT_FORMAT, "INPUT_FILENAME", "The file from which the VTP Binary Code shall be read (default: stdin)");
             fprintf(stderr, ARGUMENT_FORMAT, "-o OUTPUT_FILENAME", "The file to which the VTP Assembly Code shall be written (default: stdout)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-k", "Report all invalid instruction words and write them as comments, instead of stopping at the first one");
+            print_batch_usage(ARGUMENT_FORMAT);
 
             exit(0);
         }
-        else {
-            if (out->input) {
-                fprintf(stderr, "Duplicate input file specified: %s\n", arg);
-                exit(1);
-            }
-
-            out->input = fopen(arg, "rb");
-
-            if (!out->input) {
-                fprintf(stderr, "Could not open input file: %s\n", arg);
-                exit(1);
-            }
+        else if (!parse_batch_arg(argc, args, &i, &out->batch)) {
+            out->batch_paths[out->n_batch_paths++] = arg;
         }
     }
 
-    if (!out->input)
-        out->input = stdin;
-    if (!out->output)
-        out->output = stdout;
-}
+    if (out->batch.enabled) {
+        if (output_path) {
+            fputs("In batch mode, output files are given along with their input files instead of with -o\n", stderr);
+            exit(1);
+        }
 
-void read_instruction(FILE* input, VTPInstructionV1* instruction_out, unsigned int n_instructions) {
-    VTPError err;
-    VTPInstructionWord encoded = read_instruction_word(input);
+        if (out->n_batch_paths % 2 != 0) {
+            fprintf(stderr, "Input file without output file: %s\n", out->batch_paths[out->n_batch_paths - 1]);
+            exit(1);
+        }
 
-    if ((err = vtp_decode_instruction_v1(encoded, instruction_out) != VTP_OK)) {
-        print_vtp_error(err, n_instructions);
+        return;
+    }
+
+    if (out->n_batch_paths > 1) {
+        fprintf(stderr, "Duplicate input file specified: %s\n", out->batch_paths[1]);
         exit(1);
     }
-}
 
-VTPInstructionWord read_instruction_word(FILE* input) {
-    unsigned char buffer[4];
-    VTPInstructionWord result;
+    if (out->n_batch_paths == 1) {
+        out->input = fopen(out->batch_paths[0], "rb");
 
-    if (fread(buffer, 1, 4, input) != 4) {
-        fputs("Unexpected EOF", stderr);
-        exit(1);
+        if (!out->input) {
+            fprintf(stderr, "Could not open input file: %s\n", out->batch_paths[0]);
+            exit(1);
+        }
     }
 
-    vtp_read_instruction_words(1, buffer, &result);
+    if (output_path) {
+        out->output = fopen(output_path, "w");
 
-    return result;
+        if (!out->output) {
+            fprintf(stderr, "Could not open output file: %s\n", output_path);
+            exit(1);
+        }
+    }
+
+    if (!out->input)
+        out->input = stdin;
+    if (!out->output)
+        out->output = stdout;
 }
 
 void write_instruction_assembly(FILE* output, const VTPInstructionV1* instruction) {
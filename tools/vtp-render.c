@@ -0,0 +1,576 @@
+/*
+ * Copyright 2020 Lucas Hinderberger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vtp/analyze.h>
+#include <vtp/codec.h>
+#include <vtp/render.h>
+#include "batch.h"
+#include "mapped_stream.h"
+
+/* The number of instruction words that are read at once */
+#define CHUNK_N_WORDS (1024)
+
+/* The number of amplitude or frequency values that are rendered before being written at once */
+#define BLOCK_N_VALUES (65536)
+
+/* The maximum length of a CSV row: the time and a comma-separated 16 bit number per amplitude and frequency */
+#define CSV_ROW_MAX_LENGTH (21 + VTP_MAX_CHANNELS * 2 * 6 + 1)
+
+/* The NPY header is padded to a fixed length, so that its shape can be filled in after rendering */
+#define NPY_HEADER_LENGTH (128)
+
+enum eRenderFormat {
+    FORMAT_CSV,
+    FORMAT_RAW,
+    FORMAT_NPY
+};
+typedef enum eRenderFormat RenderFormat;
+
+struct sRendererArgs {
+    FILE* input;
+    FILE* output;
+    RenderFormat format;
+    unsigned int n_channels;
+    unsigned int frame_ms;
+    unsigned int ramp_ms;
+    VTPRampModeV1 ramp_mode;
+    BatchArgs batch;
+    char** batch_paths;
+    size_t n_batch_paths;
+};
+typedef struct sRendererArgs RendererArgs;
+
+/* The buffers of a worker, which are reused for every file it renders */
+struct sRendererBuffers {
+    unsigned char bytes[CHUNK_N_WORDS * 4];
+    VTPInstructionWord words[CHUNK_N_WORDS];
+    unsigned int channel_amplitudes[VTP_MAX_CHANNELS];
+    unsigned int channel_frequencies[VTP_MAX_CHANNELS];
+    VTPRampStateV1 amplitude_states[VTP_MAX_CHANNELS];
+    VTPRampStateV1 frequency_states[VTP_MAX_CHANNELS];
+    unsigned int amplitudes[BLOCK_N_VALUES];
+    unsigned int frequencies[BLOCK_N_VALUES];
+    unsigned char frame_bytes[BLOCK_N_VALUES * 4];
+};
+typedef struct sRendererBuffers RendererBuffers;
+
+/* The state shared by all files that are rendered, with buffers per worker */
+struct sRendererContext {
+    const RendererArgs* args;
+    RendererBuffers* buffers;
+};
+typedef struct sRendererContext RendererContext;
+
+void read_command_line_args(int argc, char** args, RendererArgs* out);
+const char* read_parameter(int argc, char** args, int* i);
+unsigned int parse_number(const char* arg, unsigned int min, unsigned int max, const char* description);
+int render_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context);
+size_t read_chunk(FILE* input, RendererBuffers* buffers, const char* input_name, int* failed);
+int scan_input(FILE* input, RendererBuffers* buffers, const char* input_name, unsigned long* duration_ms, unsigned char* max_channel);
+void write_header(FILE* output, const RendererArgs* args, unsigned char n_channels, unsigned long n_frames);
+void write_frames(FILE* output, const RendererArgs* args, RendererBuffers* buffers, unsigned char n_channels, unsigned long first_frame, size_t n_frames);
+void print_vtp_error(VTPError error, unsigned long n_instructions, const char* input_name);
+
+
+int main(int argc, char** args) {
+    RendererArgs parsed_args;
+    RendererContext context;
+    int result;
+
+    read_command_line_args(argc, args, &parsed_args);
+
+    context.args = &parsed_args;
+    context.buffers = malloc((parsed_args.batch.enabled ? batch_n_workers(&parsed_args.batch) : 1) * sizeof(RendererBuffers));
+
+    if (!context.buffers) {
+        fputs("Out of memory\n", stderr);
+        return 1;
+    }
+
+    if (parsed_args.batch.enabled)
+        result = run_batch(&parsed_args.batch, parsed_args.batch_paths, parsed_args.n_batch_paths, "rb", "wb", render_file, &context);
+    else
+        result = render_file(parsed_args.input, parsed_args.output, NULL, NULL, 0, &context);
+
+    free(context.buffers);
+    free(parsed_args.batch_paths);
+
+    return result;
+}
+
+
+int render_file(FILE* input, FILE* output, const char* output_name, const char* input_name, unsigned int worker, void* context) {
+    const RendererArgs* args = ((RendererContext*)context)->args;
+    RendererBuffers* buffers = ((RendererContext*)context)->buffers + worker;
+    VTPAccumulatorV1 accumulator;
+    VTPStreamCursorV1 cursor;
+    VTPRendererV1 renderer;
+    VTPError err;
+    MappedStream stream;
+    const unsigned char* window;
+    size_t window_size, n_block_frames, block_capacity;
+    unsigned long window_offset, time_ms, duration_ms, n_frames;
+    unsigned char n_channels;
+    int seekable, mapped, window_exhausted, eof, failed;
+
+    n_channels = (unsigned char)args->n_channels;
+    n_frames = 0;
+
+    /* Input that can be rewound is scanned first, for its number of channels and frames */
+    seekable = fseek(input, 0, SEEK_CUR) == 0;
+    if (seekable) {
+        if (scan_input(input, buffers, input_name, &duration_ms, n_channels == 0 ? &n_channels : NULL))
+            return 1;
+
+        n_frames = duration_ms / args->frame_ms + 1;
+
+        if (fseek(input, 0, SEEK_SET) != 0) {
+            begin_error_report(input_name);
+            fputs("Could not rewind input file\n", stderr);
+            end_error_report();
+            return 1;
+        }
+    }
+    else if (n_channels == 0) {
+        begin_error_report(input_name);
+        fputs("The number of channels must be given with -c, as the input can't be rewound\n", stderr);
+        end_error_report();
+        return 1;
+    }
+
+    if (n_channels == 0)
+        n_channels = 1;
+
+    memset(buffers->channel_amplitudes, 0, sizeof(buffers->channel_amplitudes));
+    memset(buffers->channel_frequencies, 0, sizeof(buffers->channel_frequencies));
+    accumulator.n_channels = n_channels;
+    accumulator.amplitudes = buffers->channel_amplitudes;
+    accumulator.frequencies = buffers->channel_frequencies;
+    accumulator.milliseconds_elapsed = 0;
+
+    vtp_render_init_v1(&renderer, &accumulator, args->ramp_mode, args->ramp_ms, args->frame_ms, buffers->amplitude_states, buffers->frequency_states);
+    write_header(output, args, n_channels, n_frames);
+
+    /* Regular files are memory mapped window by window, anything else is read in chunks */
+    mapped = seekable && mapped_stream_open(&stream, input) == 0;
+    cursor.accumulator = &accumulator;
+    cursor.byte_offset = 0;
+    window = NULL;
+    window_offset = 0;
+    window_size = 0;
+    window_exhausted = 1;
+    eof = 0;
+    failed = 0;
+
+    block_capacity = BLOCK_N_VALUES / n_channels;
+    n_block_frames = 0;
+    n_frames = 0;
+    time_ms = 0;
+
+    /* Frames are rendered at every multiple of frame_ms, up until the time of the last instruction */
+    for (;;) {
+        if (window_exhausted && !eof) {
+            if (mapped) {
+                if (mapped_stream_seek(&stream, cursor.byte_offset)) {
+                    begin_error_report(input_name);
+                    fprintf(stderr, "Could not map input file: %s\n", strerror(errno));
+                    end_error_report();
+                    failed = 1;
+                    break;
+                }
+
+                window = stream.window;
+                window_offset = stream.window_offset;
+                window_size = stream.window_size;
+            }
+            else {
+                window = buffers->bytes;
+                window_offset = cursor.byte_offset;
+                window_size = read_chunk(input, buffers, input_name, &failed) * 4;
+
+                if (failed)
+                    break;
+            }
+
+            /* A partial instruction word at the end of a mapped file has already been reported by scan_input */
+            eof = cursor.byte_offset + 4 > window_offset + window_size;
+        }
+
+        err = vtp_fold_window_until_v1(&cursor, window, window_offset, window_size, time_ms, &window_exhausted);
+
+        if (err != VTP_OK) {
+            print_vtp_error(err, cursor.byte_offset / 4 + 1, input_name);
+            failed = 1;
+            break;
+        }
+
+        /* The frame might still depend on instructions of the next window */
+        if (window_exhausted && !eof)
+            continue;
+
+        if (window_exhausted && time_ms > accumulator.milliseconds_elapsed)
+            break;
+
+        vtp_render_frame_v1(&renderer, &accumulator, buffers->amplitudes + n_block_frames * n_channels, buffers->frequencies + n_block_frames * n_channels);
+        time_ms += args->frame_ms;
+
+        if (++n_block_frames == block_capacity) {
+            write_frames(output, args, buffers, n_channels, n_frames, n_block_frames);
+            n_frames += n_block_frames;
+            n_block_frames = 0;
+        }
+    }
+
+    if (mapped)
+        mapped_stream_close(&stream);
+    if (failed)
+        return 1;
+
+    write_frames(output, args, buffers, n_channels, n_frames, n_block_frames);
+    n_frames += n_block_frames;
+
+    if (args->format == FORMAT_NPY && !seekable) {
+        if (fseek(output, 0, SEEK_SET) != 0) {
+            begin_error_report(input_name);
+            fputs("NPY output must be seekable if the input can't be rewound\n", stderr);
+            end_error_report();
+            return 1;
+        }
+
+        write_header(output, args, n_channels, n_frames);
+        fseek(output, 0, SEEK_END);
+    }
+
+    if (ferror(input) || ferror(output)) {
+        begin_error_report(input_name);
+        fputs(ferror(input) ? "I/O error reading input file\n" : "I/O error writing to output file\n", stderr);
+        end_error_report();
+        return 1;
+    }
+
+    return 0;
+}
+
+size_t read_chunk(FILE* input, RendererBuffers* buffers, const char* input_name, int* failed) {
+    size_t n_bytes;
+
+    n_bytes = fread(buffers->bytes, 1, sizeof(buffers->bytes), input);
+
+    if (n_bytes % 4 != 0) {
+        begin_error_report(input_name);
+        fputs("Unexpected EOF\n", stderr);
+        end_error_report();
+        *failed = 1;
+    }
+
+    return n_bytes / 4;
+}
+
+int scan_input(FILE* input, RendererBuffers* buffers, const char* input_name, unsigned long* duration_ms, unsigned char* max_channel) {
+    VTPPatternSummaryV1 summary;
+    VTPError err;
+    size_t n_words;
+    unsigned long first_word;
+    int failed;
+
+    memset(&summary, 0, sizeof(summary));
+    *duration_ms = 0;
+    first_word = 0;
+    failed = 0;
+
+    while ((n_words = read_chunk(input, buffers, input_name, &failed)) > 0 && !failed) {
+        vtp_read_instruction_words(n_words, buffers->bytes, buffers->words);
+
+        if ((err = vtp_analyze_words_v1(buffers->words, n_words, VTP_MAX_CHANNELS, &summary)) != VTP_OK) {
+            print_vtp_error(err, first_word + summary.n_instructions + 1, input_name);
+            return 1;
+        }
+
+        *duration_ms += summary.duration_ms;
+        if (max_channel && summary.max_channel > *max_channel)
+            *max_channel = summary.max_channel;
+
+        first_word += n_words;
+    }
+
+    return failed;
+}
+
+void write_header(FILE* output, const RendererArgs* args, unsigned char n_channels, unsigned long n_frames) {
+    char header[NPY_HEADER_LENGTH];
+    unsigned int i;
+    int length;
+
+    switch (args->format) {
+        case FORMAT_CSV:
+            fputs("time_ms", output);
+            for (i=1; i <= n_channels; i++)
+                fprintf(output, ",amp_ch%u", i);
+            for (i=1; i <= n_channels; i++)
+                fprintf(output, ",freq_ch%u", i);
+            fputc('\n', output);
+            break;
+        case FORMAT_NPY:
+            /* NPY format version 1.0: magic, version, little endian header length, then a dict padded with spaces and ended by a newline */
+            memcpy(header, "\x93NUMPY\x01\x00", 8);
+            header[8] = (char)((NPY_HEADER_LENGTH - 10) & 0xFF);
+            header[9] = (char)((NPY_HEADER_LENGTH - 10) >> 8);
+
+            length = sprintf(header + 10, "{'descr': '<u2', 'fortran_order': False, 'shape': (%lu, 2, %u), }", n_frames, (unsigned int)n_channels);
+            memset(header + 10 + length, ' ', NPY_HEADER_LENGTH - 10 - length);
+            header[NPY_HEADER_LENGTH - 1] = '\n';
+
+            fwrite(header, 1, sizeof(header), output);
+            break;
+        default:
+            break;
+    }
+}
+
+void write_frames(FILE* output, const RendererArgs* args, RendererBuffers* buffers, unsigned char n_channels, unsigned long first_frame, size_t n_frames) {
+    size_t i, i_value, length;
+    unsigned char i_channel;
+    unsigned char* out;
+    char* text;
+
+    if (args->format == FORMAT_CSV) {
+        /* Rows are formatted into the frame buffer, so that they are written in large blocks as well */
+        text = (char*)buffers->frame_bytes;
+        length = 0;
+
+        for (i=0, i_value=0; i < n_frames; i++, i_value += n_channels) {
+            if (length + CSV_ROW_MAX_LENGTH > sizeof(buffers->frame_bytes)) {
+                fwrite(text, 1, length, output);
+                length = 0;
+            }
+
+            length += sprintf(text + length, "%lu", (first_frame + i) * args->frame_ms);
+            for (i_channel=0; i_channel < n_channels; i_channel++)
+                length += sprintf(text + length, ",%u", buffers->amplitudes[i_value + i_channel]);
+            for (i_channel=0; i_channel < n_channels; i_channel++)
+                length += sprintf(text + length, ",%u", buffers->frequencies[i_value + i_channel]);
+            text[length++] = '\n';
+        }
+
+        fwrite(text, 1, length, output);
+        return;
+    }
+
+    /* Each frame consists of all amplitudes followed by all frequencies, as little endian 16 bit numbers */
+    out = buffers->frame_bytes;
+    for (i=0, i_value=0; i < n_frames; i++, i_value += n_channels) {
+        for (i_channel=0; i_channel < n_channels; i_channel++, out += 2) {
+            out[0] = (unsigned char)(buffers->amplitudes[i_value + i_channel] & 0xFFu);
+            out[1] = (unsigned char)(buffers->amplitudes[i_value + i_channel] >> 8u);
+        }
+        for (i_channel=0; i_channel < n_channels; i_channel++, out += 2) {
+            out[0] = (unsigned char)(buffers->frequencies[i_value + i_channel] & 0xFFu);
+            out[1] = (unsigned char)(buffers->frequencies[i_value + i_channel] >> 8u);
+        }
+    }
+
+    fwrite(buffers->frame_bytes, 1, (size_t)(out - buffers->frame_bytes), output);
+}
+
+void print_vtp_error(VTPError error, unsigned long n_instructions, const char* input_name) {
+    begin_error_report(input_name);
+    fprintf(stderr, "Error at instruction #%lu: ", n_instructions);
+
+    switch (error) {
+        case VTP_INVALID_INSTRUCTION_CODE:
+            fputs("Invalid instruction code", stderr);
+            break;
+        case VTP_CHANNEL_OUT_OF_RANGE:
+            fputs("Channel out of range", stderr);
+            break;
+        default:
+            fprintf(stderr, "Unexpected error: %d", error);
+            break;
+    }
+
+    fputc('\n', stderr);
+    end_error_report();
+}
+
+void read_command_line_args(int argc, char** args, RendererArgs* out) {
+    int i;
+    static const char* ARGUMENT_FORMAT = "%20s %s\n";
+    const char* output_path;
+    const char* parameter;
+
+    memset(out, 0, sizeof(RendererArgs));
+    out->format = FORMAT_CSV;
+    out->frame_ms = 10;
+    out->ramp_mode = VTP_RAMP_NONE;
+    output_path = NULL;
+
+    /* Input file names are collected first, as they are pairs of input and output file names in batch mode */
+    out->batch_paths = malloc(argc * sizeof(char*));
+    if (!out->batch_paths) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+
+    for (i=1; i < argc; i++) {
+        char* arg = args[i];
+
+        if (!strcmp(arg, "-o")) {
+            parameter = read_parameter(argc, args, &i);
+
+            if (output_path) {
+                fprintf(stderr, "Duplicate output file specified: %s\n", parameter);
+                exit(1);
+            }
+
+            output_path = parameter;
+        }
+        else if (!strcmp(arg, "-f")) {
+            parameter = read_parameter(argc, args, &i);
+
+            if (!strcmp(parameter, "csv"))
+                out->format = FORMAT_CSV;
+            else if (!strcmp(parameter, "raw"))
+                out->format = FORMAT_RAW;
+            else if (!strcmp(parameter, "npy"))
+                out->format = FORMAT_NPY;
+            else {
+                fprintf(stderr, "Unknown output format: %s\n", parameter);
+                exit(1);
+            }
+        }
+        else if (!strcmp(arg, "-p")) {
+            parameter = read_parameter(argc, args, &i);
+
+            if (!strcmp(parameter, "none"))
+                out->ramp_mode = VTP_RAMP_NONE;
+            else if (!strcmp(parameter, "linear"))
+                out->ramp_mode = VTP_RAMP_LINEAR;
+            else if (!strcmp(parameter, "exponential"))
+                out->ramp_mode = VTP_RAMP_EXPONENTIAL;
+            else {
+                fprintf(stderr, "Unknown ramp mode: %s\n", parameter);
+                exit(1);
+            }
+        }
+        else if (!strcmp(arg, "-c")) {
+            out->n_channels = parse_number(read_parameter(argc, args, &i), 1, VTP_MAX_CHANNELS, "number of channels");
+        }
+        else if (!strcmp(arg, "-r")) {
+            out->frame_ms = parse_number(read_parameter(argc, args, &i), 1, 0xFFFFu, "frame interval");
+        }
+        else if (!strcmp(arg, "-t")) {
+            out->ramp_ms = parse_number(read_parameter(argc, args, &i), 0, 0xFFFFu, "ramp time");
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            fputs("Usage:\n\n", stderr);
+
+            fputs("vtp-render [-f FORMAT] [-r FRAME_MS] [-c CHANNELS] [-p RAMP -t RAMP_MS] [-o OUTPUT_FILENAME] [INPUT_FILENAME]\n", stderr);
+            fputs("vtp-render [-f FORMAT] [-r FRAME_MS] [-c CHANNELS] [-p RAMP -t RAMP_MS] [-j N] [-m MANIFEST] -b [INPUT_FILENAME OUTPUT_FILENAME]...\n\n", stderr);
+
+            fputs("This program renders VTP Binary Code into the amplitude and frequency of each channel\n", stderr);
+            fputs("at every multiple of a frame interval, up until the time of the last instruction.\n", stderr);
+            fputs("By default, it reads from stdin and writes to stdout, but you can override this using\n", stderr);
+            fputs("the command line parameters listed below. Input of any length is rendered in constant memory,\n", stderr);
+            fputs("except with -a, which holds each input and output file in memory as a whole.\n\n", stderr);
+
+            fprintf(stderr, ARGUMENT_FORMAT, "INPUT_FILENAME", "The file from which the VTP Binary Code shall be read (default: stdin)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-o OUTPUT_FILENAME", "The file to which the frames shall be written (default: stdout)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-f FORMAT", "csv: A row per frame with its time, all amplitudes, then all frequencies (default)");
+            fprintf(stderr, ARGUMENT_FORMAT, "", "raw: Per frame, all amplitudes, then all frequencies as little endian unsigned 16 bit numbers");
+            fprintf(stderr, ARGUMENT_FORMAT, "", "npy: The raw frames as NumPy array of shape (frames, 2, channels)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-r FRAME_MS", "The time between two frames in milliseconds (default: 10)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-c CHANNELS", "The number of channels (default: the highest channel of the input, which requires it to be rewindable)");
+            fprintf(stderr, ARGUMENT_FORMAT, "-p RAMP", "Smooth changes of each channel: none (default), linear or exponential");
+            fprintf(stderr, ARGUMENT_FORMAT, "-t RAMP_MS", "The duration of a linear ramp or the time constant of an exponential ramp (default: 0)");
+            print_batch_usage(ARGUMENT_FORMAT);
+
+            exit(0);
+        }
+        else if (!parse_batch_arg(argc, args, &i, &out->batch)) {
+            out->batch_paths[out->n_batch_paths++] = arg;
+        }
+    }
+
+    if (out->batch.enabled) {
+        if (output_path) {
+            fputs("In batch mode, output files are given along with their input files instead of with -o\n", stderr);
+            exit(1);
+        }
+
+        if (out->n_batch_paths % 2 != 0) {
+            fprintf(stderr, "Input file without output file: %s\n", out->batch_paths[out->n_batch_paths - 1]);
+            exit(1);
+        }
+
+        return;
+    }
+
+    if (out->n_batch_paths > 1) {
+        fprintf(stderr, "Duplicate input file specified: %s\n", out->batch_paths[1]);
+        exit(1);
+    }
+
+    if (out->n_batch_paths == 1) {
+        out->input = fopen(out->batch_paths[0], "rb");
+
+        if (!out->input) {
+            fprintf(stderr, "Could not open input file: %s\n", out->batch_paths[0]);
+            exit(1);
+        }
+    }
+
+    if (output_path) {
+        out->output = fopen(output_path, "wb");
+
+        if (!out->output) {
+            fprintf(stderr, "Could not open output file: %s\n", output_path);
+            exit(1);
+        }
+    }
+
+    if (!out->input)
+        out->input = stdin;
+    if (!out->output)
+        out->output = stdout;
+}
+
+const char* read_parameter(int argc, char** args, int* i) {
+    if (*i + 1 == argc) {
+        fprintf(stderr, "Option without corresponding parameter: %s\n", args[*i]);
+        exit(1);
+    }
+
+    (*i)++;
+    return args[*i];
+}
+
+unsigned int parse_number(const char* arg, unsigned int min, unsigned int max, const char* description) {
+    unsigned long value;
+    char* end;
+
+    value = strtoul(arg, &end, 10);
+
+    if (!*arg || *end || value < min || value > max) {
+        fprintf(stderr, "Invalid %s: %s\n", description, arg);
+        exit(1);
+    }
+
+    return (unsigned int)value;
+}